@@ -24,6 +24,7 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES += \
     loc_eng_log.cpp \
+    loc_eng_msg_slab.cpp \
     LocApiAdapter.cpp
 
 LOCAL_CFLAGS += \
@@ -31,6 +32,13 @@ LOCAL_CFLAGS += \
      -D_ANDROID_ \
 	 -DNEW_QC_GPS
 
+## REPLAY_TRACE in gps.conf swaps the modem for a recorded trace, see
+## ReplayLocApiAdapter.h; never in user builds
+ifneq ($(filter eng userdebug,$(TARGET_BUILD_VARIANT)),)
+LOCAL_SRC_FILES += ReplayLocApiAdapter.cpp
+LOCAL_CFLAGS += -DLOC_TEST_ADAPTERS
+endif # eng userdebug
+
 LOCAL_C_INCLUDES:= \
     $(TARGET_OUT_HEADERS)/gps.utils
 
@@ -40,9 +48,12 @@ LOCAL_COPY_HEADERS:= \
    loc.h \
    loc_eng.h \
    loc_eng_xtra.h \
+   loc_eng_warm.h \
+   loc_eng_batch.h \
    loc_eng_ni.h \
    loc_eng_agps.h \
    loc_eng_msg.h \
+   loc_eng_msg_slab.h \
    loc_eng_msg_id.h \
    loc_eng_log.h
 
@@ -64,26 +75,44 @@ LOCAL_SRC_FILES += \
     loc_eng.cpp \
     loc_eng_agps.cpp \
     loc_eng_xtra.cpp \
+    loc_eng_warm.cpp \
     loc_eng_ni.cpp \
     loc_eng_log.cpp \
-	loc_eng_nmea.cpp
+	loc_eng_nmea.cpp \
+    loc_eng_nmea_enc.cpp \
+    loc_eng_bin.cpp \
+    loc_eng_msg_stats.cpp \
+    loc_eng_conf_watch.cpp \
+    loc_eng_sensor_tuner.cpp \
+    loc_eng_batch.cpp
 
 ifeq ($(FEATURE_GNSS_BIT_API), true)
 LOCAL_CFLAGS += -DFEATURE_GNSS_BIT_API
 endif # FEATURE_GNSS_BIT_API
 
+## Talk to gpsone_daemon over SOCK_SEQPACKET sockets instead of named
+## pipes; only for a daemon built the same way
+ifeq ($(FEATURE_LOC_ENG_DMN_CONN_SOCKET), true)
+LOCAL_CFLAGS += -DFEATURE_LOC_ENG_DMN_CONN_SOCKET
+endif # FEATURE_LOC_ENG_DMN_CONN_SOCKET
+
 LOCAL_SRC_FILES += \
     loc_eng_dmn_conn.cpp \
     loc_eng_dmn_conn_handler.cpp \
     loc_eng_dmn_conn_thread_helper.c \
     loc_eng_dmn_conn_glue_msg.c \
-    loc_eng_dmn_conn_glue_pipe.c
+    loc_eng_dmn_conn_glue_pipe.c \
+    loc_eng_dmn_conn_glue_sock.c
 
 LOCAL_CFLAGS += \
      -fno-short-enums \
      -D_ANDROID_ \
 	 -DNEW_QC_GPS
 
+## Most verbose LOC_LOG level compiled in, see log_util.h
+LOC_ENG_LOG_MIN_LEVEL ?= 5
+LOCAL_CFLAGS += -DLOC_LOG_MIN_LEVEL=$(LOC_ENG_LOG_MIN_LEVEL)
+
 LOCAL_C_INCLUDES:= \
     $(TARGET_OUT_HEADERS)/gps.utils \
     device/samsung/msm8660-common/gps/ulp/inc
@@ -102,6 +131,7 @@ LOCAL_SHARED_LIBRARIES := \
     libutils \
     libcutils \
     libloc_eng \
+    libloc_adapter \
     libgps.utils \
     libdl
 
@@ -123,4 +153,159 @@ LOCAL_MODULE_RELATIVE_PATH := hw
 
 include $(BUILD_SHARED_LIBRARY)
 
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := loc_eng_nmea_enc_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SHARED_LIBRARIES := \
+    libloc_eng \
+    libgps.utils
+
+LOCAL_SRC_FILES += \
+    test/loc_eng_nmea_enc_test.cpp
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := loc_eng_nmea_enc_bench
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SHARED_LIBRARIES := \
+    libloc_eng \
+    libgps.utils
+
+LOCAL_SRC_FILES += \
+    test/loc_eng_nmea_enc_bench.cpp
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+## gpsone_daemon stand-in, for a HAL built with
+## FEATURE_LOC_ENG_DMN_CONN_SOCKET
+LOCAL_MODULE := loc_eng_dmn_conn_stub_daemon
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES += \
+    test/loc_eng_dmn_conn_stub_daemon.c
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH) \
+    $(TARGET_OUT_HEADERS)/gps.utils
+
+include $(BUILD_EXECUTABLE)
+
+## libloc_eng, libloc_adapter and libgps.utils built into host tests,
+## which stand their own adapter in for the modem, see
+## LocApiAdapter::testAdapterFactory
+LOC_ENG_HOST_SRC_FILES := \
+    loc_eng.cpp \
+    loc_eng_agps.cpp \
+    loc_eng_xtra.cpp \
+    loc_eng_warm.cpp \
+    loc_eng_ni.cpp \
+    loc_eng_log.cpp \
+    loc_eng_nmea.cpp \
+    loc_eng_nmea_enc.cpp \
+    loc_eng_bin.cpp \
+    loc_eng_msg_stats.cpp \
+    loc_eng_conf_watch.cpp \
+    loc_eng_sensor_tuner.cpp \
+    loc_eng_batch.cpp \
+    loc_eng_dmn_conn.cpp \
+    loc_eng_dmn_conn_handler.cpp \
+    loc_eng_dmn_conn_thread_helper.c \
+    loc_eng_dmn_conn_glue_msg.c \
+    loc_eng_dmn_conn_glue_pipe.c \
+    loc_eng_dmn_conn_glue_sock.c \
+    loc_eng_msg_slab.cpp \
+    LocApiAdapter.cpp \
+    ReplayLocApiAdapter.cpp \
+    ../utils/loc_log.cpp \
+    ../utils/loc_cfg.cpp \
+    ../utils/loc_timer.c \
+    ../utils/msg_q.c \
+    ../utils/msg_q_ring.c \
+    ../utils/linked_list.c
+
+LOC_ENG_HOST_CFLAGS := \
+    -fno-short-enums \
+    -D_ANDROID_ \
+    -DNEW_QC_GPS \
+    -DLOC_TEST_ADAPTERS
+
+LOC_ENG_HOST_C_INCLUDES := \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/../utils \
+    device/samsung/msm8660-common/gps/ulp/inc
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := loc_eng_xtra_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_STATIC_LIBRARIES := \
+    libutils \
+    libcutils \
+    liblog
+
+LOCAL_LDLIBS := -lpthread -ldl -lrt
+
+LOCAL_SRC_FILES += \
+    test/loc_eng_xtra_test.cpp \
+    $(LOC_ENG_HOST_SRC_FILES)
+
+LOCAL_CFLAGS += $(LOC_ENG_HOST_CFLAGS)
+
+LOCAL_C_INCLUDES:= $(LOC_ENG_HOST_C_INCLUDES)
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := ReplayLocApiAdapter_bench
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_STATIC_LIBRARIES := \
+    libutils \
+    libcutils \
+    liblog
+
+LOCAL_LDLIBS := -lpthread -ldl -lrt
+
+LOCAL_SRC_FILES += \
+    test/ReplayLocApiAdapter_bench.cpp \
+    $(LOC_ENG_HOST_SRC_FILES)
+
+LOCAL_CFLAGS += $(LOC_ENG_HOST_CFLAGS)
+
+LOCAL_C_INCLUDES:= $(LOC_ENG_HOST_C_INCLUDES)
+
+include $(BUILD_HOST_EXECUTABLE)
+
 endif # not BUILD_TINY_ANDROID
@@ -31,8 +31,12 @@
 
 #include <dlfcn.h>
 #include <LocApiAdapter.h>
+#ifdef LOC_TEST_ADAPTERS
+#include <ReplayLocApiAdapter.h>
+#endif
 #include "loc_eng_msg.h"
 #include "loc_log.h"
+#include "loc_cfg.h"
 #include "loc_eng_ni.h"
 
 static void* noProc(void* data)
@@ -68,11 +72,37 @@ LocApiAdapter::~LocApiAdapter()
     LOC_LOGV("LocApiAdapter deleted");
 }
 
+#ifdef LOC_TEST_ADAPTERS
+LocApiAdapter* (*LocApiAdapter::testAdapterFactory)(LocEng &locEng) = NULL;
+#endif
+
 LocApiAdapter* LocApiAdapter::getLocApiAdapter(LocEng &locEng)
 {
     void* handle;
     LocApiAdapter* adapter = NULL;
 
+#ifdef LOC_TEST_ADAPTERS
+    if (NULL != testAdapterFactory) {
+        return testAdapterFactory(locEng);
+    }
+
+    // a recorded trace stands in for the modem, see ReplayLocApiAdapter.h
+    char replayTrace[LOC_MAX_PARAM_STRING + 1] = "";
+    uint32_t replaySpeed = 1;
+    loc_param_s_type replayTable[] =
+    {
+        {"REPLAY_TRACE", &replayTrace, NULL, 's'},
+        {"REPLAY_SPEED", &replaySpeed, NULL, 'n'},
+    };
+    loc_read_conf(GPS_CONF_FILE, replayTable, sizeof(replayTable) / sizeof(replayTable[0]));
+    if ('\0' != replayTrace[0]) {
+        adapter = ReplayLocApiAdapter::create(locEng, replayTrace, replaySpeed);
+        if (NULL != adapter) {
+            return adapter;
+        }
+    }
+#endif
+
     handle = dlopen ("libloc_api_v02.so", RTLD_NOW);
 
     if (!handle) {
@@ -174,6 +204,19 @@ void LocApiAdapter::reportSv(GpsSvStatus &svStatus, GpsLocationExtended &locatio
     }
 }
 
+void LocApiAdapter::reportSv(GpsSvStatus &svStatus, GpsLocationExtended &locationExtended, void* svExt,
+                             const uint32_t* svUsedMask)
+{
+    loc_eng_msg_report_sv *msg(new loc_eng_msg_report_sv(locEngHandle.owner, svStatus, locationExtended, svExt,
+                                                         svUsedMask));
+
+    if (locEngHandle.sendUlpMsg) {
+        locEngHandle.sendUlpMsg(locEngHandle.owner, msg);
+    } else {
+        locEngHandle.sendMsge(locEngHandle.owner, msg);
+    }
+}
+
 void LocApiAdapter::reportStatus(GpsStatusValue status)
 {
     loc_eng_msg_report_status *msg(new loc_eng_msg_report_status(locEngHandle.owner, status));
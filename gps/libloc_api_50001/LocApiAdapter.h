@@ -116,6 +116,11 @@ public:
     virtual ~LocApiAdapter();
 
     static LocApiAdapter* getLocApiAdapter(LocEng &locEng);
+#ifdef LOC_TEST_ADAPTERS
+    // if set, getLocApiAdapter() takes the adapter from it instead of
+    // the modem library, for tests and benches run on the host
+    static LocApiAdapter* (*testAdapterFactory)(LocEng &locEng);
+#endif
 
     static int hexcode(char *hexstring, int string_size,
                        const char *data, int data_size);
@@ -130,6 +135,13 @@ public:
     void reportSv(GpsSvStatus &svStatus,
                   GpsLocationExtended &locationExtended,
                   void* svExt);
+    // multi constellation flavor; svUsedMask is the used in fix bitmap
+    // for PRNs up to LOC_ENG_SV_USED_MASK_MAX_PRN, LOC_ENG_SV_USED_MASK_WORDS
+    // long, and overrides svStatus.used_in_fix_mask
+    void reportSv(GpsSvStatus &svStatus,
+                  GpsLocationExtended &locationExtended,
+                  void* svExt,
+                  const uint32_t* svUsedMask);
     void reportStatus(GpsStatusValue status);
     void reportNmea(const char* nmea, int length);
     void reportAgpsStatus(AGpsStatus &agpsStatus);
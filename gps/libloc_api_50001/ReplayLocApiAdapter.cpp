@@ -0,0 +1,339 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_replay"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ReplayLocApiAdapter.h>
+#include "log_util.h"
+
+#define REPLAY_LINE_MAX 1024
+
+// playback is paced on CLOCK_MONOTONIC, so that a time of day change
+// neither stalls nor rushes the trace
+static int64_t replayNowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// fixes are stamped in UTC
+static int64_t replayUtcMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int replayWaitUntil(pthread_cond_t* cond, pthread_mutex_t* mutex, int64_t dueMs)
+{
+    struct timespec due;
+    due.tv_sec = dueMs / 1000;
+    due.tv_nsec = (dueMs % 1000) * 1000000;
+#ifdef HAVE_PTHREAD_COND_TIMEDWAIT_MONOTONIC
+    return pthread_cond_timedwait_monotonic_np(cond, mutex, &due);
+#else
+    return pthread_cond_timedwait(cond, mutex, &due);
+#endif
+}
+
+ReplayLocApiAdapter::ReplayLocApiAdapter(LocEng &locEng, FILE* traceFile,
+                                         uint32_t replaySpeed) :
+    LocApiAdapter(locEng), trace(traceFile), speed(replaySpeed),
+    playing(false), quit(false)
+{
+    pthread_mutex_init(&mutex, NULL);
+#ifdef HAVE_PTHREAD_COND_TIMEDWAIT_MONOTONIC
+    pthread_cond_init(&cond, NULL);
+#else
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+#endif
+    pthread_create(&thread, NULL, threadMain, this);
+    LOC_LOGD("ReplayLocApiAdapter created, speed %u", speed);
+}
+
+ReplayLocApiAdapter::~ReplayLocApiAdapter()
+{
+    pthread_mutex_lock(&mutex);
+    quit = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+    pthread_join(thread, NULL);
+
+    fclose(trace);
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+    LOC_LOGV("ReplayLocApiAdapter deleted");
+}
+
+LocApiAdapter* ReplayLocApiAdapter::create(LocEng &locEng, const char* tracePath,
+                                           uint32_t replaySpeed)
+{
+    FILE* traceFile = fopen(tracePath, "r");
+    if (NULL == traceFile) {
+        LOC_LOGE("%s: open %s failed, %s", __func__, tracePath, strerror(errno));
+        return NULL;
+    }
+    LOC_LOGI("%s: replaying %s", __func__, tracePath);
+    return new ReplayLocApiAdapter(locEng, traceFile, replaySpeed);
+}
+
+void* ReplayLocApiAdapter::threadMain(void* arg)
+{
+    ((ReplayLocApiAdapter*)arg)->run();
+    return NULL;
+}
+
+// next event of the trace into line, without its time, starting over
+// at the end of the trace
+bool ReplayLocApiAdapter::readEvent(char* line, int size, int64_t &traceMs)
+{
+    bool rewound = false;
+
+    for (;;) {
+        if (NULL == fgets(line, size, trace)) {
+            if (rewound) {
+                return false;
+            }
+            rewind(trace);
+            rewound = true;
+            continue;
+        }
+
+        char* event;
+        traceMs = strtoll(line, &event, 10);
+        if (event == line || '#' == line[0]) {
+            continue;
+        }
+        while (' ' == *event || '\t' == *event) {
+            event++;
+        }
+        memmove(line, event, strlen(event) + 1);
+        return true;
+    }
+}
+
+void ReplayLocApiAdapter::run()
+{
+    char event[REPLAY_LINE_MAX];
+    bool pending = false;
+    bool rebase = true;
+    int64_t traceMs = 0, lastTraceMs = 0;
+    int64_t traceBaseMs = 0, wallBaseMs = 0;
+
+    pthread_mutex_lock(&mutex);
+    while (!quit) {
+        if (!playing) {
+            pthread_cond_wait(&cond, &mutex);
+            rebase = true;
+            continue;
+        }
+
+        if (!pending) {
+            if (!readEvent(event, sizeof(event), traceMs)) {
+                LOC_LOGE("%s: no events in the trace", __func__);
+                playing = false;
+                continue;
+            }
+            pending = true;
+        }
+
+        // paced from when the session started, or from where the trace
+        // started over
+        if (rebase || traceMs < lastTraceMs) {
+            traceBaseMs = traceMs;
+            wallBaseMs = replayNowMs();
+            rebase = false;
+        }
+
+        if (speed != 0) {
+            int64_t dueMs = wallBaseMs + (traceMs - traceBaseMs) / speed;
+            if (dueMs > replayNowMs()) {
+                replayWaitUntil(&cond, &mutex, dueMs);
+                // stopped or quit meanwhile, or simply due
+                continue;
+            }
+        }
+
+        pending = false;
+        lastTraceMs = traceMs;
+        pthread_mutex_unlock(&mutex);
+        playEvent(event);
+        pthread_mutex_lock(&mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void ReplayLocApiAdapter::playEvent(char* event)
+{
+    char type[16];
+    int n = 0;
+
+    event[strcspn(event, "\r\n")] = '\0';
+    if (sscanf(event, "%15s %n", type, &n) < 1) {
+        return;
+    }
+    char* args = event + n;
+
+    if (0 == strcmp(type, "POS")) {
+        GpsLocation location;
+        GpsLocationExtended locationExtended;
+        LocPosTechMask techMask = LOC_POS_TECH_MASK_SATELLITE;
+
+        memset(&location, 0, sizeof(location));
+        memset(&locationExtended, 0, sizeof(locationExtended));
+        location.size = sizeof(location);
+        locationExtended.size = sizeof(locationExtended);
+        if (sscanf(args, "%lf %lf %lf %f %f %f %x",
+                   &location.latitude, &location.longitude, &location.altitude,
+                   &location.accuracy, &location.speed, &location.bearing,
+                   &techMask) < 6) {
+            LOC_LOGE("%s: bad POS event: %s", __func__, args);
+            return;
+        }
+        location.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ALTITUDE |
+                         GPS_LOCATION_HAS_ACCURACY | GPS_LOCATION_HAS_SPEED |
+                         GPS_LOCATION_HAS_BEARING | LOCATION_HAS_SOURCE_INFO;
+        location.position_source = ULP_LOCATION_IS_FROM_GNSS;
+        location.timestamp = replayUtcMs();
+        reportPosition(location, locationExtended, NULL, LOC_SESS_SUCCESS, techMask);
+    } else if (0 == strcmp(type, "SV")) {
+        GpsSvStatus svStatus;
+        GpsLocationExtended locationExtended;
+        uint32_t svUsedMask[LOC_ENG_SV_USED_MASK_WORDS];
+        int num = 0;
+
+        memset(&svStatus, 0, sizeof(svStatus));
+        memset(&locationExtended, 0, sizeof(locationExtended));
+        svStatus.size = sizeof(svStatus);
+        locationExtended.size = sizeof(locationExtended);
+        if (sscanf(args, "%x %x %x %d %n", &svStatus.ephemeris_mask, &svStatus.almanac_mask,
+                   &svStatus.used_in_fix_mask, &num, &n) < 4 ||
+            num < 0 || num > GPS_MAX_SVS) {
+            LOC_LOGE("%s: bad SV event: %s", __func__, args);
+            return;
+        }
+        args += n;
+        for (int i = 0; i < num; i++) {
+            GpsSvInfo &sv = svStatus.sv_list[i];
+            sv.size = sizeof(sv);
+            if (sscanf(args, "%d %f %f %f %n", &sv.prn, &sv.snr, &sv.elevation,
+                       &sv.azimuth, &n) < 4) {
+                LOC_LOGE("%s: SV event is short of %d svs", __func__, num - i);
+                return;
+            }
+            args += n;
+        }
+        svStatus.num_svs = num;
+
+        // the used mask words, if given, cover GLONASS and the rest
+        // beyond the 32 PRNs of used_in_fix_mask
+        memset(svUsedMask, 0, sizeof(svUsedMask));
+        svUsedMask[0] = svStatus.used_in_fix_mask;
+        for (int i = 0; i < LOC_ENG_SV_USED_MASK_WORDS &&
+                 1 == sscanf(args, "%x %n", &svUsedMask[i], &n); i++) {
+            args += n;
+        }
+        reportSv(svStatus, locationExtended, NULL, svUsedMask);
+    } else if (0 == strcmp(type, "NMEA")) {
+        reportNmea(args, strlen(args));
+    } else if (0 == strcmp(type, "STATUS")) {
+        reportStatus((GpsStatusValue)atoi(args));
+    } else if (0 == strcmp(type, "ATL")) {
+        int handle, agpsType;
+        if (2 == sscanf(args, "%d %d", &handle, &agpsType)) {
+            requestATL(handle, (AGpsType)agpsType);
+        }
+    } else if (0 == strcmp(type, "ATL_RELEASE")) {
+        releaseATL(atoi(args));
+    } else if (0 == strcmp(type, "XTRA")) {
+        requestXtraData();
+    } else {
+        LOC_LOGW("%s: unknown event %s", __func__, type);
+    }
+}
+
+enum loc_api_adapter_err ReplayLocApiAdapter::reinit()
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err ReplayLocApiAdapter::startFix()
+{
+    pthread_mutex_lock(&mutex);
+    playing = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err ReplayLocApiAdapter::stopFix()
+{
+    pthread_mutex_lock(&mutex);
+    playing = false;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err ReplayLocApiAdapter::setPositionMode(const LocPosMode *posMode)
+{
+    if (NULL != posMode) {
+        fixCriteria = *posMode;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err ReplayLocApiAdapter::setTime(GpsUtcTime time, int64_t timeReference,
+                                                      int uncertainty)
+{
+    LOC_LOGD("%s: %lld, uncertainty %d ms, ignored", __func__, (long long)time, uncertainty);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err ReplayLocApiAdapter::injectPosition(double latitude, double longitude,
+                                                             float accuracy)
+{
+    LOC_LOGD("%s: %f, %f, accuracy %f m, ignored", __func__, latitude, longitude, accuracy);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err ReplayLocApiAdapter::setXtraData(char* data, int length)
+{
+    LOC_LOGD("%s: %d bytes, ignored", __func__, length);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
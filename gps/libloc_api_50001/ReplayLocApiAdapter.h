@@ -0,0 +1,92 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef REPLAY_LOC_API_ADAPTER_H
+#define REPLAY_LOC_API_ADAPTER_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <LocApiAdapter.h>
+
+/* Stands in for the modem by playing back a recorded trace, picked by
+   REPLAY_TRACE in gps.conf. Only built with LOC_TEST_ADAPTERS, which
+   libloc_adapter sets for eng and userdebug builds. A trace is a text
+   file, one event per line, led by its time in ms from the start of
+   the trace:
+
+     <ms> POS <lat> <lon> <alt> <accuracy> <speed> <bearing> [<tech mask>]
+     <ms> SV <eph mask> <alm mask> <used mask> <n> { <prn> <snr> <elev> <azim> } * n
+             [ <used mask word> * LOC_ENG_SV_USED_MASK_WORDS ]
+     <ms> NMEA <sentence>
+     <ms> STATUS <GpsStatusValue>
+     <ms> ATL <handle> <AGpsType>
+     <ms> ATL_RELEASE <handle>
+     <ms> XTRA
+
+   Blank lines and lines starting with '#' are skipped. Events play
+   while a session is on, REPLAY_SPEED times as fast as they were
+   recorded, or back to back with REPLAY_SPEED 0. The trace starts over
+   when it runs out. Fixes are stamped with the time they are played.
+
+   The used mask words of an SV event are the used in fix bitmap of
+   PRNs 1 to LOC_ENG_SV_USED_MASK_MAX_PRN, GLONASS included, and take
+   over from <used mask>; words left out are taken as no SV used. */
+
+class ReplayLocApiAdapter : public LocApiAdapter {
+    FILE* trace;
+    const uint32_t speed;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool playing;
+    bool quit;
+
+    static void* threadMain(void* arg);
+    void run();
+    bool readEvent(char* line, int size, int64_t &traceMs);
+    void playEvent(char* event);
+
+public:
+    ReplayLocApiAdapter(LocEng &locEng, FILE* traceFile, uint32_t replaySpeed);
+    virtual ~ReplayLocApiAdapter();
+
+    static LocApiAdapter* create(LocEng &locEng, const char* tracePath,
+                                 uint32_t replaySpeed);
+
+    virtual enum loc_api_adapter_err reinit();
+    virtual enum loc_api_adapter_err startFix();
+    virtual enum loc_api_adapter_err stopFix();
+    virtual enum loc_api_adapter_err setPositionMode(const LocPosMode *posMode);
+    virtual enum loc_api_adapter_err setTime(GpsUtcTime time, int64_t timeReference,
+                                             int uncertainty);
+    virtual enum loc_api_adapter_err injectPosition(double latitude, double longitude,
+                                                    float accuracy);
+    virtual enum loc_api_adapter_err setXtraData(char* data, int length);
+};
+
+#endif // REPLAY_LOC_API_ADAPTER_H
@@ -143,12 +143,34 @@ static const AGpsRilInterface sLocEngAGpsRilInterface =
 
 static bool loc_inject_raw_command(char* command, int length);
 
+static size_t loc_get_internal_state(char* buffer, size_t bufferSize);
+
+static const GpsDebugInterface sLocEngDebugInterface =
+{
+    sizeof(GpsDebugInterface),
+    loc_get_internal_state
+};
+
 static const InjectRawCmdInterface sLocEngInjectRawCmdInterface =
 {
    sizeof(InjectRawCmdInterface),
    loc_inject_raw_command
 };
 
+static int loc_batching_init(GpsBatchingCallbacks* callbacks);
+static int loc_batching_start(uint32_t flush_period_ms);
+static int loc_batching_stop();
+static size_t loc_batching_read_batch(GpsLocation* fixes, size_t max_fixes);
+
+static const GpsBatchingInterface sLocEngBatchingInterface =
+{
+   sizeof(GpsBatchingInterface),
+   loc_batching_init,
+   loc_batching_start,
+   loc_batching_stop,
+   loc_batching_read_batch
+};
+
 //ULP/Hybrid provider interfaces
 static const UlpNetworkInterface sUlpNetworkInterface =
 {
@@ -293,7 +315,10 @@ static void loc_free_msg(void* msg)
 void loc_ulp_msg_sender(void* loc_eng_data_p, void* msg)
 {
     LocEngContext* loc_eng_context = (LocEngContext*)((loc_eng_data_s_type*)loc_eng_data_p)->context;
-    msg_q_snd((void*)loc_eng_context->ulp_q, msg, loc_free_msg);
+    if (eMSG_Q_SUCCESS != msg_q_snd((void*)loc_eng_context->ulp_q, msg, loc_free_msg)) {
+        LOC_LOGE("%s: %s not queued", __func__, loc_get_msg_name(((loc_eng_msg*)msg)->msgid));
+        loc_free_msg(msg);
+    }
 }
 
 /*===========================================================================
@@ -620,6 +645,11 @@ static const void* loc_get_extension(const char* name)
       ret_val = &sLocEngNiInterface;
    }
 
+   else if (strcmp(name, GPS_DEBUG_INTERFACE) == 0)
+   {
+      ret_val = &sLocEngDebugInterface;
+   }
+
    else if (strcmp(name, AGPS_RIL_INTERFACE) == 0)
    {
        char baseband[PROPERTY_VALUE_MAX];
@@ -633,6 +663,10 @@ static const void* loc_get_extension(const char* name)
    {
       ret_val = &sLocEngInjectRawCmdInterface;
    }
+   else if (strcmp(name, GPS_BATCHING_INTERFACE) == 0)
+   {
+      ret_val = &sLocEngBatchingInterface;
+   }
    else if(strcmp(name, ULP_PHONE_CONTEXT_INTERFACE) == 0)
    {
      ret_val = &sLocEngUlpPhoneContextInterface;
@@ -652,6 +686,30 @@ static const void* loc_get_extension(const char* name)
     return ret_val;
 }
 
+/*===========================================================================
+FUNCTION    loc_get_internal_state
+
+DESCRIPTION
+   Dump the engine's deferred thread latency stats, for gps-debug.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   number of bytes written into buffer
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static size_t loc_get_internal_state(char* buffer, size_t bufferSize)
+{
+    ENTRY_LOG();
+    size_t ret_val = loc_eng_get_internal_state(loc_afw_data, buffer, bufferSize);
+    EXIT_LOG(%d, (int)ret_val);
+    return ret_val;
+}
+
 /*===========================================================================
 FUNCTION    loc_agps_init
 
@@ -945,6 +1003,106 @@ static bool loc_inject_raw_command(char* command, int length)
     return ret_val;
 }
 
+/*===========================================================================
+FUNCTION    loc_batching_init
+
+DESCRIPTION
+   Initialize the fix batching module.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_batching_init(GpsBatchingCallbacks* callbacks)
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_batch_init(loc_afw_data, callbacks);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_batching_start
+
+DESCRIPTION
+   Starts collecting fixes into the batch instead of reporting them.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_batching_start(uint32_t flush_period_ms)
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_batch_start(loc_afw_data, flush_period_ms);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_batching_stop
+
+DESCRIPTION
+   Stops collecting fixes, they are reported again.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_batching_stop()
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_batch_stop(loc_afw_data);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_batching_read_batch
+
+DESCRIPTION
+   Moves the oldest batched fixes into the given array.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of fixes moved
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static size_t loc_batching_read_batch(GpsLocation* fixes, size_t max_fixes)
+{
+    ENTRY_LOG();
+    size_t ret_val = loc_eng_batch_read(loc_afw_data, fixes, max_fixes);
+
+    EXIT_LOG(%d, (int)ret_val);
+    return ret_val;
+}
+
 
 static void loc_cb(GpsLocation* location, void* locExt)
 {
@@ -36,6 +36,8 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
+#include <float.h>
 #include <pthread.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>         /* struct sockaddr_in */
@@ -58,6 +60,10 @@
 #include <loc_eng_msg.h>
 #include <loc_eng_msg_id.h>
 #include <loc_eng_nmea.h>
+#include <loc_eng_bin.h>
+#include <loc_eng_msg_stats.h>
+#include <loc_eng_conf_watch.h>
+#include <loc_eng_sensor_tuner.h>
 #include <msg_q.h>
 #include <loc.h>
 
@@ -67,9 +73,24 @@
 #define SUCCESS TRUE
 #define FAILURE FALSE
 
+// max number of msgs the deferred thread takes off its q per wakeup
+#define LOC_ENG_MSG_BATCH_MAX 32
+// fixes may come this fraction of min_interval early and still be
+// reported, the modem's own fix times jitter a little
+#define LOC_ENG_FIX_INTERVAL_SLACK 10
+
 static void loc_eng_deferred_action_thread(void* context);
-static void* loc_eng_create_msg_q();
+static void loc_eng_agps_action_thread(void* context);
+static bool loc_eng_is_agps_msg(int msgid);
+static void* loc_eng_create_msg_q(msg_q_type type);
 static void loc_eng_free_msg(void* msg);
+static int loc_eng_msg_snd(const void* msg_q, void* msg);
+static void loc_eng_report_snd(LocEngContext* context, loc_eng_msg* msg);
+
+// queued to deferred_q when report_q has reports for the deferred thread;
+// never freed, its dealloc is NULL
+static char loc_eng_reports_pending;
+#define LOC_ENG_REPORTS_PENDING ((loc_eng_msg*)&loc_eng_reports_pending)
 
 pthread_mutex_t LocEngContext::lock = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t LocEngContext::cond = PTHREAD_COND_INITIALIZER;
@@ -77,6 +98,17 @@ LocEngContext* LocEngContext::me = NULL;
 boolean gpsConfigAlreadyRead = false;
 
 loc_gps_cfg_s_type gps_conf;
+// gps.conf as last read by the config watcher, which gps_conf catches up
+// with once the deferred thread gets to the update
+static loc_gps_cfg_s_type loc_eng_reloaded_conf;
+// held by the deferred thread while it adopts a reloaded gps.conf, and
+// by anyone else reading the settings a reload can change; settings
+// that need a restart are never written after init
+static pthread_mutex_t loc_eng_conf_lock = PTHREAD_MUTEX_INITIALIZER;
+// SENSOR_AUTO_TUNE needs a restart, so one tuner serves every
+// loc_eng_init; the deferred thread may still be feeding it from before
+// a cleanup, freeing it there would pull it out from under that thread
+static LocEngSensorTuner* loc_eng_sensor_tuner = NULL;
 
 /* Parameter spec table */
 static loc_param_s_type loc_parameter_table[] =
@@ -105,58 +137,125 @@ static loc_param_s_type loc_parameter_table[] =
   {"SENSOR_ALGORITHM_CONFIG_MASK",   &gps_conf.SENSOR_ALGORITHM_CONFIG_MASK,   NULL, 'n'},
   {"QUIPC_ENABLED",                  &gps_conf.QUIPC_ENABLED,                  NULL, 'n'},
   {"LPP_PROFILE",                    &gps_conf.LPP_PROFILE,                    NULL, 'n'},
+  {"BINARY_FIX_STREAM",              &gps_conf.BINARY_FIX_STREAM,              NULL, 's'},
+  {"CONFIG_RELOAD",                  &gps_conf.CONFIG_RELOAD,                  NULL, 'n'},
+  {"SENSOR_AUTO_TUNE",               &gps_conf.SENSOR_AUTO_TUNE,               NULL, 'n'},
+  {"XTRA_CACHE",                     &gps_conf.XTRA_CACHE,                     NULL, 's'},
+  {"XTRA_CACHE_VALIDITY",            &gps_conf.XTRA_CACHE_VALIDITY,            NULL, 'n'},
+  {"WARM_START_CACHE",               &gps_conf.WARM_START_CACHE,               NULL, 's'},
+};
+
+/* Limits of the parameters above, in the same order */
+static const loc_param_range_s_type loc_parameter_ranges[] =
+{
+  {0, 1},                   /* INTERMEDIATE_POS */
+  {0, INT_MAX},             /* ACCURACY_THRES */
+  {0, 1},                   /* ENABLE_WIPER */
+  {0, 1},                   /* NMEA_PROVIDER */
+  LOC_PARAM_NO_RANGE,       /* SUPL_VER */
+  LOC_PARAM_NO_RANGE,       /* CAPABILITIES */
+  {0, DBL_MAX},             /* GYRO_BIAS_RANDOM_WALK */
+  {0, DBL_MAX},             /* ACCEL_RANDOM_WALK_SPECTRAL_DENSITY */
+  {0, DBL_MAX},             /* ANGLE_RANDOM_WALK_SPECTRAL_DENSITY */
+  {0, DBL_MAX},             /* RATE_RANDOM_WALK_SPECTRAL_DENSITY */
+  {0, DBL_MAX},             /* VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY */
+  {1, 65535},               /* SENSOR_ACCEL_BATCHES_PER_SEC */
+  {1, 65535},               /* SENSOR_ACCEL_SAMPLES_PER_BATCH */
+  {1, 65535},               /* SENSOR_GYRO_BATCHES_PER_SEC */
+  {1, 65535},               /* SENSOR_GYRO_SAMPLES_PER_BATCH */
+  {1, 65535},               /* SENSOR_ACCEL_BATCHES_PER_SEC_HIGH */
+  {1, 65535},               /* SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH */
+  {1, 65535},               /* SENSOR_GYRO_BATCHES_PER_SEC_HIGH */
+  {1, 65535},               /* SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH */
+  {0, 1},                   /* SENSOR_CONTROL_MODE */
+  {0, 1},                   /* SENSOR_USAGE */
+  LOC_PARAM_NO_RANGE,       /* SENSOR_ALGORITHM_CONFIG_MASK */
+  {0, 2},                   /* QUIPC_ENABLED */
+  {0, 3},                   /* LPP_PROFILE */
+  LOC_PARAM_NO_RANGE,       /* BINARY_FIX_STREAM */
+  {0, 1},                   /* CONFIG_RELOAD */
+  {0, 1},                   /* SENSOR_AUTO_TUNE */
+  LOC_PARAM_NO_RANGE,       /* XTRA_CACHE */
+  {1, 336},                 /* XTRA_CACHE_VALIDITY */
+  LOC_PARAM_NO_RANGE,       /* WARM_START_CACHE */
 };
 
-static void loc_default_parameters(void)
+/* The two tables above must stay the same length */
+typedef char loc_parameter_ranges_size_check[
+    (sizeof(loc_parameter_ranges) / sizeof(loc_parameter_ranges[0]) ==
+     sizeof(loc_parameter_table) / sizeof(loc_parameter_table[0])) ? 1 : -1];
+
+static void loc_default_parameters(loc_gps_cfg_s_type &conf)
 {
    /* defaults */
-   gps_conf.INTERMEDIATE_POS = 0;
-   gps_conf.ACCURACY_THRES = 0;
-   gps_conf.ENABLE_WIPER = 0;
-   gps_conf.NMEA_PROVIDER = 0;
-   gps_conf.SUPL_VER = 0x10000;
-   gps_conf.CAPABILITIES = 0x7;
-
-   gps_conf.GYRO_BIAS_RANDOM_WALK = 0;
-   gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC = 2;
-   gps_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH = 5;
-   gps_conf.SENSOR_GYRO_BATCHES_PER_SEC = 2;
-   gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH = 5;
-   gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH = 4;
-   gps_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH = 25;
-   gps_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH = 4;
-   gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH = 25;
-   gps_conf.SENSOR_CONTROL_MODE = 0; /* AUTO */
-   gps_conf.SENSOR_USAGE = 0; /* Enabled */
-   gps_conf.SENSOR_ALGORITHM_CONFIG_MASK = 0; /* INS Disabled = FALSE*/
+   conf.INTERMEDIATE_POS = 0;
+   conf.ACCURACY_THRES = 0;
+   conf.ENABLE_WIPER = 0;
+   conf.NMEA_PROVIDER = 0;
+   conf.SUPL_VER = 0x10000;
+   conf.CAPABILITIES = 0x7;
+
+   conf.GYRO_BIAS_RANDOM_WALK = 0;
+   conf.SENSOR_ACCEL_BATCHES_PER_SEC = 2;
+   conf.SENSOR_ACCEL_SAMPLES_PER_BATCH = 5;
+   conf.SENSOR_GYRO_BATCHES_PER_SEC = 2;
+   conf.SENSOR_GYRO_SAMPLES_PER_BATCH = 5;
+   conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH = 4;
+   conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH = 25;
+   conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH = 4;
+   conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH = 25;
+   conf.SENSOR_CONTROL_MODE = 0; /* AUTO */
+   conf.SENSOR_USAGE = 0; /* Enabled */
+   conf.SENSOR_ALGORITHM_CONFIG_MASK = 0; /* INS Disabled = FALSE*/
+   conf.SENSOR_AUTO_TUNE = 0; /* rates as configured */
 
    /* Values MUST be set by OEMs in configuration for sensor-assisted
       navigation to work. There are NO default values */
-   gps_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   gps_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   gps_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY = 0;
+   conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY = 0;
+   conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
+   conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
+   conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY = 0;
 
-   gps_conf.GYRO_BIAS_RANDOM_WALK_VALID = 0;
-   gps_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   gps_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   gps_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
+   conf.GYRO_BIAS_RANDOM_WALK_VALID = 0;
+   conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
+   conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
+   conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
+   conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
 
       /* LTE Positioning Profile configuration is disable by default*/
-   gps_conf.LPP_PROFILE = 0;
+   conf.LPP_PROFILE = 0;
+
+   /* No binary fix stream */
+   conf.BINARY_FIX_STREAM[0] = '\0';
+
+   /* no XTRA cache, XTRA files are good for 7 days */
+   conf.XTRA_CACHE[0] = '\0';
+   conf.XTRA_CACHE_VALIDITY = 168;
+   conf.WARM_START_CACHE[0] = '\0';
+
+   /* gps.conf is read once unless asked to follow it */
+   conf.CONFIG_RELOAD = 0;
 }
 
 LocEngContext::LocEngContext(gps_create_thread threadCreator) :
-    deferred_q((const void*)loc_eng_create_msg_q()),
+    deferred_q((const void*)loc_eng_create_msg_q(eMSG_Q_TYPE_LIST)),
+    report_q((const void*)loc_eng_create_msg_q(eMSG_Q_TYPE_RING)),
+    reportsPending(0),
     //TODO: should we conditionally create ulp msg q?
-    ulp_q((const void*)loc_eng_create_msg_q()),
+    ulp_q((const void*)loc_eng_create_msg_q(eMSG_Q_TYPE_LIST)),
+    agps_q((const void*)loc_eng_create_msg_q(eMSG_Q_TYPE_LIST)),
     deferred_action_thread(threadCreator("loc_eng",loc_eng_deferred_action_thread, this)),
-    counter(0)
+    agps_action_thread(threadCreator("loc_eng_agps",loc_eng_agps_action_thread, this)),
+    msg_slab(new LocEngMsgSlab()),
+    msg_stats(new LocEngMsgStats()),
+    counter(0),
+    deferredRunning(true),
+    agpsRunning(true)
 {
-    LOC_LOGV("LocEngContext %d : %d pthread_id %ld\n",
+    loc_eng_msg::setSlab(msg_slab);
+    LOC_LOGV("LocEngContext %d : %d pthread_id %ld agps %ld\n",
              getpid(), gettid(),
-             deferred_action_thread);
+             deferred_action_thread, agps_action_thread);
 }
 
 LocEngContext* LocEngContext::get(gps_create_thread threadCreator)
@@ -174,20 +273,36 @@ LocEngContext* LocEngContext::get(gps_create_thread threadCreator)
 
 void LocEngContext::drop()
 {
-    if (deferred_action_thread != pthread_self()) {
+    if (deferred_action_thread != pthread_self() &&
+        agps_action_thread != pthread_self()) {
         pthread_mutex_lock(&lock);
         counter--;
         if (counter == 0) {
+            // the deferred thread goes first, it still forwards to agps_q
             loc_eng_msg *msg(new loc_eng_msg(this, LOC_ENG_MSG_QUIT));
-            msg_q_snd((void*)deferred_q, msg, loc_eng_free_msg);
+            loc_eng_msg_snd((void*)deferred_q, msg);
+            while (deferredRunning) {
+                pthread_cond_wait(&cond, &lock);
+            }
 
-            // I am not sure if this is going to be hazardous. The calling thread
-            // might be blocked for a while, if the q is loaded.  I am wondering
-            // if we should just dump all the msgs in the q upon QUIT.
-            pthread_cond_wait(&cond, &lock);
+            loc_eng_msg *agps_msg(new loc_eng_msg(this, LOC_ENG_MSG_QUIT));
+            loc_eng_msg_snd((void*)agps_q, agps_msg);
+
+            // the framework creates the action threads detached, so there
+            // is nothing to join; both have freed their last message once
+            // they are out, the queues and the slab have to outlive that
+            while (agpsRunning) {
+                pthread_cond_wait(&cond, &lock);
+            }
 
+            msg_q_destroy((void**)&agps_q);
             msg_q_destroy((void**)&deferred_q);
+            msg_q_destroy((void**)&report_q);
             msg_q_destroy((void**)&ulp_q);
+            msg_slab->logStats();
+            loc_eng_msg::setSlab(NULL);
+            delete msg_slab;
+            delete msg_stats;
             delete me;
             me = NULL;
         }
@@ -197,9 +312,29 @@ void LocEngContext::drop()
     }
 }
 
+void LocEngContext::deferredThreadExited()
+{
+    threadExited(deferredRunning);
+}
+
+void LocEngContext::agpsThreadExited()
+{
+    threadExited(agpsRunning);
+}
+
+void LocEngContext::threadExited(bool& running)
+{
+    pthread_mutex_lock(&lock);
+    running = false;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
 // 2nd half of init(), singled out for
 // modem restart to use.
 static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data);
+static void loc_eng_conf_snapshot(loc_gps_cfg_s_type &conf);
+static void loc_eng_adopt_config(const loc_gps_cfg_s_type &conf);
 static void loc_eng_agps_reinit(loc_eng_data_s_type &loc_eng_data);
 
 static int loc_eng_set_server(loc_eng_data_s_type &loc_eng_data,
@@ -212,6 +347,13 @@ static void loc_eng_report_status(loc_eng_data_s_type &loc_eng_data,
 static void loc_eng_process_conn_request(loc_eng_data_s_type &loc_eng_data,
                                          int connHandle, AGpsType agps_type);
 static void loc_eng_agps_close_status(loc_eng_data_s_type &loc_eng_data, int is_succ);
+static void loc_eng_set_sensor_perf_control(loc_eng_data_s_type &loc_eng_data,
+                                            int controlMode,
+                                            int accelSamplesPerBatch, int accelBatchesPerSec,
+                                            int gyroSamplesPerBatch, int gyroBatchesPerSec,
+                                            int accelSamplesPerBatchHigh, int accelBatchesPerSecHigh,
+                                            int gyroSamplesPerBatchHigh, int gyroBatchesPerSecHigh,
+                                            int algorithmConfig);
 static void loc_eng_handle_engine_down(loc_eng_data_s_type &loc_eng_data) ;
 static void loc_eng_handle_engine_up(loc_eng_data_s_type &loc_eng_data) ;
 
@@ -232,13 +374,23 @@ static char extra_data[100];
 void loc_eng_msg_sender(void* loc_eng_data_p, void* msg)
 {
     LocEngContext* loc_eng_context = (LocEngContext*)((loc_eng_data_s_type*)loc_eng_data_p)->context;
-    msg_q_snd((void*)loc_eng_context->deferred_q, msg, loc_eng_free_msg);
+    int msgid = ((loc_eng_msg*)msg)->msgid;
+    ((loc_eng_msg*)msg)->enqueueTime = loc_eng_msg_now();
+    if (LOC_ENG_MSG_REPORT_SV == msgid ||
+        LOC_ENG_MSG_REPORT_NMEA == msgid ||
+        LOC_ENG_MSG_REPORT_POSITION == msgid) {
+        loc_eng_report_snd(loc_eng_context, (loc_eng_msg*)msg);
+    } else {
+        loc_eng_msg_snd(loc_eng_is_agps_msg(msgid) ?
+                        (void*)loc_eng_context->agps_q : (void*)loc_eng_context->deferred_q,
+                        msg);
+    }
 }
 
-static void* loc_eng_create_msg_q()
+static void* loc_eng_create_msg_q(msg_q_type type)
 {
     void* q = NULL;
-    if (eMSG_Q_SUCCESS != msg_q_init(&q)) {
+    if (eMSG_Q_SUCCESS != msg_q_init_type(&q, type, MSG_Q_RING_DEFAULT_CAPACITY)) {
         LOC_LOGE("loc_eng_create_msg_q Q init failed.");
         q = NULL;
     }
@@ -250,6 +402,66 @@ static void loc_eng_free_msg(void* msg)
     delete (loc_eng_msg*)msg;
 }
 
+// a message the queue refuses, e.g. unblocked, is still ours to free;
+// returns 0 if msg is queued, -1 if not
+static int loc_eng_msg_snd(const void* msg_q, void* msg)
+{
+    msq_q_err_type rv = msg_q_snd((void*)msg_q, msg, loc_eng_free_msg);
+    if (eMSG_Q_SUCCESS != rv) {
+        LOC_LOGE("%s: %s not queued, error %d", __func__,
+                 loc_get_msg_name(((loc_eng_msg*)msg)->msgid), rv);
+        loc_eng_free_msg(msg);
+        return -1;
+    }
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_report_snd
+
+DESCRIPTION
+   Queues a report to report_q without taking a lock, and wakes up the
+   deferred thread through deferred_q unless a wakeup is on its way
+   already. When report_q is full, SV and NMEA reports and intermediate
+   fixes are dropped, as the next one supersedes them; anything else,
+   i.e. final fixes and failures, goes to deferred_q.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_report_snd(LocEngContext* context, loc_eng_msg* msg)
+{
+    if (eMSG_Q_SUCCESS != msg_q_snd((void*)context->report_q, msg, loc_eng_free_msg)) {
+        loc_eng_msg_report_position* rpMsg = (loc_eng_msg_report_position*)msg;
+        if (LOC_ENG_MSG_REPORT_POSITION != msg->msgid) {
+            delete msg;
+        } else if (LOC_SESS_INTERMEDIATE == rpMsg->status &&
+                   NULL == rpMsg->locationExt) {
+            delete (char*)rpMsg->location.rawData;
+            delete msg;
+        } else {
+            loc_eng_msg_snd(context->deferred_q, msg);
+        }
+        return;
+    }
+
+    // the deferred thread clears reportsPending before it drains report_q,
+    // so a report is either drained or followed by a wakeup of its own
+    if (0 == __atomic_exchange_n(&context->reportsPending, 1, __ATOMIC_SEQ_CST)) {
+        if (eMSG_Q_SUCCESS != msg_q_snd((void*)context->deferred_q,
+                                        LOC_ENG_REPORTS_PENDING, NULL)) {
+            LOC_LOGE("%s: report wakeup not queued", __func__);
+        }
+    }
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_init
 
@@ -316,6 +528,16 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
         loc_eng_data.generateNmea = false;
     }
 
+    // binary fix stream is opened along with the first record
+    loc_eng_data.binStream = ('\0' != gps_conf.BINARY_FIX_STREAM[0]);
+
+    if (gps_conf.SENSOR_AUTO_TUNE) {
+        if (NULL == loc_eng_sensor_tuner) {
+            loc_eng_sensor_tuner = new LocEngSensorTuner();
+        }
+        loc_eng_data.sensorTuner = loc_eng_sensor_tuner;
+    }
+
     LocEng locEngHandle(&loc_eng_data, event, loc_eng_data.acquire_wakelock_cb,
                         loc_eng_data.release_wakelock_cb, loc_eng_msg_sender, loc_external_msg_sender,
                         callbacks->location_ext_parser, callbacks->sv_ext_parser);
@@ -337,6 +559,10 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
            LOC_LOGD("loc_eng_init client open failed, %d more tries", tries);
            sleep(1);
        }
+
+       if (LOC_API_ADAPTER_ERR_SUCCESS == ret_val && gps_conf.CONFIG_RELOAD) {
+           loc_eng_conf_watch_start(loc_eng_data, callbacks->create_thread_cb);
+       }
     }
 
     EXIT_LOG(%d, ret_val);
@@ -347,62 +573,64 @@ static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data)
 {
     ENTRY_LOG();
     int ret_val = loc_eng_data.client_handle->reinit();
+    loc_gps_cfg_s_type conf;
+    loc_eng_conf_snapshot(conf);
 
     if (LOC_API_ADAPTER_ERR_SUCCESS == ret_val) {
         LOC_LOGD("loc_eng_reinit reinit() successful");
 
         loc_eng_msg_suple_version *supl_msg(new loc_eng_msg_suple_version(&loc_eng_data,
-                                                                          gps_conf.SUPL_VER));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  supl_msg, loc_eng_free_msg);
+                                                                          conf.SUPL_VER));
+        loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                        supl_msg);
 
         loc_eng_msg_lpp_config *lpp_msg(new loc_eng_msg_lpp_config(&loc_eng_data,
-                                                                          gps_conf.LPP_PROFILE));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  lpp_msg, loc_eng_free_msg);
+                                                                          conf.LPP_PROFILE));
+        loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                        lpp_msg);
 
         loc_eng_msg_sensor_control_config *sensor_control_config_msg(
-            new loc_eng_msg_sensor_control_config(&loc_eng_data, gps_conf.SENSOR_USAGE));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  sensor_control_config_msg, loc_eng_free_msg);
+            new loc_eng_msg_sensor_control_config(&loc_eng_data, conf.SENSOR_USAGE));
+        loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                        sensor_control_config_msg);
 
         /* Make sure at least one of the sensor property is specified by the user in the gps.conf file. */
-        if( gps_conf.GYRO_BIAS_RANDOM_WALK_VALID ||
-            gps_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
-            gps_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
-            gps_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
-            gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID )
+        if( conf.GYRO_BIAS_RANDOM_WALK_VALID ||
+            conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+            conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+            conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+            conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID )
         {
             loc_eng_msg_sensor_properties *sensor_properties_msg(
                 new loc_eng_msg_sensor_properties(&loc_eng_data,
-                                                   gps_conf.GYRO_BIAS_RANDOM_WALK_VALID,
-                                                   gps_conf.GYRO_BIAS_RANDOM_WALK,
-                                                   gps_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
-                                                   gps_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,
-                                                   gps_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
-                                                   gps_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,
-                                                   gps_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
-                                                   gps_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY,
-                                                   gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
-                                                   gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY));
-            msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                      sensor_properties_msg, loc_eng_free_msg);
+                                                   conf.GYRO_BIAS_RANDOM_WALK_VALID,
+                                                   conf.GYRO_BIAS_RANDOM_WALK,
+                                                   conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                   conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                   conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                   conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                   conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                   conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                   conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                   conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY));
+            loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                            sensor_properties_msg);
         }
 
         loc_eng_msg_sensor_perf_control_config *sensor_perf_control_conf_msg(
             new loc_eng_msg_sensor_perf_control_config(&loc_eng_data,
-                                                       gps_conf.SENSOR_CONTROL_MODE,
-                                                       gps_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH,
-                                                       gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC,
-                                                       gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH,
-                                                       gps_conf.SENSOR_GYRO_BATCHES_PER_SEC,
-                                                       gps_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH,
-                                                       gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,
-                                                       gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
-                                                       gps_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
-                                                       gps_conf.SENSOR_ALGORITHM_CONFIG_MASK));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  sensor_perf_control_conf_msg, loc_eng_free_msg);
+                                                       conf.SENSOR_CONTROL_MODE,
+                                                       conf.SENSOR_ACCEL_SAMPLES_PER_BATCH,
+                                                       conf.SENSOR_ACCEL_BATCHES_PER_SEC,
+                                                       conf.SENSOR_GYRO_SAMPLES_PER_BATCH,
+                                                       conf.SENSOR_GYRO_BATCHES_PER_SEC,
+                                                       conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH,
+                                                       conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,
+                                                       conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
+                                                       conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
+                                                       conf.SENSOR_ALGORITHM_CONFIG_MASK));
+        loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                        sensor_perf_control_conf_msg);
     }
 
     EXIT_LOG(%d, ret_val);
@@ -430,6 +658,9 @@ void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data)
     ENTRY_LOG_CALLFLOW();
     INIT_CHECK(loc_eng_data.context, return);
 
+    // no reload may reach the deferred queue from here on
+    loc_eng_conf_watch_stop();
+
     // XTRA has no state, so we are fine with it.
 
     // we need to check and clear NI
@@ -450,6 +681,11 @@ void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data)
         loc_eng_stop(loc_eng_data);
     }
 
+    if (loc_eng_data.binStream) {
+        loc_eng_data.binStream = false;
+        loc_eng_bin_close();
+    }
+
 #if 0 // can't afford to actually clean up, for many reason.
 
     ((LocEngContext*)(loc_eng_data.context))->drop();
@@ -498,6 +734,7 @@ DEPENDENCIES
 
 RETURN VALUE
    0: success
+   -1: the request could not be queued
 
 SIDE EFFECTS
    N/A
@@ -507,21 +744,22 @@ int loc_eng_start(loc_eng_data_s_type &loc_eng_data)
 {
    ENTRY_LOG_CALLFLOW();
    INIT_CHECK(loc_eng_data.context, return -1);
+   int ret_val = 0;
 
    if((loc_eng_data.ulp_initialized == true) && (gps_conf.CAPABILITIES & ULP_CAPABILITY))
    {
        //Pass the start messgage to ULP if present & activated
        loc_eng_msg *msg(new loc_eng_msg(&loc_eng_data, ULP_MSG_START_FIX));
-       msg_q_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q,
-                  msg, loc_eng_free_msg);
+       ret_val = loc_eng_msg_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q,
+                                  msg);
    }else
    {
        loc_eng_msg *msg(new loc_eng_msg(&loc_eng_data, LOC_ENG_MSG_START_FIX));
-       msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                 msg, loc_eng_free_msg);
+       ret_val = loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                                 msg);
    }
-   EXIT_LOG(%d, 0);
-   return 0;
+   EXIT_LOG(%d, ret_val);
+   return ret_val;
 }
 
 static int loc_eng_start_handler(loc_eng_data_s_type &loc_eng_data)
@@ -530,6 +768,8 @@ static int loc_eng_start_handler(loc_eng_data_s_type &loc_eng_data)
    int ret_val = LOC_API_ADAPTER_ERR_SUCCESS;
 
    if (!loc_eng_data.client_handle->isInSession()) {
+       loc_eng_data.lastFixReportNs = 0;
+       loc_eng_warm_inject(loc_eng_data);
        ret_val = loc_eng_data.client_handle->startFix();
 
        if (ret_val == LOC_API_ADAPTER_ERR_SUCCESS ||
@@ -555,6 +795,7 @@ DEPENDENCIES
 
 RETURN VALUE
    0: success
+   -1: the request could not be queued
 
 SIDE EFFECTS
    N/A
@@ -564,22 +805,52 @@ int loc_eng_stop(loc_eng_data_s_type &loc_eng_data)
 {
     ENTRY_LOG_CALLFLOW();
     INIT_CHECK(loc_eng_data.context, return -1);
+    int ret_val = 0;
 
     if((loc_eng_data.ulp_initialized == true) && (gps_conf.CAPABILITIES & ULP_CAPABILITY))
     {
         //Pass the start messgage to ULP if present & activated
         loc_eng_msg *msg(new loc_eng_msg(&loc_eng_data, ULP_MSG_STOP_FIX));
-        msg_q_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q,
-                   msg, loc_eng_free_msg);
+        ret_val = loc_eng_msg_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q,
+                                   msg);
     }else
     {
         loc_eng_msg *msg(new loc_eng_msg(&loc_eng_data, LOC_ENG_MSG_STOP_FIX));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  msg, loc_eng_free_msg);
+        ret_val = loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                                  msg);
     }
 
-    EXIT_LOG(%d, 0);
-    return 0;
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_get_internal_state
+
+DESCRIPTION
+   Dump the deferred thread latency histograms, per msgid, into buffer.
+   Backs GpsDebugInterface.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of bytes written, not counting the NUL
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+size_t loc_eng_get_internal_state(loc_eng_data_s_type &loc_eng_data,
+                                  char* buffer, size_t bufferSize)
+{
+    ENTRY_LOG();
+    INIT_CHECK(loc_eng_data.context, return 0);
+
+    int len = ((LocEngContext*)(loc_eng_data.context))->msg_stats->dump(buffer, (int)bufferSize);
+
+    EXIT_LOG(%d, len);
+    return (size_t)len;
 }
 
 static int loc_eng_stop_handler(loc_eng_data_s_type &loc_eng_data)
@@ -596,8 +867,11 @@ static int loc_eng_stop_handler(loc_eng_data_s_type &loc_eng_data)
        }
 
        loc_eng_data.client_handle->setInSession(FALSE);
+       loc_eng_warm_save(loc_eng_data);
    }
 
+    ((LocEngContext*)(loc_eng_data.context))->msg_slab->logStats();
+
     EXIT_LOG(%d, ret_val);
     return ret_val;
 }
@@ -636,6 +910,7 @@ DEPENDENCIES
 
 RETURN VALUE
    0: success
+   -1: the request could not be queued
 
 SIDE EFFECTS
    N/A
@@ -646,13 +921,14 @@ int loc_eng_set_position_mode(loc_eng_data_s_type &loc_eng_data,
 {
     ENTRY_LOG_CALLFLOW();
     INIT_CHECK(loc_eng_data.context, return -1);
+    int ret_val = 0;
     loc_eng_msg_position_mode *msg(
         new loc_eng_msg_position_mode(&loc_eng_data, params));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    ret_val = loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                              msg);
 
-    EXIT_LOG(%d, 0);
-    return 0;
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
 }
 
 /*===========================================================================
@@ -676,15 +952,16 @@ int loc_eng_inject_time(loc_eng_data_s_type &loc_eng_data, GpsUtcTime time,
 {
     ENTRY_LOG_CALLFLOW();
     INIT_CHECK(loc_eng_data.context, return -1);
+    int ret_val = 0;
     loc_eng_msg_set_time *msg(
         new loc_eng_msg_set_time(&loc_eng_data,
                                  time,
                                  timeReference,
                                  uncertainty));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
-    EXIT_LOG(%d, 0);
-    return 0;
+    ret_val = loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                              msg);
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
 }
 
 
@@ -709,16 +986,17 @@ int loc_eng_inject_location(loc_eng_data_s_type &loc_eng_data, double latitude,
 {
     ENTRY_LOG_CALLFLOW();
     INIT_CHECK(loc_eng_data.context, return -1);
+    int ret_val = 0;
     loc_eng_msg_inject_location *msg(
         new loc_eng_msg_inject_location(&loc_eng_data,
                                         latitude,
                                         longitude,
                                         accuracy));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    ret_val = loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                              msg);
 
-    EXIT_LOG(%d, 0);
-    return 0;
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
 }
 
 
@@ -750,8 +1028,8 @@ void loc_eng_delete_aiding_data(loc_eng_data_s_type &loc_eng_data, GpsAidingData
     loc_eng_msg_delete_aiding_data *msg(
         new loc_eng_msg_delete_aiding_data(&loc_eng_data,
                                            f));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                    msg);
 
     EXIT_LOG(%s, VOID_RET);
 }
@@ -917,8 +1195,8 @@ int loc_eng_agps_open(loc_eng_data_s_type &loc_eng_data, AGpsType agpsType,
     loc_eng_msg_atl_open_success *msg(
         new loc_eng_msg_atl_open_success(&loc_eng_data, agpsType, apn,
                                         apn_len, bearerType));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->agps_q,
+                    msg);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -948,8 +1226,8 @@ int loc_eng_agps_closed(loc_eng_data_s_type &loc_eng_data, AGpsType agpsType)
                return -1);
 
     loc_eng_msg_atl_closed *msg(new loc_eng_msg_atl_closed(&loc_eng_data, agpsType));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->agps_q,
+                    msg);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -979,8 +1257,8 @@ int loc_eng_agps_open_failed(loc_eng_data_s_type &loc_eng_data, AGpsType agpsTyp
                return -1);
 
     loc_eng_msg_atl_open_failed *msg(new loc_eng_msg_atl_open_failed(&loc_eng_data, agpsType));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->agps_q,
+                    msg);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -1059,8 +1337,8 @@ static int loc_eng_set_server(loc_eng_data_s_type &loc_eng_data,
         if (sizeof(url) > len) {
             loc_eng_msg_set_server_url *msg(new loc_eng_msg_set_server_url(&loc_eng_data,
                                                                            url, len));
-            msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                      msg, loc_eng_free_msg);
+            loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                            msg);
         }
     } else if (LOC_AGPS_CDMA_PDE_SERVER == type ||
                LOC_AGPS_CUSTOM_PDE_SERVER == type ||
@@ -1076,8 +1354,8 @@ static int loc_eng_set_server(loc_eng_data_s_type &loc_eng_data,
                                                                              ip,
                                                                              port,
                                                                              type));
-            msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                      msg, loc_eng_free_msg);
+            loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                            msg);
         }
     } else {
         LOC_LOGE("loc_eng_set_server, type %d cannot be resolved.\n", type);
@@ -1169,8 +1447,8 @@ void loc_eng_agps_ril_update_network_availability(loc_eng_data_s_type &loc_eng_d
         int apn_len = smaller_of(strlen (apn), MAX_APN_LEN);
         loc_eng_msg_set_data_enable *msg(new loc_eng_msg_set_data_enable(&loc_eng_data, apn,
                                                                          apn_len, available));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  msg, loc_eng_free_msg);
+        loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
+                        msg);
     }
     EXIT_LOG(%s, VOID_RET);
 }
@@ -1265,6 +1543,8 @@ void loc_eng_handle_engine_down(loc_eng_data_s_type &loc_eng_data)
 {
     ENTRY_LOG();
     loc_eng_ni_reset_on_engine_restart(loc_eng_data);
+    // the modem comes back without what was injected
+    loc_eng_data.warm_data.injected = FALSE;
     loc_eng_report_status(loc_eng_data, GPS_STATUS_ENGINE_OFF);
     EXIT_LOG(%s, VOID_RET);
 }
@@ -1275,8 +1555,9 @@ void loc_eng_handle_engine_up(loc_eng_data_s_type &loc_eng_data)
     loc_eng_reinit(loc_eng_data);
 
     if (loc_eng_data.agps_status_cb != NULL) {
-        loc_eng_data.agnss_nif->dropAllSubscribers();
-        loc_eng_data.internet_nif->dropAllSubscribers();
+        loc_eng_msg *msg(new loc_eng_msg(&loc_eng_data, LOC_ENG_MSG_DROP_AGPS_SUBSCRIBERS));
+        loc_eng_msg_snd((void*)((LocEngContext*)(loc_eng_data.context))->agps_q,
+                        msg);
 
         loc_eng_agps_reinit(loc_eng_data);
     }
@@ -1293,6 +1574,456 @@ void loc_eng_handle_engine_up(loc_eng_data_s_type &loc_eng_data)
     EXIT_LOG(%s, VOID_RET);
 }
 
+/*===========================================================================
+FUNCTION loc_eng_coalesce_sv_reports
+
+DESCRIPTION
+   Drops every LOC_ENG_MSG_REPORT_SV in a batch of received messages that is
+   followed by a newer one for the same instance, so when the deferred
+   thread falls behind it only delivers the latest SV snapshot. Dropped
+   messages are freed and their entries set to NULL.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_coalesce_sv_reports(loc_eng_msg* msgs[], unsigned int num)
+{
+    for (unsigned int i = num; i-- > 1; ) {
+        if (NULL == msgs[i] || LOC_ENG_MSG_REPORT_SV != msgs[i]->msgid) {
+            continue;
+        }
+        for (unsigned int j = i; j-- > 0; ) {
+            if (NULL != msgs[j] &&
+                LOC_ENG_MSG_REPORT_SV == msgs[j]->msgid &&
+                msgs[i]->owner == msgs[j]->owner) {
+                LOC_LOGV("%s:%d] dropping stale SV report %p\n",
+                         __func__, __LINE__, msgs[j]);
+                delete msgs[j];
+                msgs[j] = NULL;
+            }
+        }
+    }
+}
+
+/*===========================================================================
+FUNCTION loc_eng_coalesce_intermediate_fixes
+
+DESCRIPTION
+   Drops every intermediate LOC_ENG_MSG_REPORT_POSITION in a batch of
+   received messages that is followed by a newer fix for the same
+   instance, as the newer one supersedes it. Failure reports supersede
+   nothing, and fixes with a locationExt are left alone as only the
+   location_cb consumer knows how to free that. Dropped messages are
+   freed and their entries set to NULL.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_coalesce_intermediate_fixes(loc_eng_msg* msgs[], unsigned int num)
+{
+    for (unsigned int i = num; i-- > 1; ) {
+        loc_eng_msg_report_position *rpMsg = (loc_eng_msg_report_position*)msgs[i];
+        if (NULL == rpMsg || LOC_ENG_MSG_REPORT_POSITION != rpMsg->msgid ||
+            LOC_SESS_FAILURE == rpMsg->status) {
+            continue;
+        }
+        for (unsigned int j = i; j-- > 0; ) {
+            loc_eng_msg_report_position *oldMsg = (loc_eng_msg_report_position*)msgs[j];
+            if (NULL != oldMsg &&
+                LOC_ENG_MSG_REPORT_POSITION == oldMsg->msgid &&
+                LOC_SESS_INTERMEDIATE == oldMsg->status &&
+                NULL == oldMsg->locationExt &&
+                rpMsg->owner == oldMsg->owner) {
+                LOC_LOGV("%s:%d] dropping superseded intermediate fix %p\n",
+                         __func__, __LINE__, oldMsg);
+                delete (char*)oldMsg->location.rawData;
+                delete oldMsg;
+                msgs[j] = NULL;
+            }
+        }
+        // anything older was looked at for this one already
+        break;
+    }
+}
+
+/*===========================================================================
+FUNCTION loc_eng_decimate_fix
+
+DESCRIPTION
+   Tells whether a fix comes before the min_interval the framework asked
+   for is up since the last one reported. The modem runs at its own rate,
+   at least MIN_POSSIBLE_FIX_INTERVAL, and may send fixes more often than
+   asked for; those are not worth waking up the apps for.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   true if the fix is to be held back
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_decimate_fix(const loc_eng_data_s_type &loc_eng_data,
+                                 const loc_eng_msg_report_position *rpMsg,
+                                 int64_t now)
+{
+    const LocPosMode& mode = loc_eng_data.client_handle->getPositionMode();
+
+    if (0 == loc_eng_data.lastFixReportNs ||
+        LOC_SESS_FAILURE == rpMsg->status ||
+        GPS_POSITION_RECURRENCE_PERIODIC != mode.recurrence ||
+        mode.min_interval <= MIN_POSSIBLE_FIX_INTERVAL) {
+        return false;
+    }
+
+    int64_t interval = (int64_t)mode.min_interval * 1000000;
+    return now - loc_eng_data.lastFixReportNs <
+        interval - interval / LOC_ENG_FIX_INTERVAL_SLACK;
+}
+
+/*===========================================================================
+FUNCTION loc_eng_is_agps_msg
+
+DESCRIPTION
+   Tells the messages that drive the AGPS state machines, which the AGPS
+   thread handles, from those for the deferred thread.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   true for messages for the AGPS thread
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_is_agps_msg(int msgid)
+{
+    switch (msgid) {
+    case LOC_ENG_MSG_REQUEST_BIT:
+    case LOC_ENG_MSG_RELEASE_BIT:
+    case LOC_ENG_MSG_REQUEST_ATL:
+    case LOC_ENG_MSG_RELEASE_ATL:
+    case LOC_ENG_MSG_REQUEST_WIFI:
+    case LOC_ENG_MSG_RELEASE_WIFI:
+    case LOC_ENG_MSG_ATL_OPEN_SUCCESS:
+    case LOC_ENG_MSG_ATL_CLOSED:
+    case LOC_ENG_MSG_ATL_OPEN_FAILED:
+    case LOC_ENG_MSG_DROP_AGPS_SUBSCRIBERS:
+        return true;
+    }
+    return false;
+}
+
+/*===========================================================================
+FUNCTION loc_eng_handle_agps_msg
+
+DESCRIPTION
+   Feeds a message into the agnss_nif, internet_nif or wifi_nif state
+   machine. Their subscribers and servicers call out to the framework to
+   bring data connections up and down, which can take a while.
+
+DEPENDENCIES
+   Runs on the AGPS thread only, which thereby owns the state machines.
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_handle_agps_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    switch(msg->msgid) {
+    case LOC_ENG_MSG_REQUEST_BIT:
+    {
+        AgpsStateMachine* stateMachine;
+        loc_eng_msg_request_bit* brqMsg = (loc_eng_msg_request_bit*)msg;
+        if (brqMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_SUPL) {
+            stateMachine = loc_eng_data_p->agnss_nif;
+        } else if (brqMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_ANY) {
+            stateMachine = loc_eng_data_p->internet_nif;
+        } else {
+            LOC_LOGD("%s]%d: unknown I/F request type = 0x%x\n", __func__, __LINE__, brqMsg->ifType);
+            break;
+        }
+        BITSubscriber subscriber(stateMachine, brqMsg->ipv4Addr, brqMsg->ipv6Addr);
+
+        stateMachine->subscribeRsrc((Subscriber*)&subscriber);
+    }
+    break;
+
+    case LOC_ENG_MSG_RELEASE_BIT:
+    {
+        AgpsStateMachine* stateMachine;
+        loc_eng_msg_release_bit* brlMsg = (loc_eng_msg_release_bit*)msg;
+        if (brlMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_SUPL) {
+            stateMachine = loc_eng_data_p->agnss_nif;
+        } else if (brlMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_ANY) {
+            stateMachine = loc_eng_data_p->internet_nif;
+        } else {
+            LOC_LOGD("%s]%d: unknown I/F request type = 0x%x\n", __func__, __LINE__, brlMsg->ifType);
+            break;
+        }
+        BITSubscriber subscriber(stateMachine, brlMsg->ipv4Addr, brlMsg->ipv6Addr);
+
+        stateMachine->unsubscribeRsrc((Subscriber*)&subscriber);
+    }
+    break;
+
+    case LOC_ENG_MSG_REQUEST_ATL:
+    {
+        loc_eng_msg_request_atl* arqMsg = (loc_eng_msg_request_atl*)msg;
+        boolean backwardCompatibleMode = AGPS_TYPE_INVALID == arqMsg->type;
+        AgpsStateMachine* stateMachine = (AGPS_TYPE_SUPL == arqMsg->type ||
+                                          backwardCompatibleMode) ?
+                                         loc_eng_data_p->agnss_nif :
+                                         loc_eng_data_p->internet_nif;
+        ATLSubscriber subscriber(arqMsg->handle,
+                                 stateMachine,
+                                 loc_eng_data_p->client_handle,
+                                 backwardCompatibleMode);
+
+        stateMachine->subscribeRsrc((Subscriber*)&subscriber);
+    }
+    break;
+
+    case LOC_ENG_MSG_RELEASE_ATL:
+    {
+        loc_eng_msg_release_atl* arlMsg = (loc_eng_msg_release_atl*)msg;
+        ATLSubscriber s1(arlMsg->handle,
+                         loc_eng_data_p->agnss_nif,
+                         loc_eng_data_p->client_handle,
+                         false);
+        // attempt to unsubscribe from agnss_nif first
+        if (! loc_eng_data_p->agnss_nif->unsubscribeRsrc((Subscriber*)&s1)) {
+            ATLSubscriber s2(arlMsg->handle,
+                             loc_eng_data_p->internet_nif,
+                             loc_eng_data_p->client_handle,
+                             false);
+            // if unsuccessful, try internet_nif
+            loc_eng_data_p->internet_nif->unsubscribeRsrc((Subscriber*)&s2);
+        }
+    }
+    break;
+
+    case LOC_ENG_MSG_REQUEST_WIFI:
+    {
+        loc_eng_msg_request_wifi *wrqMsg = (loc_eng_msg_request_wifi *)msg;
+        if (wrqMsg->senderId == LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC ||
+            wrqMsg->senderId == LOC_ENG_IF_REQUEST_SENDER_ID_MSAPM) {
+          AgpsStateMachine* stateMachine = loc_eng_data_p->wifi_nif;
+          WIFISubscriber subscriber(stateMachine, wrqMsg->ssid, wrqMsg->password, wrqMsg->senderId);
+          stateMachine->subscribeRsrc((Subscriber*)&subscriber);
+        } else {
+          LOC_LOGE("%s]%d ERROR: unknown sender ID", __func__, __LINE__);
+          break;
+        }
+    }
+    break;
+
+    case LOC_ENG_MSG_RELEASE_WIFI:
+    {
+        AgpsStateMachine* stateMachine = loc_eng_data_p->wifi_nif;
+        loc_eng_msg_release_wifi* wrlMsg = (loc_eng_msg_release_wifi*)msg;
+        WIFISubscriber subscriber(stateMachine, wrlMsg->ssid, wrlMsg->password, wrlMsg->senderId);
+        stateMachine->unsubscribeRsrc((Subscriber*)&subscriber);
+    }
+    break;
+
+    case LOC_ENG_MSG_ATL_OPEN_SUCCESS:
+    {
+        loc_eng_msg_atl_open_success *aosMsg = (loc_eng_msg_atl_open_success*)msg;
+        AgpsStateMachine* stateMachine;
+        switch (aosMsg->agpsType) {
+          case AGPS_TYPE_WIFI: {
+            stateMachine = loc_eng_data_p->wifi_nif;
+            break;
+          }
+          case AGPS_TYPE_SUPL: {
+            stateMachine = loc_eng_data_p->agnss_nif;
+            break;
+          }
+          default: {
+            stateMachine  = loc_eng_data_p->internet_nif;
+          }
+        }
+
+        stateMachine->setBearer(aosMsg->bearerType);
+        stateMachine->setAPN(aosMsg->apn, aosMsg->length);
+        stateMachine->onRsrcEvent(RSRC_GRANTED);
+    }
+    break;
+
+    case LOC_ENG_MSG_ATL_CLOSED:
+    {
+        loc_eng_msg_atl_closed *acsMsg = (loc_eng_msg_atl_closed*)msg;
+        AgpsStateMachine* stateMachine;
+        switch (acsMsg->agpsType) {
+          case AGPS_TYPE_WIFI: {
+            stateMachine = loc_eng_data_p->wifi_nif;
+            break;
+          }
+          case AGPS_TYPE_SUPL: {
+            stateMachine = loc_eng_data_p->agnss_nif;
+            break;
+          }
+          default: {
+            stateMachine  = loc_eng_data_p->internet_nif;
+          }
+        }
+
+        stateMachine->onRsrcEvent(RSRC_RELEASED);
+    }
+    break;
+
+    case LOC_ENG_MSG_ATL_OPEN_FAILED:
+    {
+        loc_eng_msg_atl_open_failed *aofMsg = (loc_eng_msg_atl_open_failed*)msg;
+        AgpsStateMachine* stateMachine;
+        switch (aofMsg->agpsType) {
+          case AGPS_TYPE_WIFI: {
+            stateMachine = loc_eng_data_p->wifi_nif;
+            break;
+          }
+          case AGPS_TYPE_SUPL: {
+            stateMachine = loc_eng_data_p->agnss_nif;
+            break;
+          }
+          default: {
+            stateMachine  = loc_eng_data_p->internet_nif;
+          }
+        }
+
+        stateMachine->onRsrcEvent(RSRC_DENIED);
+    }
+    break;
+
+    case LOC_ENG_MSG_DROP_AGPS_SUBSCRIBERS:
+        loc_eng_data_p->agnss_nif->dropAllSubscribers();
+        loc_eng_data_p->internet_nif->dropAllSubscribers();
+        break;
+
+    default:
+        LOC_LOGE("%s: unexpected msg %s", __func__, loc_get_msg_name(msg->msgid));
+        break;
+    }
+}
+
+/*===========================================================================
+FUNCTION loc_eng_agps_action_thread
+
+DESCRIPTION
+   Main routine for the thread running the AGPS state machines, so that
+   data connection bring up never holds up the fixes and SV reports in
+   deferred_q.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_agps_action_thread(void* arg)
+{
+    ENTRY_LOG();
+    LocEngContext* context = (LocEngContext*)arg;
+    loc_eng_msg *msg;
+
+    while (1)
+    {
+        msq_q_err_type result = msg_q_rcv((void*)context->agps_q, (void **) &msg);
+        if (eMSG_Q_SUCCESS != result) {
+            LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
+                     loc_get_msg_q_status(result));
+            context->agpsThreadExited();
+            return;
+        }
+
+        if (LOC_ENG_MSG_QUIT == msg->msgid) {
+            delete msg;
+            context->agpsThreadExited();
+            EXIT_LOG(%s, "LOC_ENG_MSG_QUIT, signal the main thread and return");
+            return;
+        }
+
+        loc_eng_data_s_type* loc_eng_data_p = (loc_eng_data_s_type*)msg->owner;
+        int64_t handlerStart = loc_eng_msg_now();
+
+        LOC_LOGD("%s:%d] received msg_id = %s context = %p\n",
+                 __func__, __LINE__, loc_get_msg_name(msg->msgid), loc_eng_data_p->context);
+
+        if (NULL != loc_eng_data_p->context) {
+            loc_eng_handle_agps_msg(loc_eng_data_p, msg);
+        } else {
+            LOC_LOGE("%s: instance cleanup happened", __func__);
+        }
+
+        context->msg_stats->record(msg->msgid, msg->enqueueTime,
+                                   handlerStart, loc_eng_msg_now());
+        delete msg;
+    }
+}
+
+/*===========================================================================
+FUNCTION loc_eng_set_sensor_perf_control
+
+DESCRIPTION
+   Hands the sensor rates to the modem. While the sensor tuner has the
+   normal profile on, the high rate filter is held to the normal rates.
+   Must be called from the deferred thread.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_set_sensor_perf_control(loc_eng_data_s_type &loc_eng_data,
+                                            int controlMode,
+                                            int accelSamplesPerBatch, int accelBatchesPerSec,
+                                            int gyroSamplesPerBatch, int gyroBatchesPerSec,
+                                            int accelSamplesPerBatchHigh, int accelBatchesPerSecHigh,
+                                            int gyroSamplesPerBatchHigh, int gyroBatchesPerSecHigh,
+                                            int algorithmConfig)
+{
+    bool high = NULL == loc_eng_data.sensorTuner ||
+        LocEngSensorTuner::PROFILE_HIGH == loc_eng_data.sensorTuner->profile();
+    loc_eng_data.client_handle->setSensorPerfControlConfig(controlMode, accelSamplesPerBatch, accelBatchesPerSec,
+                                                           gyroSamplesPerBatch, gyroBatchesPerSec,
+                                                           high ? accelSamplesPerBatchHigh : accelSamplesPerBatch,
+                                                           high ? accelBatchesPerSecHigh : accelBatchesPerSec,
+                                                           high ? gyroSamplesPerBatchHigh : gyroSamplesPerBatch,
+                                                           high ? gyroBatchesPerSecHigh : gyroBatchesPerSec,
+                                                           algorithmConfig);
+}
+
 /*===========================================================================
 FUNCTION loc_eng_deferred_action_thread
 
@@ -1313,6 +2044,11 @@ static void loc_eng_deferred_action_thread(void* arg)
 {
     ENTRY_LOG();
     loc_eng_msg *msg;
+    loc_eng_msg *msgs[LOC_ENG_MSG_BATCH_MAX];
+    loc_eng_msg *ctrl_msgs[LOC_ENG_MSG_BATCH_MAX / 2];
+    unsigned int num_msgs = 0;
+    unsigned int next_msg = 0;
+    bool more_reports = false;
     static int cnt = 0;
     LocEngContext* context = (LocEngContext*)arg;
 
@@ -1321,37 +2057,88 @@ static void loc_eng_deferred_action_thread(void* arg)
 
     while (1)
     {
-        LOC_LOGD("%s:%d] %d listening ...\n", __func__, __LINE__, cnt++);
+        if (next_msg >= num_msgs) {
+            LOC_LOGD_RL(1000, "%s:%d] %d listening ...\n", __func__, __LINE__, cnt++);
+            unsigned int num_ctrl = 0;
+            unsigned int num_reports = 0;
+
+            // we are only sending / receiving msg pointers, take
+            // everything that piled up since the last wakeup; wait
+            // only if report_q was drained last time
+            msq_q_err_type result = more_reports ?
+                msg_q_try_rcv_batch((void*)context->deferred_q, (void **) ctrl_msgs,
+                                    LOC_ENG_MSG_BATCH_MAX / 2, &num_ctrl) :
+                msg_q_rcv_batch((void*)context->deferred_q, (void **) ctrl_msgs,
+                                LOC_ENG_MSG_BATCH_MAX / 2, &num_ctrl);
+            if (eMSG_Q_SUCCESS == result) {
+                __atomic_store_n(&context->reportsPending, 0, __ATOMIC_SEQ_CST);
+                result = msg_q_try_rcv_batch((void*)context->report_q, (void **) msgs,
+                                             LOC_ENG_MSG_BATCH_MAX - num_ctrl,
+                                             &num_reports);
+            }
+            if (eMSG_Q_SUCCESS != result) {
+                LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
+                         loc_get_msg_q_status(result));
+                context->deferredThreadExited();
+                return;
+            }
+            more_reports = (num_reports == LOC_ENG_MSG_BATCH_MAX - num_ctrl);
+
+            // reports first, they were mostly sent before whatever
+            // control msgs came in with them
+            num_msgs = num_reports;
+            for (unsigned int i = 0; i < num_ctrl; i++) {
+                if (LOC_ENG_REPORTS_PENDING != ctrl_msgs[i]) {
+                    msgs[num_msgs++] = ctrl_msgs[i];
+                }
+            }
+            loc_eng_coalesce_sv_reports(msgs, num_msgs);
+            loc_eng_coalesce_intermediate_fixes(msgs, num_msgs);
+            next_msg = 0;
+            if (0 == num_msgs) {
+                // a wakeup for reports taken with the batch before
+                continue;
+            }
+        }
 
-        // we are only sending / receiving msg pointers
-        msq_q_err_type result = msg_q_rcv((void*)context->deferred_q, (void **) &msg);
-        if (eMSG_Q_SUCCESS != result) {
-            LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
-                     loc_get_msg_q_status(result));
+        msg = msgs[next_msg++];
+        if (NULL == msg) {
+            // superseded by a newer message of the same batch
+            continue;
+        }
+
+        // owned by the context, not by an instance
+        if (LOC_ENG_MSG_QUIT == msg->msgid) {
+            // whatever came in behind QUIT would otherwise be flushed
+            // by msg_q_destroy, it is ours to free now
+            delete msg;
+            while (next_msg < num_msgs) {
+                delete msgs[next_msg++];
+            }
+            context->deferredThreadExited();
+            EXIT_LOG(%s, "LOC_ENG_MSG_QUIT, signal the main thread and return");
             return;
         }
 
+        // queued here by someone who did not go through loc_eng_msg_sender
+        if (loc_eng_is_agps_msg(msg->msgid)) {
+            loc_eng_msg_snd((void*)context->agps_q, msg);
+            continue;
+        }
+
         loc_eng_data_s_type* loc_eng_data_p = (loc_eng_data_s_type*)msg->owner;
+        int64_t handlerStart = loc_eng_msg_now();
 
         LOC_LOGD("%s:%d] received msg_id = %s context = %p\n",
                  __func__, __LINE__, loc_get_msg_name(msg->msgid), loc_eng_data_p->context);
 
-        // need to ensure the instance data is valid
+        // need to ensure the instance data is valid; stay around for
+        // the QUIT that drop() is waiting on
         STATE_CHECK(NULL != loc_eng_data_p->context,
                     "instance cleanup happened",
-                    delete msg; return);
+                    delete msg; continue);
 
         switch(msg->msgid) {
-        case LOC_ENG_MSG_QUIT:
-        {
-            LocEngContext* context = (LocEngContext*)loc_eng_data_p->context;
-            pthread_mutex_lock(&(context->lock));
-            pthread_cond_signal(&(context->cond));
-            pthread_mutex_unlock(&(context->lock));
-            EXIT_LOG(%s, "LOC_ENG_MSG_QUIT, signal the main thread and return");
-        }
-        return;
-
         case LOC_ENG_MSG_REQUEST_NI:
         {
             loc_eng_msg_request_ni *niMsg = (loc_eng_msg_request_ni*)msg;
@@ -1434,6 +2221,14 @@ static void loc_eng_deferred_action_thread(void* arg)
         }
         break;
 
+        case LOC_ENG_MSG_RUNTIME_CONFIG:
+        {
+            loc_eng_msg_runtime_config *rcMsg = (loc_eng_msg_runtime_config*)msg;
+            loc_eng_adopt_config(*(const loc_gps_cfg_s_type*)rcMsg->conf);
+            loc_eng_data_p->intermediateFix = gps_conf.INTERMEDIATE_POS;
+        }
+        break;
+
         case LOC_ENG_MSG_SET_SENSOR_CONTROL_CONFIG:
         {
             loc_eng_msg_sensor_control_config *sccMsg = (loc_eng_msg_sensor_control_config*)msg;
@@ -1460,11 +2255,12 @@ static void loc_eng_deferred_action_thread(void* arg)
         case LOC_ENG_MSG_SET_SENSOR_PERF_CONTROL_CONFIG:
         {
             loc_eng_msg_sensor_perf_control_config *spccMsg = (loc_eng_msg_sensor_perf_control_config*)msg;
-            loc_eng_data_p->client_handle->setSensorPerfControlConfig(spccMsg->controlMode, spccMsg->accelSamplesPerBatch, spccMsg->accelBatchesPerSec,
-                                                                      spccMsg->gyroSamplesPerBatch, spccMsg->gyroBatchesPerSec,
-                                                                      spccMsg->accelSamplesPerBatchHigh, spccMsg->accelBatchesPerSecHigh,
-                                                                      spccMsg->gyroSamplesPerBatchHigh, spccMsg->gyroBatchesPerSecHigh,
-                                                                      spccMsg->algorithmConfig);
+            loc_eng_set_sensor_perf_control(*loc_eng_data_p, spccMsg->controlMode,
+                                            spccMsg->accelSamplesPerBatch, spccMsg->accelBatchesPerSec,
+                                            spccMsg->gyroSamplesPerBatch, spccMsg->gyroBatchesPerSec,
+                                            spccMsg->accelSamplesPerBatchHigh, spccMsg->accelBatchesPerSecHigh,
+                                            spccMsg->gyroSamplesPerBatchHigh, spccMsg->gyroBatchesPerSecHigh,
+                                            spccMsg->algorithmConfig);
         }
         break;
 
@@ -1480,7 +2276,10 @@ static void loc_eng_deferred_action_thread(void* arg)
             {
                 bool reported = false;
                 loc_eng_msg_report_position *rpMsg = (loc_eng_msg_report_position*)msg;
-                if (loc_eng_data_p->location_cb != NULL) {
+                int64_t now = loc_eng_msg_now();
+                // sooner than the framework asked for
+                bool decimated = loc_eng_decimate_fix(*loc_eng_data_p, rpMsg, now);
+                if (loc_eng_data_p->location_cb != NULL && !decimated) {
                     if (LOC_SESS_FAILURE == rpMsg->status) {
                         // in case we want to handle the failure case
                         loc_eng_data_p->location_cb(NULL, NULL);
@@ -1507,9 +2306,17 @@ static void loc_eng_deferred_action_thread(void* arg)
                               !((rpMsg->location.flags & GPS_LOCATION_HAS_ACCURACY) &&
                                 (gps_conf.ACCURACY_THRES != 0) &&
                                 (rpMsg->location.accuracy > gps_conf.ACCURACY_THRES)))) {
-                        loc_eng_data_p->location_cb((GpsLocation*)&(rpMsg->location),
-                                                    (void*)rpMsg->locationExt);
+                        // while batching, the client reads the fix later
+                        if (!loc_eng_batch_add_fix(*loc_eng_data_p, rpMsg->location, now)) {
+                            loc_eng_data_p->location_cb((GpsLocation*)&(rpMsg->location),
+                                                        (void*)rpMsg->locationExt);
+                        }
+                        loc_eng_data_p->lastFixReportNs = now;
                         reported = true;
+                        if (LOC_SESS_SUCCESS == rpMsg->status) {
+                            loc_eng_warm_record_fix(*loc_eng_data_p, rpMsg->location,
+                                                    rpMsg->bootMs);
+                        }
                     }
                 }
 
@@ -1527,11 +2334,35 @@ static void loc_eng_deferred_action_thread(void* arg)
                     loc_eng_data_p->client_handle->setInSession(false);
                 }
 
-                if (loc_eng_data_p->generateNmea && rpMsg->location.position_source == ULP_LOCATION_IS_FROM_GNSS)
+                if (loc_eng_data_p->generateNmea && !decimated &&
+                    rpMsg->location.position_source == ULP_LOCATION_IS_FROM_GNSS)
                 {
                     loc_eng_nmea_generate_pos(loc_eng_data_p, rpMsg->location, rpMsg->locationExtended);
                 }
 
+                if (loc_eng_data_p->binStream && rpMsg->location.position_source == ULP_LOCATION_IS_FROM_GNSS)
+                {
+                    loc_eng_bin_report_fix(loc_eng_data_p, rpMsg->location, rpMsg->locationExtended);
+                }
+
+                if (NULL != loc_eng_data_p->sensorTuner &&
+                    LOC_SESS_FAILURE != rpMsg->status &&
+                    rpMsg->location.position_source == ULP_LOCATION_IS_FROM_GNSS &&
+                    loc_eng_data_p->sensorTuner->update(rpMsg->location, now))
+                {
+                    // on this thread already, so no detour through deferred_q
+                    loc_eng_set_sensor_perf_control(*loc_eng_data_p, gps_conf.SENSOR_CONTROL_MODE,
+                                                    gps_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH,
+                                                    gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC,
+                                                    gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH,
+                                                    gps_conf.SENSOR_GYRO_BATCHES_PER_SEC,
+                                                    gps_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH,
+                                                    gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,
+                                                    gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
+                                                    gps_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
+                                                    gps_conf.SENSOR_ALGORITHM_CONFIG_MASK);
+                }
+
                 // Free the allocated memory for rawData
                 GpsLocation* gp = (GpsLocation*)&(rpMsg->location);
                 if (gp != NULL && gp->rawData != NULL)
@@ -1555,7 +2386,14 @@ static void loc_eng_deferred_action_thread(void* arg)
 
                 if (loc_eng_data_p->generateNmea)
                 {
-                    loc_eng_nmea_generate_sv(loc_eng_data_p, rsMsg->svStatus, rsMsg->locationExtended);
+                    loc_eng_nmea_generate_sv(loc_eng_data_p, rsMsg->svStatus, rsMsg->locationExtended,
+                                             rsMsg->svUsedMask, rsMsg->svUsedWords);
+                }
+
+                if (loc_eng_data_p->binStream)
+                {
+                    loc_eng_bin_report_sv(loc_eng_data_p, rsMsg->svStatus, rsMsg->svUsedMask,
+                                          rsMsg->svUsedWords);
                 }
 
             }
@@ -1566,7 +2404,8 @@ static void loc_eng_deferred_action_thread(void* arg)
             break;
 
         case LOC_ENG_MSG_REPORT_NMEA:
-            if (NULL != loc_eng_data_p->nmea_cb) {
+            if (NULL != loc_eng_data_p->nmea_cb &&
+                NULL != ((loc_eng_msg_report_nmea*)msg)->nmea) {
                 loc_eng_msg_report_nmea* nmMsg = (loc_eng_msg_report_nmea*)msg;
                 struct timeval tv;
                 gettimeofday(&tv, (struct timezone *) NULL);
@@ -1576,107 +2415,8 @@ static void loc_eng_deferred_action_thread(void* arg)
             }
             break;
 
-        case LOC_ENG_MSG_REQUEST_BIT:
-        {
-            AgpsStateMachine* stateMachine;
-            loc_eng_msg_request_bit* brqMsg = (loc_eng_msg_request_bit*)msg;
-            if (brqMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_SUPL) {
-                stateMachine = loc_eng_data_p->agnss_nif;
-            } else if (brqMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_ANY) {
-                stateMachine = loc_eng_data_p->internet_nif;
-            } else {
-                LOC_LOGD("%s]%d: unknown I/F request type = 0x%x\n", __func__, __LINE__, brqMsg->ifType);
-                break;
-            }
-            BITSubscriber subscriber(stateMachine, brqMsg->ipv4Addr, brqMsg->ipv6Addr);
-
-            stateMachine->subscribeRsrc((Subscriber*)&subscriber);
-        }
-        break;
-
-        case LOC_ENG_MSG_RELEASE_BIT:
-        {
-            AgpsStateMachine* stateMachine;
-            loc_eng_msg_release_bit* brlMsg = (loc_eng_msg_release_bit*)msg;
-            if (brlMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_SUPL) {
-                stateMachine = loc_eng_data_p->agnss_nif;
-            } else if (brlMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_ANY) {
-                stateMachine = loc_eng_data_p->internet_nif;
-            } else {
-                LOC_LOGD("%s]%d: unknown I/F request type = 0x%x\n", __func__, __LINE__, brlMsg->ifType);
-                break;
-            }
-            BITSubscriber subscriber(stateMachine, brlMsg->ipv4Addr, brlMsg->ipv6Addr);
-
-            stateMachine->unsubscribeRsrc((Subscriber*)&subscriber);
-        }
-        break;
-
-        case LOC_ENG_MSG_REQUEST_ATL:
-        {
-            loc_eng_msg_request_atl* arqMsg = (loc_eng_msg_request_atl*)msg;
-            boolean backwardCompatibleMode = AGPS_TYPE_INVALID == arqMsg->type;
-            AgpsStateMachine* stateMachine = (AGPS_TYPE_SUPL == arqMsg->type ||
-                                              backwardCompatibleMode) ?
-                                             loc_eng_data_p->agnss_nif :
-                                             loc_eng_data_p->internet_nif;
-            ATLSubscriber subscriber(arqMsg->handle,
-                                     stateMachine,
-                                     loc_eng_data_p->client_handle,
-                                     backwardCompatibleMode);
-
-            stateMachine->subscribeRsrc((Subscriber*)&subscriber);
-        }
-        break;
-
-        case LOC_ENG_MSG_RELEASE_ATL:
-        {
-            loc_eng_msg_release_atl* arlMsg = (loc_eng_msg_release_atl*)msg;
-            ATLSubscriber s1(arlMsg->handle,
-                             loc_eng_data_p->agnss_nif,
-                             loc_eng_data_p->client_handle,
-                             false);
-            // attempt to unsubscribe from agnss_nif first
-            if (! loc_eng_data_p->agnss_nif->unsubscribeRsrc((Subscriber*)&s1)) {
-                ATLSubscriber s2(arlMsg->handle,
-                                 loc_eng_data_p->internet_nif,
-                                 loc_eng_data_p->client_handle,
-                                 false);
-                // if unsuccessful, try internet_nif
-                loc_eng_data_p->internet_nif->unsubscribeRsrc((Subscriber*)&s2);
-            }
-        }
-        break;
-
-        case LOC_ENG_MSG_REQUEST_WIFI:
-        {
-            loc_eng_msg_request_wifi *wrqMsg = (loc_eng_msg_request_wifi *)msg;
-            if (wrqMsg->senderId == LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC ||
-                wrqMsg->senderId == LOC_ENG_IF_REQUEST_SENDER_ID_MSAPM) {
-              AgpsStateMachine* stateMachine = loc_eng_data_p->wifi_nif;
-              WIFISubscriber subscriber(stateMachine, wrqMsg->ssid, wrqMsg->password, wrqMsg->senderId);
-              stateMachine->subscribeRsrc((Subscriber*)&subscriber);
-            } else {
-              LOC_LOGE("%s]%d ERROR: unknown sender ID", __func__, __LINE__);
-              break;
-            }
-        }
-        break;
-
-        case LOC_ENG_MSG_RELEASE_WIFI:
-        {
-            AgpsStateMachine* stateMachine = loc_eng_data_p->wifi_nif;
-            loc_eng_msg_release_wifi* wrlMsg = (loc_eng_msg_release_wifi*)msg;
-            WIFISubscriber subscriber(stateMachine, wrlMsg->ssid, wrlMsg->password, wrlMsg->senderId);
-            stateMachine->unsubscribeRsrc((Subscriber*)&subscriber);
-        }
-        break;
-
         case LOC_ENG_MSG_REQUEST_XTRA_DATA:
-            if (loc_eng_data_p->xtra_module_data.download_request_cb != NULL)
-            {
-                loc_eng_data_p->xtra_module_data.download_request_cb();
-            }
+            loc_eng_xtra_handle_request(*loc_eng_data_p);
             break;
 
         case LOC_ENG_MSG_REQUEST_TIME:
@@ -1708,75 +2448,20 @@ static void loc_eng_deferred_action_thread(void* arg)
         case LOC_ENG_MSG_INJECT_XTRA_DATA:
         {
             loc_eng_msg_inject_xtra_data *xdMsg = (loc_eng_msg_inject_xtra_data*)msg;
-            loc_eng_data_p->client_handle->setXtraData(xdMsg->data, xdMsg->length);
-        }
-        break;
-
-        case LOC_ENG_MSG_ATL_OPEN_SUCCESS:
-        {
-            loc_eng_msg_atl_open_success *aosMsg = (loc_eng_msg_atl_open_success*)msg;
-            AgpsStateMachine* stateMachine;
-            switch (aosMsg->agpsType) {
-              case AGPS_TYPE_WIFI: {
-                stateMachine = loc_eng_data_p->wifi_nif;
-                break;
-              }
-              case AGPS_TYPE_SUPL: {
-                stateMachine = loc_eng_data_p->agnss_nif;
-                break;
-              }
-              default: {
-                stateMachine  = loc_eng_data_p->internet_nif;
-              }
+            if (LOC_API_ADAPTER_ERR_SUCCESS ==
+                loc_eng_data_p->client_handle->setXtraData(xdMsg->data, xdMsg->length)) {
+                loc_eng_xtra_cache_store(*loc_eng_data_p, xdMsg->data, xdMsg->length);
             }
-
-            stateMachine->setBearer(aosMsg->bearerType);
-            stateMachine->setAPN(aosMsg->apn, aosMsg->length);
-            stateMachine->onRsrcEvent(RSRC_GRANTED);
         }
         break;
 
-        case LOC_ENG_MSG_ATL_CLOSED:
+        case LOC_ENG_MSG_INJECT_XTRA_FILE:
         {
-            loc_eng_msg_atl_closed *acsMsg = (loc_eng_msg_atl_closed*)msg;
-            AgpsStateMachine* stateMachine;
-            switch (acsMsg->agpsType) {
-              case AGPS_TYPE_WIFI: {
-                stateMachine = loc_eng_data_p->wifi_nif;
-                break;
-              }
-              case AGPS_TYPE_SUPL: {
-                stateMachine = loc_eng_data_p->agnss_nif;
-                break;
-              }
-              default: {
-                stateMachine  = loc_eng_data_p->internet_nif;
-              }
-            }
-
-            stateMachine->onRsrcEvent(RSRC_RELEASED);
-        }
-        break;
-
-        case LOC_ENG_MSG_ATL_OPEN_FAILED:
-        {
-            loc_eng_msg_atl_open_failed *aofMsg = (loc_eng_msg_atl_open_failed*)msg;
-            AgpsStateMachine* stateMachine;
-            switch (aofMsg->agpsType) {
-              case AGPS_TYPE_WIFI: {
-                stateMachine = loc_eng_data_p->wifi_nif;
-                break;
-              }
-              case AGPS_TYPE_SUPL: {
-                stateMachine = loc_eng_data_p->agnss_nif;
-                break;
-              }
-              default: {
-                stateMachine  = loc_eng_data_p->internet_nif;
-              }
-            }
-
-            stateMachine->onRsrcEvent(RSRC_DENIED);
+            loc_eng_msg_inject_xtra_file *xfMsg = (loc_eng_msg_inject_xtra_file*)msg;
+            loc_eng_xtra_cache_injected(*loc_eng_data_p,
+                                        LOC_API_ADAPTER_ERR_SUCCESS ==
+                                        loc_eng_data_p->client_handle->setXtraData(xfMsg->data,
+                                                                                   xfMsg->length));
         }
         break;
 
@@ -1842,6 +2527,8 @@ static void loc_eng_deferred_action_thread(void* arg)
             loc_eng_data_p->aiding_data_for_deletion = 0;
         }
 
+        context->msg_stats->record(msg->msgid, msg->enqueueTime,
+                                   handlerStart, loc_eng_msg_now());
         delete msg;
     }
 
@@ -1912,8 +2599,8 @@ bool loc_eng_inject_raw_command(loc_eng_data_s_type &loc_eng_data,
     {
         ulp_msg_inject_raw_command *msg(
             new ulp_msg_inject_raw_command(&loc_eng_data,command, length));
-        msg_q_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q
-                   , msg, loc_eng_free_msg);
+        loc_eng_msg_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q
+                         , msg);
         ret_val = 0;
     }else
     {
@@ -1954,8 +2641,8 @@ int loc_eng_update_criteria(loc_eng_data_s_type &loc_eng_data,
               criteria.preferred_power_consumption );
      ulp_msg_update_criteria *msg(
          new ulp_msg_update_criteria(&loc_eng_data,criteria));
-     msg_q_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q
-                , msg, loc_eng_free_msg);
+     loc_eng_msg_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q
+                      , msg);
      ret_val = 0;
     }else
     {
@@ -2000,7 +2687,7 @@ int loc_eng_ulp_phone_context_settings_update(loc_eng_data_s_type &loc_eng_data,
     {
         ulp_msg_inject_phone_context_settings *msg
          (new ulp_msg_inject_phone_context_settings(&loc_eng_data, *settings));
-        msg_q_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q, msg, loc_eng_free_msg);
+        loc_eng_msg_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q, msg);
         ret_val = 0;
     }
 
@@ -2008,7 +2695,7 @@ int loc_eng_ulp_phone_context_settings_update(loc_eng_data_s_type &loc_eng_data,
     if(settings->context_type & ULP_PHONE_CONTEXT_BATTERY_CHARGING_STATE)
     {
         loc_eng_msg_ext_power_config *msg(new loc_eng_msg_ext_power_config(&loc_eng_data, settings->is_battery_charging));
-        msg_q_snd( (void*)((LocEngContext*)(loc_eng_data.context))->deferred_q, msg, loc_eng_free_msg);
+        loc_eng_msg_snd( (void*)((LocEngContext*)(loc_eng_data.context))->deferred_q, msg);
     }
 
     EXIT_LOG(%d, ret_val);
@@ -2091,8 +2778,8 @@ int loc_eng_ulp_send_network_position(loc_eng_data_s_type &loc_eng_data,
     {
      ulp_msg_inject_network_position *msg
          (new ulp_msg_inject_network_position(&loc_eng_data, *position_report));
-     msg_q_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q
-                , msg, loc_eng_free_msg);
+     loc_eng_msg_snd( (void*)((LocEngContext*)(loc_eng_data.context))->ulp_q
+                      , msg);
      ret_val = 0;
     }else
     {
@@ -2101,6 +2788,51 @@ int loc_eng_ulp_send_network_position(loc_eng_data_s_type &loc_eng_data,
     EXIT_LOG(%d, ret_val);
     return ret_val;
 }
+/*===========================================================================
+FUNCTION    loc_eng_parse_config
+
+DESCRIPTION
+   Parses the gps config file into conf, which starts out with the
+   defaults. loc_parameter_table points into gps_conf, so a copy of it
+   with the pointers moved over to conf is handed to the parser.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_parse_config(loc_gps_cfg_s_type &conf)
+{
+    const uint32_t num_params = sizeof(loc_parameter_table) / sizeof(loc_parameter_table[0]);
+    const ptrdiff_t offset = (char*)&conf - (char*)&gps_conf;
+    loc_param_s_type table[num_params];
+    loc_param_err_s_type errors[8];
+
+    for (uint32_t i = 0; i < num_params; i++) {
+        table[i] = loc_parameter_table[i];
+        table[i].param_ptr = (char*)table[i].param_ptr + offset;
+        if (NULL != table[i].param_set) {
+            table[i].param_set += offset;
+        }
+    }
+
+    // Initialize our defaults before reading of configuration file overwrites them.
+    loc_default_parameters(conf);
+    uint32_t num_errors = loc_read_conf_checked(GPS_CONF_FILE, table, loc_parameter_ranges,
+                                                num_params, errors,
+                                                sizeof(errors) / sizeof(errors[0]));
+    for (uint32_t i = 0; i < num_errors && i < sizeof(errors) / sizeof(errors[0]); i++) {
+        LOC_LOGE("%s line %u: %s = %s, %s, default kept", GPS_CONF_FILE, errors[i].line,
+                 errors[i].param_name, errors[i].param_value,
+                 loc_param_err_string(errors[i].error));
+    }
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_read_config
 
@@ -2122,11 +2854,10 @@ int loc_eng_read_config(void)
     ENTRY_LOG_CALLFLOW();
     if(gpsConfigAlreadyRead == false)
     {
-      // Initialize our defaults before reading of configuration file overwrites them.
-      loc_default_parameters();
       // Ee only want to parse the conf file once. This is a good place to ensure that.
       // In fact one day the conf file should go into context.
-      UTIL_READ_CONF(GPS_CONF_FILE, loc_parameter_table);
+      loc_eng_parse_config(gps_conf);
+      loc_eng_reloaded_conf = gps_conf;
       gpsConfigAlreadyRead = true;
     } else {
       LOC_LOGV("GPS Config file has already been read\n");
@@ -2136,3 +2867,243 @@ int loc_eng_read_config(void)
     return 0;
 }
 
+/*===========================================================================
+FUNCTION    loc_eng_conf_snapshot
+
+DESCRIPTION
+   Copies gps_conf in one piece, off the deferred thread a reload may be
+   updating it from
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_conf_snapshot(loc_gps_cfg_s_type &conf)
+{
+    pthread_mutex_lock(&loc_eng_conf_lock);
+    conf = gps_conf;
+    pthread_mutex_unlock(&loc_eng_conf_lock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_adopt_config
+
+DESCRIPTION
+   Takes the settings a reload can change over into gps_conf. Those that
+   need a restart are left alone, other threads read them without the lock.
+
+DEPENDENCIES
+   Called from the deferred thread only, which therefore reads gps_conf
+   without the lock
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_adopt_config(const loc_gps_cfg_s_type &conf)
+{
+    pthread_mutex_lock(&loc_eng_conf_lock);
+    gps_conf.INTERMEDIATE_POS = conf.INTERMEDIATE_POS;
+    gps_conf.ACCURACY_THRES = conf.ACCURACY_THRES;
+    gps_conf.SUPL_VER = conf.SUPL_VER;
+    gps_conf.LPP_PROFILE = conf.LPP_PROFILE;
+    gps_conf.SENSOR_USAGE = conf.SENSOR_USAGE;
+    gps_conf.GYRO_BIAS_RANDOM_WALK_VALID = conf.GYRO_BIAS_RANDOM_WALK_VALID;
+    gps_conf.GYRO_BIAS_RANDOM_WALK = conf.GYRO_BIAS_RANDOM_WALK;
+    gps_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID = conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID;
+    gps_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY = conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY;
+    gps_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID;
+    gps_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY = conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY;
+    gps_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID;
+    gps_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY = conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY;
+    gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID = conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID;
+    gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY = conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY;
+    gps_conf.SENSOR_CONTROL_MODE = conf.SENSOR_CONTROL_MODE;
+    gps_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH = conf.SENSOR_ACCEL_SAMPLES_PER_BATCH;
+    gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC = conf.SENSOR_ACCEL_BATCHES_PER_SEC;
+    gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH = conf.SENSOR_GYRO_SAMPLES_PER_BATCH;
+    gps_conf.SENSOR_GYRO_BATCHES_PER_SEC = conf.SENSOR_GYRO_BATCHES_PER_SEC;
+    gps_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH = conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH;
+    gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH = conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH;
+    gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH = conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH;
+    gps_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH = conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH;
+    gps_conf.SENSOR_ALGORITHM_CONFIG_MASK = conf.SENSOR_ALGORITHM_CONFIG_MASK;
+    pthread_mutex_unlock(&loc_eng_conf_lock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_reload_config
+
+DESCRIPTION
+   Re-reads the gps config file and pushes the settings that changed since
+   the last read through the deferred queue, the same way loc_eng_reinit
+   sends all of them. The deferred thread then adopts the new values into
+   gps_conf, so a later reinit sends them again. Settings that are only
+   looked at while the engine comes up keep their old values until the
+   location service restarts.
+
+DEPENDENCIES
+   loc_eng_init must have completed. Called from the config watcher thread
+   only, which loc_eng_cleanup stops before it tears anything down.
+
+RETURN VALUE
+   Number of settings that changed
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_reload_config(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    INIT_CHECK(loc_eng_data.context, return 0);
+    void* deferred_q = (void*)((LocEngContext*)(loc_eng_data.context))->deferred_q;
+    const loc_gps_cfg_s_type &old_conf = loc_eng_reloaded_conf;
+    loc_gps_cfg_s_type conf;
+    int changed = 0;
+
+    // the file was rewritten, possibly within the second its cache is keyed on
+    loc_read_conf_invalidate();
+    loc_eng_parse_config(conf);
+
+#define LOC_ENG_CONF_KEEP(FIELD)                                              \
+    if (conf.FIELD != old_conf.FIELD) {                                       \
+        LOC_LOGW("%s: %s changed, takes effect after a restart", __func__, #FIELD); \
+        conf.FIELD = old_conf.FIELD;                                          \
+    }
+    LOC_ENG_CONF_KEEP(ENABLE_WIPER);
+    LOC_ENG_CONF_KEEP(NMEA_PROVIDER);
+    LOC_ENG_CONF_KEEP(CAPABILITIES);
+    LOC_ENG_CONF_KEEP(QUIPC_ENABLED);
+    LOC_ENG_CONF_KEEP(CONFIG_RELOAD);
+    LOC_ENG_CONF_KEEP(SENSOR_AUTO_TUNE);
+    LOC_ENG_CONF_KEEP(XTRA_CACHE_VALIDITY);
+#undef LOC_ENG_CONF_KEEP
+    if (0 != strcmp(conf.BINARY_FIX_STREAM, old_conf.BINARY_FIX_STREAM)) {
+        LOC_LOGW("%s: BINARY_FIX_STREAM changed, takes effect after a restart", __func__);
+        strlcpy(conf.BINARY_FIX_STREAM, old_conf.BINARY_FIX_STREAM,
+                sizeof(conf.BINARY_FIX_STREAM));
+    }
+    if (0 != strcmp(conf.XTRA_CACHE, old_conf.XTRA_CACHE)) {
+        LOC_LOGW("%s: XTRA_CACHE changed, takes effect after a restart", __func__);
+        strlcpy(conf.XTRA_CACHE, old_conf.XTRA_CACHE, sizeof(conf.XTRA_CACHE));
+    }
+    if (0 != strcmp(conf.WARM_START_CACHE, old_conf.WARM_START_CACHE)) {
+        LOC_LOGW("%s: WARM_START_CACHE changed, takes effect after a restart", __func__);
+        strlcpy(conf.WARM_START_CACHE, old_conf.WARM_START_CACHE,
+                sizeof(conf.WARM_START_CACHE));
+    }
+
+    bool halChanged =
+        conf.INTERMEDIATE_POS != old_conf.INTERMEDIATE_POS ||
+        conf.ACCURACY_THRES != old_conf.ACCURACY_THRES;
+    bool suplChanged = conf.SUPL_VER != old_conf.SUPL_VER;
+    bool lppChanged = conf.LPP_PROFILE != old_conf.LPP_PROFILE;
+    bool sensorUsageChanged = conf.SENSOR_USAGE != old_conf.SENSOR_USAGE;
+    bool sensorPropertiesChanged =
+        conf.GYRO_BIAS_RANDOM_WALK_VALID != old_conf.GYRO_BIAS_RANDOM_WALK_VALID ||
+        conf.GYRO_BIAS_RANDOM_WALK != old_conf.GYRO_BIAS_RANDOM_WALK ||
+        conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID != old_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY != old_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY ||
+        conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID != old_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY != old_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY ||
+        conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID != old_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY != old_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY ||
+        conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID != old_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY != old_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY;
+    bool sensorPerfChanged =
+        conf.SENSOR_CONTROL_MODE != old_conf.SENSOR_CONTROL_MODE ||
+        conf.SENSOR_ACCEL_SAMPLES_PER_BATCH != old_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH ||
+        conf.SENSOR_ACCEL_BATCHES_PER_SEC != old_conf.SENSOR_ACCEL_BATCHES_PER_SEC ||
+        conf.SENSOR_GYRO_SAMPLES_PER_BATCH != old_conf.SENSOR_GYRO_SAMPLES_PER_BATCH ||
+        conf.SENSOR_GYRO_BATCHES_PER_SEC != old_conf.SENSOR_GYRO_BATCHES_PER_SEC ||
+        conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH != old_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH ||
+        conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH != old_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH ||
+        conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH != old_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH ||
+        conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH != old_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH ||
+        conf.SENSOR_ALGORITHM_CONFIG_MASK != old_conf.SENSOR_ALGORITHM_CONFIG_MASK;
+
+    changed = halChanged + suplChanged + lppChanged + sensorUsageChanged +
+              sensorPropertiesChanged + sensorPerfChanged;
+    if (0 == changed) {
+        LOC_LOGD("%s: no settings changed", __func__);
+        EXIT_LOG(%d, changed);
+        return changed;
+    }
+
+    // goes first, so gps_conf is current by the time the modem is told
+    loc_eng_msg_runtime_config *runtime_msg(
+        new loc_eng_msg_runtime_config(&loc_eng_data, &conf, sizeof(conf)));
+    loc_eng_msg_snd(deferred_q, runtime_msg);
+
+    if (suplChanged) {
+        loc_eng_msg_suple_version *supl_msg(new loc_eng_msg_suple_version(&loc_eng_data,
+                                                                          conf.SUPL_VER));
+        loc_eng_msg_snd(deferred_q, supl_msg);
+    }
+
+    if (lppChanged) {
+        loc_eng_msg_lpp_config *lpp_msg(new loc_eng_msg_lpp_config(&loc_eng_data,
+                                                                   conf.LPP_PROFILE));
+        loc_eng_msg_snd(deferred_q, lpp_msg);
+    }
+
+    if (sensorUsageChanged) {
+        loc_eng_msg_sensor_control_config *sensor_control_config_msg(
+            new loc_eng_msg_sensor_control_config(&loc_eng_data, conf.SENSOR_USAGE));
+        loc_eng_msg_snd(deferred_q, sensor_control_config_msg);
+    }
+
+    if (sensorPropertiesChanged &&
+        (conf.GYRO_BIAS_RANDOM_WALK_VALID ||
+         conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+         conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+         conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+         conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID)) {
+        loc_eng_msg_sensor_properties *sensor_properties_msg(
+            new loc_eng_msg_sensor_properties(&loc_eng_data,
+                                               conf.GYRO_BIAS_RANDOM_WALK_VALID,
+                                               conf.GYRO_BIAS_RANDOM_WALK,
+                                               conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                               conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,
+                                               conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                               conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                               conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                               conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                               conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                               conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY));
+        loc_eng_msg_snd(deferred_q, sensor_properties_msg);
+    }
+
+    if (sensorPerfChanged) {
+        loc_eng_msg_sensor_perf_control_config *sensor_perf_control_conf_msg(
+            new loc_eng_msg_sensor_perf_control_config(&loc_eng_data,
+                                                       conf.SENSOR_CONTROL_MODE,
+                                                       conf.SENSOR_ACCEL_SAMPLES_PER_BATCH,
+                                                       conf.SENSOR_ACCEL_BATCHES_PER_SEC,
+                                                       conf.SENSOR_GYRO_SAMPLES_PER_BATCH,
+                                                       conf.SENSOR_GYRO_BATCHES_PER_SEC,
+                                                       conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH,
+                                                       conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,
+                                                       conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
+                                                       conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
+                                                       conf.SENSOR_ALGORITHM_CONFIG_MASK));
+        loc_eng_msg_snd(deferred_q, sensor_perf_control_conf_msg);
+    }
+
+    loc_eng_reloaded_conf = conf;
+    LOC_LOGI("%s: %s reloaded, %d setting groups changed", __func__, GPS_CONF_FILE, changed);
+
+    EXIT_LOG(%d, changed);
+    return changed;
+}
+
@@ -50,12 +50,15 @@ typedef unsigned char boolean;
 
 #include <loc.h>
 #include <loc_eng_xtra.h>
+#include <loc_eng_warm.h>
+#include <loc_eng_batch.h>
 #include <loc_eng_ni.h>
 #include <loc_eng_agps.h>
 #include <loc_cfg.h>
 #include <loc_log.h>
 #include <log_util.h>
 #include <loc_eng_msg.h>
+#include <loc_eng_msg_slab.h>
 #include <loc_eng_agps.h>
 #include <LocApiAdapter.h>
 
@@ -79,17 +82,41 @@ enum loc_mute_session_e_type {
    LOC_MUTE_SESS_IN_SESSION
 };
 
+class LocEngMsgStats;
+class LocEngSensorTuner;
+
 struct LocEngContext {
     // Data variables used by deferred action thread
     const void* deferred_q;
+    // SV, NMEA and position reports from the modem, a ring so their
+    // bursts stay off deferred_q's lock; what does not fit is shed if a
+    // newer report supersedes it, or goes to deferred_q if not
+    const void* report_q;
+    // set while report_q has a wakeup on its way through deferred_q
+    volatile int reportsPending;
     const void* ulp_q;
+    // AGPS state machine msgs, so a slow data call set up does not
+    // hold up deferred_q
+    const void* agps_q;
     const pthread_t deferred_action_thread;
+    const pthread_t agps_action_thread;
+    // backs loc_eng_msg::operator new / delete
+    LocEngMsgSlab* const msg_slab;
+    // deferred thread latency histograms
+    LocEngMsgStats* const msg_stats;
     static LocEngContext* get(gps_create_thread threadCreator);
     void drop();
+    // last thing the action threads do before they return
+    void deferredThreadExited();
+    void agpsThreadExited();
     static pthread_mutex_t lock;
     static pthread_cond_t cond;
 private:
     int counter;
+    // cleared by the action threads on their way out, under lock
+    bool deferredRunning;
+    bool agpsRunning;
+    void threadExited(bool& running);
     static LocEngContext *me;
     LocEngContext(gps_create_thread threadCreator);
 };
@@ -110,11 +137,18 @@ typedef struct
     ulp_network_location_request   ulp_network_callback;
     ulp_request_phone_context      ulp_phone_context_req_cb;
     boolean                        intermediateFix;
+    // when location_cb last got a fix, CLOCK_MONOTONIC ns, 0 if not
+    // yet in this session; for holding fixes to min_interval
+    int64_t                        lastFixReportNs;
     AGpsStatusValue                agps_status;
     // used to defer stopping the GPS engine until AGPS data calls are done
     boolean                        agps_request_pending;
     boolean                        stop_request_pending;
     loc_eng_xtra_data_s_type       xtra_module_data;
+    // see loc_eng_warm.h
+    loc_eng_warm_data_s_type       warm_data;
+    // NULL until GPS_BATCHING_INTERFACE is initialized
+    loc_eng_batch_data_s_type*     batch_data;
     loc_eng_ni_data_s_type         loc_eng_ni_data;
 
     // AGPS state machines
@@ -136,11 +170,20 @@ typedef struct
 
     // For nmea generation
     boolean generateNmea;
-    uint32_t sv_used_mask;
+    uint32_t sv_used_mask[LOC_ENG_SV_USED_MASK_WORDS];
+    // words of sv_used_mask that came from the modem, see
+    // loc_eng_msg_report_sv::svUsedWords
+    int sv_used_words;
     float hdop;
     float pdop;
     float vdop;
 
+    // For the binary fix stream, see loc_eng_bin.h
+    boolean binStream;
+
+    // Picks the sensor batching profile, NULL unless SENSOR_AUTO_TUNE
+    LocEngSensorTuner* sensorTuner;
+
     // Address buffers, for addressing setting before init
     int    supl_host_set;
     char   supl_host_buf[101];
@@ -188,6 +231,12 @@ typedef struct loc_gps_cfg_s
   double         RATE_RANDOM_WALK_SPECTRAL_DENSITY;
   uint8_t        VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID;
   double         VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY;
+  char           BINARY_FIX_STREAM[LOC_MAX_PARAM_STRING + 1];
+  unsigned long  CONFIG_RELOAD;
+  unsigned long  SENSOR_AUTO_TUNE;
+  char           XTRA_CACHE[LOC_MAX_PARAM_STRING + 1];
+  unsigned long  XTRA_CACHE_VALIDITY;
+  char           WARM_START_CACHE[LOC_MAX_PARAM_STRING + 1];
 } loc_gps_cfg_s_type;
 
 extern loc_gps_cfg_s_type gps_conf;
@@ -200,6 +249,8 @@ int loc_eng_ulp_init(loc_eng_data_s_type &loc_eng_data, const ulpInterface * loc
 int  loc_eng_start(loc_eng_data_s_type &loc_eng_data);
 int  loc_eng_stop(loc_eng_data_s_type &loc_eng_data);
 void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data);
+size_t loc_eng_get_internal_state(loc_eng_data_s_type &loc_eng_data,
+                                  char* buffer, size_t bufferSize);
 int  loc_eng_inject_time(loc_eng_data_s_type &loc_eng_data,
                          GpsUtcTime time, int64_t timeReference,
                          int uncertainty);
@@ -242,6 +293,28 @@ int loc_eng_xtra_init (loc_eng_data_s_type &loc_eng_data,
 int loc_eng_xtra_inject_data(loc_eng_data_s_type &loc_eng_data,
                              char* data, int length);
 
+void loc_eng_xtra_handle_request(loc_eng_data_s_type &loc_eng_data);
+
+void loc_eng_xtra_cache_injected(loc_eng_data_s_type &loc_eng_data, bool injected);
+
+void loc_eng_xtra_cache_store(loc_eng_data_s_type &loc_eng_data,
+                              const char* data, int length);
+
+void loc_eng_warm_record_fix(loc_eng_data_s_type &loc_eng_data,
+                             const GpsLocation &location, int64_t fixBootMs);
+void loc_eng_warm_save(loc_eng_data_s_type &loc_eng_data);
+void loc_eng_warm_inject(loc_eng_data_s_type &loc_eng_data);
+
+int loc_eng_batch_init(loc_eng_data_s_type &loc_eng_data,
+                       GpsBatchingCallbacks* callbacks);
+int loc_eng_batch_start(loc_eng_data_s_type &loc_eng_data,
+                        uint32_t flush_period_ms);
+int loc_eng_batch_stop(loc_eng_data_s_type &loc_eng_data);
+size_t loc_eng_batch_read(loc_eng_data_s_type &loc_eng_data,
+                          GpsLocation* fixes, size_t max_fixes);
+bool loc_eng_batch_add_fix(loc_eng_data_s_type &loc_eng_data,
+                           const GpsLocation &location, int64_t now);
+
 extern void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data,
                             GpsNiCallbacks *callbacks);
 extern void loc_eng_ni_respond(loc_eng_data_s_type &loc_eng_data,
@@ -259,6 +332,7 @@ int loc_eng_ulp_phone_context_init(loc_eng_data_s_type &loc_eng_data,
 int loc_eng_ulp_send_network_position(loc_eng_data_s_type &loc_eng_data,
                                              UlpNetworkPositionReport *position_report);
 int loc_eng_read_config(void);
+int loc_eng_reload_config(loc_eng_data_s_type &loc_eng_data);
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
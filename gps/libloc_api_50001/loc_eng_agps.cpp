@@ -37,45 +37,22 @@
 #include <loc_eng_dmn_conn.h>
 
 //======================================================================
-// C callbacks
+// Subscriber list helpers
 //======================================================================
 
-// This is given to linked_list_add as the dealloc callback
-// data -- an instance of Subscriber
-static void deleteObj(void* data)
+// the subscriber a node of AgpsStateMachine's lists belongs to
+static inline Subscriber* subscriberOf(linked_list_node* node)
 {
-    delete (Subscriber*)data;
+    return ((SubscriberNode*)node)->owner;
 }
 
-// This is given to linked_list_search() as the comparison callback
-// when the state manchine needs to process for particular subscriber
-// fromCaller -- caller provides this obj
-// fromList -- linked_list_search() function take this one from list
-static bool hasSubscriber(void* fromCaller, void* fromList)
+// bucket of AgpsStateMachine::mSubscriberIndex for a subscriber ID.
+// BIT IDs are IPv4 addresses and ATL IDs small handles, so the bits
+// are mixed before the top ones are taken.
+static inline unsigned int subscriberBucket(const int id)
 {
-    Notification* notification = (Notification*)fromCaller;
-    Subscriber* s1 = (Subscriber*)fromList;
-
-    return s1->forMe(*notification);
-}
-
-// This is gvien to linked_list_search() to notify subscriber objs
-// when the state machine needs to inform all subscribers of resource
-// status changes, e.g. when resource is GRANTED.
-// fromCaller -- caller provides this ptr to a Notification obj.
-// fromList -- linked_list_search() function take this one from list
-static bool notifySubscriber(void* fromCaller, void* fromList)
-{
-    Notification* notification = (Notification*)fromCaller;
-    Subscriber* s1 = (Subscriber*)fromList;
-
-    // we notify every subscriber indiscriminatively
-    // each subscriber decides if this notification is interesting.
-    return s1->notifyRsrcStatus(*notification) &&
-           // if we do not want to delete the subscriber from the
-           // the list, we must set this to false so this function
-           // returns false
-           notification->postNotifyDelete;
+    return ((unsigned int)id * 2654435761U) >>
+        (32 - __builtin_ctz(AGPS_SUBSCRIBER_INDEX_SIZE));
 }
 
 //======================================================================
@@ -314,7 +291,7 @@ AgpsState* AgpsPendingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -412,7 +389,7 @@ AgpsState* AgpsAcquiredState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -501,7 +478,7 @@ AgpsState* AgpsReleasingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -557,11 +534,16 @@ AgpsStateMachine::AgpsStateMachine(void (*servicer)(AGpsStatus* status),
                                    bool enforceSingleSubscriber) :
     mServicer(servicer), mType(type),
     mStatePtr(new AgpsReleasedState(this)),
+    mNumSubscribers(0),
+    mNumActiveSubscribers(0),
     mAPN(NULL),
     mAPNLen(0),
     mEnforceSingleSubscriber(enforceSingleSubscriber)
 {
-    linked_list_init(&mSubscribers);
+    linked_list_intr_init(&mSubscribers);
+    for (int i = 0; i < AGPS_SUBSCRIBER_INDEX_SIZE; i++) {
+        linked_list_intr_init(&mSubscriberIndex[i]);
+    }
 
     // setting up mReleasedState
     mStatePtr->mPendingState = new AgpsPendingState(this);
@@ -600,7 +582,6 @@ AgpsStateMachine::~AgpsStateMachine()
     delete releasedState;
     delete pendindState;
     delete releasingState;
-    linked_list_destroy(&mSubscribers);
 
     if (NULL != mAPN) {
         delete[] mAPN;
@@ -643,44 +624,97 @@ void AgpsStateMachine::onRsrcEvent(AgpsRsrcStatus event)
 
 void AgpsStateMachine::notifySubscribers(Notification& notification) const
 {
-    if (notification.postNotifyDelete) {
-        // just any non NULL value to get started
-        Subscriber* s = (Subscriber*)~0;
-        while (NULL != s) {
-            s = NULL;
-            // if the last param sets to true, _search will delete
-            // the node from the list for us.  But the problem is
-            // once that is done, _search returns, leaving the
-            // rest of the list unprocessed.  So we need a loop.
-            linked_list_search(mSubscribers, (void**)&s, notifySubscriber,
-                               (void*)&notification, true);
+    if (NULL != notification.rcver) {
+        // only one subscriber can be interested, go to it directly
+        Subscriber* s = findSubscriber(notification.rcver);
+        if (NULL != s && s->notifyRsrcStatus(notification) &&
+            notification.postNotifyDelete) {
+            removeSubscriber(s);
+        }
+        return;
+    }
+
+    // we notify every subscriber indiscriminatively
+    // each subscriber decides if this notification is interesting.
+    linked_list_node* node = mSubscribers.next;
+    while (node != &mSubscribers) {
+        Subscriber* s = subscriberOf(node);
+        // the subscriber may be deleted below
+        node = node->next;
+        if (s->notifyRsrcStatus(notification) &&
+            notification.postNotifyDelete) {
+            removeSubscriber(s);
         }
-    } else {
-        // no loop needed if it the last param sets to false, which
-        // mean nothing gets deleted from the list.
-        linked_list_search(mSubscribers, NULL, notifySubscriber,
-                           (void*)&notification, false);
     }
 }
 
 void AgpsStateMachine::addSubscriber(Subscriber* subscriber) const
 {
-    Subscriber* s = NULL;
-    Notification notification((const Subscriber*)subscriber);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
+    if (NULL == findSubscriber(subscriber)) {
+        Subscriber* s = subscriber->clone();
+        linked_list_intr_add(&mSubscribers, &s->mListNode.node);
+        linked_list_intr_add(&mSubscriberIndex[subscriberBucket(s->ID)],
+                             &s->mIndexNode.node);
+        mNumSubscribers++;
+        if (!s->isInactive()) {
+            mNumActiveSubscribers++;
+        }
+    }
+}
 
-    if (NULL == s) {
-        linked_list_add(mSubscribers, subscriber->clone(), deleteObj);
+Subscriber* AgpsStateMachine::findSubscriber(const Subscriber* subscriber) const
+{
+    linked_list_node* bucket = &mSubscriberIndex[subscriberBucket(subscriber->ID)];
+    for (linked_list_node* node = bucket->next; node != bucket; node = node->next) {
+        Subscriber* s = subscriberOf(node);
+        if (s->equals(subscriber)) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+void AgpsStateMachine::deactivateSubscriber(Subscriber* subscriber) const
+{
+    if (!subscriber->isInactive()) {
+        subscriber->setInactive();
+        // not every kind of subscriber can go inactive
+        if (subscriber->isInactive()) {
+            mNumActiveSubscribers--;
+        }
+    }
+}
+
+void AgpsStateMachine::removeSubscriber(Subscriber* subscriber) const
+{
+    linked_list_intr_unlink(&subscriber->mListNode.node);
+    linked_list_intr_unlink(&subscriber->mIndexNode.node);
+    mNumSubscribers--;
+    if (!subscriber->isInactive()) {
+        mNumActiveSubscribers--;
+    }
+    delete subscriber;
+}
+
+void AgpsStateMachine::dropAllSubscribers() const
+{
+    while (mSubscribers.next != &mSubscribers) {
+        removeSubscriber(subscriberOf(mSubscribers.next));
     }
 }
 
 void AgpsStateMachine::sendRsrcRequest(AGpsStatusValue action) const
 {
     Subscriber* s = NULL;
-    Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&s, hasSubscriber,
-                       (void*)&notification, false);
+    if (hasActiveSubscribers()) {
+        // latest active subscriber
+        for (linked_list_node* node = mSubscribers.next;
+             NULL == s; node = node->next) {
+            if (!subscriberOf(node)->isInactive()) {
+                s = subscriberOf(node);
+            }
+        }
+    }
 
     if ((NULL == s) == (GPS_RELEASE_AGPS_DATA_CONN == action)) {
         AGpsExtStatus nifRequest;
@@ -709,7 +743,7 @@ void AgpsStateMachine::subscribeRsrc(Subscriber *subscriber)
 {
   if (mEnforceSingleSubscriber && hasSubscribers()) {
       Notification notification(Notification::BROADCAST_ALL, RSRC_DENIED, true);
-      notifySubscriber(&notification, subscriber);
+      subscriber->notifyRsrcStatus(notification);
   } else {
       mStatePtr = mStatePtr->onRsrcEvent(RSRC_SUBSCRIBE, (void*)subscriber);
   }
@@ -717,10 +751,7 @@ void AgpsStateMachine::subscribeRsrc(Subscriber *subscriber)
 
 bool AgpsStateMachine::unsubscribeRsrc(Subscriber *subscriber)
 {
-    Subscriber* s = NULL;
-    Notification notification((const Subscriber*)subscriber);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
+    Subscriber* s = findSubscriber(subscriber);
 
     if (NULL != s) {
         mStatePtr = mStatePtr->onRsrcEvent(RSRC_UNSUBSCRIBE, (void*)s);
@@ -728,12 +759,3 @@ bool AgpsStateMachine::unsubscribeRsrc(Subscriber *subscriber)
     }
     return false;
 }
-
-bool AgpsStateMachine::hasActiveSubscribers() const
-{
-    Subscriber* s = NULL;
-    Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
-    return NULL != s;
-}
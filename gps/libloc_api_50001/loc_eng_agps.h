@@ -43,6 +43,18 @@
 class AgpsStateMachine;
 class Subscriber;
 
+// number of buckets in the per state machine subscriber index, a power of 2
+#define AGPS_SUBSCRIBER_INDEX_SIZE 16
+
+// link of a Subscriber on one of the state machine's intrusive lists
+struct SubscriberNode {
+    // must stay the first member, nodes are cast back to SubscriberNode
+    linked_list_node node;
+    Subscriber* const owner;
+    inline SubscriberNode(Subscriber* subscriber) : owner(subscriber)
+    { node.next = node.prev = NULL; }
+};
+
 /** Represents the status of AGPS. */
 typedef struct {
     /** set to sizeof(AGpsExtStatus) */
@@ -155,8 +167,15 @@ class AgpsStateMachine {
     const AGpsType mType;
     // pointer to the current state.
     AgpsState* mStatePtr;
-    // a linked list of subscribers.
-    void* mSubscribers;
+    // an intrusive list of subscribers, latest first.
+    mutable linked_list_node mSubscribers;
+    // the same subscribers hashed by ID, to find one without
+    // walking mSubscribers.
+    mutable linked_list_node mSubscriberIndex[AGPS_SUBSCRIBER_INDEX_SIZE];
+    // number of subscribers in mSubscribers, and of those that are
+    // not inactive.
+    mutable unsigned int mNumSubscribers;
+    mutable unsigned int mNumActiveSubscribers;
     // apn to the NIF.  Each state machine tracks
     // resource state of a particular NIF.  For each
     // NIF, there is also an active APN.
@@ -188,21 +207,31 @@ public:
     // add a subscriber in the linked list, if not already there.
     void addSubscriber(Subscriber* subscriber) const;
 
+    // the subscriber on the list that equals the given one, or NULL
+    Subscriber* findSubscriber(const Subscriber* subscriber) const;
+
+    // marks a subscriber on the list inactive
+    void deactivateSubscriber(Subscriber* subscriber) const;
+
     void onRsrcEvent(AgpsRsrcStatus event);
 
     // put the data together and send the FW
     void sendRsrcRequest(AGpsStatusValue action) const;
 
     inline bool hasSubscribers() const
-    { return !linked_list_empty(mSubscribers); }
+    { return 0 != mNumSubscribers; }
 
-    bool hasActiveSubscribers() const;
+    inline bool hasActiveSubscribers() const
+    { return 0 != mNumActiveSubscribers; }
 
-    inline void dropAllSubscribers() const
-    { linked_list_flush(mSubscribers); }
+    void dropAllSubscribers() const;
 
     // private. Only a state gets to call this.
     void notifySubscribers(Notification& notification) const;
+
+private:
+    // takes a subscriber off the list and deletes it
+    void removeSubscriber(Subscriber* subscriber) const;
 };
 
 // each subscriber is a AGPS client.  In the case of ATL, there could be
@@ -211,9 +240,13 @@ public:
 struct Subscriber {
     const int ID;
     const AgpsStateMachine* mStateMachine;
+    // links on AgpsStateMachine::mSubscribers and mSubscriberIndex
+    SubscriberNode mListNode;
+    SubscriberNode mIndexNode;
     inline Subscriber(const int id,
                       const AgpsStateMachine* stateMachine) :
-        ID(id), mStateMachine(stateMachine) {}
+        ID(id), mStateMachine(stateMachine),
+        mListNode(this), mIndexNode(this) {}
     inline virtual ~Subscriber() {}
 
     virtual void setIPAddresses(int &v4, char* v6) = 0;
@@ -0,0 +1,289 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+
+#include <stdlib.h>
+#include <string.h>
+#include <loc_eng.h>
+#include <loc_eng_msg.h>
+#include "log_util.h"
+
+// loc_eng_init clears loc_eng_data, the batch outlives that and is
+// handed back on the next loc_eng_batch_init; the deferred thread may
+// still be adding a queued fix, so it is never freed
+static loc_eng_batch_data_s_type* loc_eng_batch_data = NULL;
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_init
+
+DESCRIPTION
+   Initialize the fix batching module. The batch is allocated here, the
+   first time, so that it costs nothing unless the interface is used.
+   Later calls, also after a loc_eng_cleanup, reuse it.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_batch_init(loc_eng_data_s_type &loc_eng_data,
+                       GpsBatchingCallbacks* callbacks)
+{
+    ENTRY_LOG();
+    loc_eng_batch_data_s_type *batch = loc_eng_batch_data;
+    int ret_val = 0;
+
+    if (NULL == loc_eng_data.context || NULL == callbacks) {
+        LOC_LOGE("%s: bad parameters, context %p callbacks %p",
+                 __func__, loc_eng_data.context, callbacks);
+        ret_val = -1;
+    } else if (NULL == batch) {
+        batch = (loc_eng_batch_data_s_type*)calloc(1, sizeof(*batch));
+        if (NULL == batch) {
+            LOC_LOGE("%s: out of memory", __func__);
+            ret_val = -1;
+        } else {
+            pthread_mutex_init(&batch->lock, NULL);
+            batch->batch_ready_cb = callbacks->batch_ready_cb;
+            loc_eng_batch_data = batch;
+            loc_eng_data.batch_data = batch;
+        }
+    } else {
+        pthread_mutex_lock(&batch->lock);
+        batch->batch_ready_cb = callbacks->batch_ready_cb;
+        pthread_mutex_unlock(&batch->lock);
+        loc_eng_data.batch_data = batch;
+    }
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_start
+
+DESCRIPTION
+   Starts sending fixes into the batch instead of to location_cb.
+
+DEPENDENCIES
+   loc_eng_batch_init
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_batch_start(loc_eng_data_s_type &loc_eng_data,
+                        uint32_t flush_period_ms)
+{
+    ENTRY_LOG();
+    loc_eng_batch_data_s_type *batch = loc_eng_data.batch_data;
+    if (NULL == batch) {
+        LOC_LOGE("%s: batching not initialized", __func__);
+        EXIT_LOG(%d, -1);
+        return -1;
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    batch->flush_period_ns = (int64_t)flush_period_ms * 1000000;
+    batch->last_flush_ns = loc_eng_msg_now();
+    batch->active = true;
+    pthread_mutex_unlock(&batch->lock);
+
+    LOC_LOGD("%s: flush period %u ms", __func__, flush_period_ms);
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_stop
+
+DESCRIPTION
+   Sends fixes to location_cb again. What is in the batch stays there
+   until read.
+
+DEPENDENCIES
+   loc_eng_batch_init
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_batch_stop(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    loc_eng_batch_data_s_type *batch = loc_eng_data.batch_data;
+    if (NULL == batch) {
+        LOC_LOGE("%s: batching not initialized", __func__);
+        EXIT_LOG(%d, -1);
+        return -1;
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    batch->active = false;
+    pthread_mutex_unlock(&batch->lock);
+
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_read
+
+DESCRIPTION
+   Moves up to max_fixes of the oldest fixes out of the batch.
+
+DEPENDENCIES
+   loc_eng_batch_init
+
+RETURN VALUE
+   number of fixes moved into fixes
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+size_t loc_eng_batch_read(loc_eng_data_s_type &loc_eng_data,
+                          GpsLocation* fixes, size_t max_fixes)
+{
+    ENTRY_LOG();
+    loc_eng_batch_data_s_type *batch = loc_eng_data.batch_data;
+    if (NULL == batch) {
+        LOC_LOGE("%s: batching not initialized", __func__);
+        EXIT_LOG(%d, 0);
+        return 0;
+    }
+    size_t num = 0;
+
+    pthread_mutex_lock(&batch->lock);
+    if (NULL == fixes) {
+        max_fixes = 0;
+    } else if (max_fixes > batch->num) {
+        max_fixes = batch->num;
+    }
+    // in at most two pieces, up to the end of the array and from its start
+    while (num < max_fixes) {
+        size_t piece = LOC_ENG_BATCH_MAX_FIXES - batch->head;
+        if (piece > max_fixes - num) {
+            piece = max_fixes - num;
+        }
+        memcpy(fixes + num, batch->fixes + batch->head, piece * sizeof(GpsLocation));
+        batch->head = (batch->head + piece) % LOC_ENG_BATCH_MAX_FIXES;
+        batch->num -= piece;
+        num += piece;
+    }
+    if (0 != batch->overwritten) {
+        LOC_LOGW("%s: %u fixes were overwritten before being read",
+                 __func__, batch->overwritten);
+        batch->overwritten = 0;
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    EXIT_LOG(%d, (int)num);
+    return num;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_add_fix
+
+DESCRIPTION
+   Puts a fix into the batch if batching is on. Once the batch is full the
+   oldest fix makes room. batch_ready_cb is called when the batch has just
+   filled up, or when the flush period is up. Runs on the deferred thread.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   true if the fix went into the batch, false if it is to be reported
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+bool loc_eng_batch_add_fix(loc_eng_data_s_type &loc_eng_data,
+                           const GpsLocation &location, int64_t now)
+{
+    loc_eng_batch_data_s_type *batch = loc_eng_data.batch_data;
+    size_t ready = 0;
+
+    // unlocked peek, so fixes outside batching take no lock; checked
+    // again under it
+    if (NULL == batch || !batch->active) {
+        return false;
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    if (!batch->active) {
+        pthread_mutex_unlock(&batch->lock);
+        return false;
+    }
+
+    uint32_t tail = (batch->head + batch->num) % LOC_ENG_BATCH_MAX_FIXES;
+    batch->fixes[tail] = location;
+    // the rawData belongs to the msg, which is freed after this
+    batch->fixes[tail].rawData = NULL;
+    batch->fixes[tail].rawDataSize = 0;
+    if (batch->num < LOC_ENG_BATCH_MAX_FIXES) {
+        if (++batch->num == LOC_ENG_BATCH_MAX_FIXES) {
+            ready = batch->num;
+        }
+    } else {
+        batch->head = (batch->head + 1) % LOC_ENG_BATCH_MAX_FIXES;
+        batch->overwritten++;
+    }
+
+    if (0 != batch->flush_period_ns &&
+        now - batch->last_flush_ns >= batch->flush_period_ns) {
+        ready = batch->num;
+    }
+    if (0 != ready) {
+        batch->last_flush_ns = now;
+    }
+    gps_batch_ready_callback batch_ready_cb = batch->batch_ready_cb;
+    pthread_mutex_unlock(&batch->lock);
+
+    // outside the lock, the client is likely to read right away
+    if (0 != ready && NULL != batch_ready_cb) {
+        LOC_LOGV("%s: %d fixes ready", __func__, (int)ready);
+        batch_ready_cb(ready);
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_BATCH_H
+#define LOC_ENG_BATCH_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <hardware/gps.h>
+
+// Fixes a batch holds, an hour at 1 fix per 4 s
+#define LOC_ENG_BATCH_MAX_FIXES  1024
+
+// Module data, fixes collected for GPS_BATCHING_INTERFACE. Filled by the
+// deferred thread, drained by the client through read_batch.
+typedef struct
+{
+   gps_batch_ready_callback       batch_ready_cb;
+
+   pthread_mutex_t                lock;
+   bool                           active;
+   int64_t                        flush_period_ns;  // 0: only when full
+   int64_t                        last_flush_ns;    // CLOCK_MONOTONIC
+
+   // circular, oldest at head
+   GpsLocation                    fixes[LOC_ENG_BATCH_MAX_FIXES];
+   uint32_t                       head;
+   uint32_t                       num;
+   // overwritten since the last read
+   uint32_t                       overwritten;
+} loc_eng_batch_data_s_type;
+
+#endif // LOC_ENG_BATCH_H
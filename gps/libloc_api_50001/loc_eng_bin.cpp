@@ -0,0 +1,318 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng_bin"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <loc_eng.h>
+#include <loc_eng_bin.h>
+#include "log_util.h"
+
+static uint32_t crcTable[256];
+static bool crcTableReady = false;
+
+// records are written from the deferred action thread, the stream
+// is closed from loc_eng_cleanup
+static pthread_mutex_t streamLock = PTHREAD_MUTEX_INITIALIZER;
+static int streamFd = -1;
+static uint16_t streamSeq = 0;
+// to log a failing open once, not once per record
+static bool streamOpenFailed = false;
+
+/*===========================================================================
+FUNCTION    loc_eng_bin_crc32
+
+DESCRIPTION
+   CRC-32 (IEEE 802.3, reflected, polynomial 0xEDB88320) of data
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   the CRC
+
+SIDE EFFECTS
+   builds the lookup table on first use
+
+===========================================================================*/
+uint32_t loc_eng_bin_crc32(const uint8_t* data, int length)
+{
+    if (!crcTableReady) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            crcTable[i] = c;
+        }
+        crcTableReady = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (int i = 0; i < length; i++) {
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+static inline uint8_t* put16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static inline uint8_t* put32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static inline uint8_t* put64(uint8_t* p, uint64_t v)
+{
+    p = put32(p, (uint32_t)v);
+    return put32(p, (uint32_t)(v >> 32));
+}
+
+// rounds value * scale to the nearest integer, clamped to [min, max]
+static int64_t scaled(double value, double scale, int64_t min, int64_t max)
+{
+    double v = value * scale;
+    if (!(v >= (double)min)) {  // also catches nan
+        return min;
+    }
+    if (v >= (double)max) {
+        return max;
+    }
+    return (int64_t)floor(v + 0.5);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_bin_write
+
+DESCRIPTION
+   Fill in the header and the CRC of the record in buf and write it
+   out in one go. The stream is opened on the first record, and again
+   after a write error. It has to be a FIFO, anything else would just
+   keep growing. The fd is non blocking; if the reader falls behind
+   the record is dropped rather than stalling the deferred thread.
+
+   buf - record, with payloadLength bytes of payload after the header
+         and room for the trailer
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_bin_write(loc_eng_bin_record_e_type type,
+                              uint8_t* buf, int payloadLength)
+{
+    pthread_mutex_lock(&streamLock);
+    if (streamFd < 0) {
+        // O_RDWR, so a FIFO with no reader neither fails the open nor
+        // raises SIGPIPE, it just fills up and the records get dropped
+        streamFd = open(gps_conf.BINARY_FIX_STREAM,
+                        O_RDWR | O_NONBLOCK);
+        struct stat st;
+        if (streamFd >= 0 && (fstat(streamFd, &st) < 0 || !S_ISFIFO(st.st_mode))) {
+            close(streamFd);
+            streamFd = -1;
+            errno = EINVAL;
+        }
+        if (streamFd < 0) {
+            if (!streamOpenFailed) {
+                LOC_LOGE("%s: open FIFO %s failed, %s", __func__, gps_conf.BINARY_FIX_STREAM, strerror(errno));
+                streamOpenFailed = true;
+            }
+            pthread_mutex_unlock(&streamLock);
+            return;
+        }
+        streamOpenFailed = false;
+    }
+
+    uint8_t* p = buf;
+    *p++ = 'L';
+    *p++ = 'B';
+    *p++ = LOC_ENG_BIN_VERSION;
+    *p++ = (uint8_t)type;
+    p = put16(p, (uint16_t)payloadLength);
+    put16(p, streamSeq++);
+
+    int length = LOC_ENG_BIN_HEADER_LENGTH + payloadLength;
+    put32(buf + length, loc_eng_bin_crc32(buf, length));
+    length += LOC_ENG_BIN_TRAILER_LENGTH;
+
+    // records are way below PIPE_BUF, so they never get split
+    int written = write(streamFd, buf, length);
+    if (written != length) {
+        if (written < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+            LOC_LOGV("%s: reader too slow, record %d dropped", __func__, type);
+        } else {
+            LOC_LOGE("%s: write failed %d, %s", __func__, written, strerror(errno));
+            close(streamFd);
+            streamFd = -1;
+        }
+    }
+    pthread_mutex_unlock(&streamLock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_bin_close
+
+DESCRIPTION
+   Close the stream; the next record opens it again
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_bin_close()
+{
+    pthread_mutex_lock(&streamLock);
+    if (streamFd >= 0) {
+        close(streamFd);
+        streamFd = -1;
+    }
+    pthread_mutex_unlock(&streamLock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_bin_report_fix
+
+DESCRIPTION
+   Write a LOC_ENG_BIN_RECORD_FIX record for a position report
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_bin_report_fix(loc_eng_data_s_type *loc_eng_data_p, const GpsLocation &location,
+                            const GpsLocationExtended &locationExtended)
+{
+    uint8_t buf[LOC_ENG_BIN_HEADER_LENGTH + LOC_ENG_BIN_FIX_LENGTH + LOC_ENG_BIN_TRAILER_LENGTH];
+    uint8_t* p = buf + LOC_ENG_BIN_HEADER_LENGTH;
+
+    p = put64(p, (uint64_t)location.timestamp);
+    p = put32(p, (uint32_t)scaled(location.latitude, 1e7, INT32_MIN, INT32_MAX));
+    p = put32(p, (uint32_t)scaled(location.longitude, 1e7, INT32_MIN, INT32_MAX));
+    p = put32(p, (uint32_t)scaled(location.altitude, 1e3, INT32_MIN, INT32_MAX));
+    p = put32(p, (uint32_t)scaled(locationExtended.altitudeMeanSeaLevel, 1e3, INT32_MIN, INT32_MAX));
+    p = put32(p, (uint32_t)scaled(location.accuracy, 1e3, 0, UINT32_MAX));
+    p = put16(p, (uint16_t)scaled(location.speed, 1e2, 0, UINT16_MAX));
+    p = put16(p, (uint16_t)scaled(location.bearing, 1e2, 0, UINT16_MAX));
+    p = put16(p, (uint16_t)scaled(locationExtended.magneticDeviation, 1e2, INT16_MIN, INT16_MAX));
+    p = put16(p, (uint16_t)scaled(locationExtended.pdop, 1e2, 0, UINT16_MAX));
+    p = put16(p, (uint16_t)scaled(locationExtended.hdop, 1e2, 0, UINT16_MAX));
+    p = put16(p, (uint16_t)scaled(locationExtended.vdop, 1e2, 0, UINT16_MAX));
+    p = put16(p, location.flags);
+    p = put16(p, locationExtended.flags);
+    p = put16(p, location.position_source);
+    put16(p, 0);
+
+    loc_eng_bin_write(LOC_ENG_BIN_RECORD_FIX, buf, LOC_ENG_BIN_FIX_LENGTH);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_bin_report_sv
+
+DESCRIPTION
+   Write a LOC_ENG_BIN_RECORD_SV record for a sv report. svUsedMask is
+   the used in fix bitmap, LOC_ENG_SV_USED_MASK_WORDS long, of which the
+   first svUsedWords are known.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_bin_report_sv(loc_eng_data_s_type *loc_eng_data_p, const GpsSvStatus &svStatus,
+                           const uint32_t *svUsedMask, int svUsedWords)
+{
+    uint8_t buf[LOC_ENG_BIN_RECORD_MAX_LENGTH];
+    uint8_t* p = buf + LOC_ENG_BIN_HEADER_LENGTH;
+
+    int numSvs = svStatus.num_svs;
+    if (numSvs < 0) {
+        numSvs = 0;
+    } else if (numSvs > GPS_MAX_SVS) {
+        numSvs = GPS_MAX_SVS;
+    }
+
+    *p++ = (uint8_t)numSvs;
+    *p++ = LOC_ENG_BIN_SV_ENTRY_LENGTH;
+    p = put16(p, (uint16_t)svUsedWords);
+    p = put32(p, svStatus.ephemeris_mask);
+    p = put32(p, svStatus.almanac_mask);
+    for (int i = 0; i < LOC_ENG_BIN_SV_USED_WORDS; i++) {
+        p = put32(p, i < LOC_ENG_SV_USED_MASK_WORDS ? svUsedMask[i] : 0);
+    }
+
+    for (int i = 0; i < numSvs; i++) {
+        const GpsSvInfo &sv = svStatus.sv_list[i];
+        p = put16(p, (uint16_t)sv.prn);
+        p = put16(p, (uint16_t)scaled(sv.snr, 1e1, 0, UINT16_MAX));
+        p = put16(p, (uint16_t)scaled(sv.elevation, 1e2, INT16_MIN, INT16_MAX));
+        p = put16(p, (uint16_t)scaled(sv.azimuth, 1e2, 0, UINT16_MAX));
+    }
+
+    loc_eng_bin_write(LOC_ENG_BIN_RECORD_SV, buf,
+                      LOC_ENG_BIN_SV_HEAD_LENGTH + numSvs * LOC_ENG_BIN_SV_ENTRY_LENGTH);
+}
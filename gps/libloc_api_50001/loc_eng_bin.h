@@ -0,0 +1,113 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_BIN_H
+#define LOC_ENG_BIN_H
+
+#include <stdint.h>
+#include <hardware/gps.h>
+
+/* Binary fix stream, the compact alternative to the NMEA text.
+   Turned on by pointing BINARY_FIX_STREAM in gps.conf at a FIFO, which
+   the reader creates with mkfifo; a regular file is refused, as
+   nothing would ever trim it. Every fix and every sv report is written
+   there as one record, all fields little endian:
+
+   header, 8 bytes
+     0  uint8   'L'
+     1  uint8   'B'
+     2  uint8   version, LOC_ENG_BIN_VERSION
+     3  uint8   record type, loc_eng_bin_record_e_type
+     4  uint16  payload length
+     6  uint16  sequence number, +1 per record, for spotting drops
+   payload, see below
+   trailer, 4 bytes
+     0  uint32  CRC-32 (IEEE 802.3) of header and payload
+
+   A reader skips a record it does not know by its payload length.
+   Newer versions only ever append fields to a payload, so a reader
+   can also decode the known head of a longer payload. */
+
+#define LOC_ENG_BIN_VERSION          1
+#define LOC_ENG_BIN_HEADER_LENGTH    8
+#define LOC_ENG_BIN_TRAILER_LENGTH   4
+
+typedef enum {
+    LOC_ENG_BIN_RECORD_FIX = 1,
+    LOC_ENG_BIN_RECORD_SV  = 2
+} loc_eng_bin_record_e_type;
+
+/* LOC_ENG_BIN_RECORD_FIX payload
+     0  int64   timestamp, ms since the epoch, UTC
+     8  int32   latitude, 1e-7 deg
+    12  int32   longitude, 1e-7 deg
+    16  int32   altitude wrt WGS84 ellipsoid, mm
+    20  int32   altitude wrt mean sea level, mm
+    24  uint32  accuracy, mm
+    28  uint16  speed, cm/s
+    30  uint16  bearing, 0.01 deg
+    32  int16   magnetic deviation, 0.01 deg
+    34  uint16  pdop, 0.01
+    36  uint16  hdop, 0.01
+    38  uint16  vdop, 0.01
+    40  uint16  GpsLocation flags
+    42  uint16  GpsLocationExtended flags
+    44  uint16  position source
+    46  uint16  reserved */
+#define LOC_ENG_BIN_FIX_LENGTH       48
+
+/* LOC_ENG_BIN_RECORD_SV payload
+     0  uint8   number of svs
+     1  uint8   length of one sv entry
+     2  uint16  words of the used in fix bitmap that are known; the
+                PRNs past them may be used in the fix even though their
+                bits are clear. 0 from writers that left it reserved
+     4  uint32  ephemeris mask
+     8  uint32  almanac mask
+    12  uint32  used in fix bitmap, 3 words, PRN n is bit n - 1
+    24  sv entries, each
+          0  uint16  prn
+          2  uint16  snr, 0.1 dB-Hz
+          4  int16   elevation, 0.01 deg
+          6  uint16  azimuth, 0.01 deg */
+#define LOC_ENG_BIN_SV_HEAD_LENGTH   24
+#define LOC_ENG_BIN_SV_ENTRY_LENGTH  8
+#define LOC_ENG_BIN_SV_USED_WORDS    3
+
+#define LOC_ENG_BIN_RECORD_MAX_LENGTH \
+    (LOC_ENG_BIN_HEADER_LENGTH + LOC_ENG_BIN_SV_HEAD_LENGTH + \
+     GPS_MAX_SVS * LOC_ENG_BIN_SV_ENTRY_LENGTH + LOC_ENG_BIN_TRAILER_LENGTH)
+
+uint32_t loc_eng_bin_crc32(const uint8_t* data, int length);
+void loc_eng_bin_report_fix(loc_eng_data_s_type *loc_eng_data_p, const GpsLocation &location,
+                            const GpsLocationExtended &locationExtended);
+void loc_eng_bin_report_sv(loc_eng_data_s_type *loc_eng_data_p, const GpsSvStatus &svStatus,
+                           const uint32_t *svUsedMask, int svUsedWords);
+void loc_eng_bin_close();
+
+#endif // LOC_ENG_BIN_H
@@ -0,0 +1,281 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <loc_eng_conf_watch.h>
+#include "log_util.h"
+
+typedef struct {
+    loc_eng_data_s_type* loc_eng_data_p;
+    int fd;
+    int stopFds[2];        /* loc_eng_conf_watch_stop writes to [1] */
+    bool running;          /* under lock, cleared as the thread returns */
+    char dir[PATH_MAX];
+    const char* name;      /* points into GPS_CONF_FILE */
+} loc_eng_conf_watch_s_type;
+
+static loc_eng_conf_watch_s_type loc_eng_conf_watch;
+static pthread_mutex_t loc_eng_conf_watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loc_eng_conf_watch_cond = PTHREAD_COND_INITIALIZER;
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_watch_match
+
+DESCRIPTION
+   Looks through a buffer of inotify events for one about gps.conf.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   true if gps.conf was written or moved into place
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_conf_watch_match(const char* buf, ssize_t len)
+{
+    bool match = false;
+
+    while (len >= (ssize_t)sizeof(struct inotify_event)) {
+        const struct inotify_event* event = (const struct inotify_event*)buf;
+        ssize_t size = sizeof(struct inotify_event) + event->len;
+
+        if (event->len > 0 && 0 == strcmp(event->name, loc_eng_conf_watch.name)) {
+            match = true;
+        }
+        buf += size;
+        len -= size;
+    }
+    return match;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_watch_thread
+
+DESCRIPTION
+   Blocks on the inotify descriptor. After a change to gps.conf it keeps
+   draining events until none arrived for LOC_ENG_CONF_WATCH_SETTLE_MS,
+   then reloads the file once. Returns as soon as loc_eng_conf_watch_stop
+   writes to the stop pipe.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_conf_watch_thread(void* arg)
+{
+    loc_eng_conf_watch_s_type* watch = (loc_eng_conf_watch_s_type*)arg;
+    char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfds[2];
+    bool changed = false;
+    ssize_t len;
+    int ready;
+
+    pfds[0].fd = watch->fd;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = watch->stopFds[0];
+    pfds[1].events = POLLIN;
+
+    LOC_LOGD("%s: watching %s/%s", __func__, watch->dir, watch->name);
+    for (;;) {
+        // after a change, let the writer finish
+        ready = poll(pfds, 2, changed ? LOC_ENG_CONF_WATCH_SETTLE_MS : -1);
+        if (ready < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            LOC_LOGE("%s: poll failed: %s", __func__, strerror(errno));
+            break;
+        }
+        if (pfds[1].revents) {
+            LOC_LOGD("%s: stopped", __func__);
+            break;
+        }
+        if (0 == ready) {
+            // quiet for LOC_ENG_CONF_WATCH_SETTLE_MS
+            changed = false;
+            loc_eng_reload_config(*watch->loc_eng_data_p);
+            continue;
+        }
+
+        len = read(watch->fd, buf, sizeof(buf));
+        if (len < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            LOC_LOGE("%s: read failed: %s", __func__, strerror(errno));
+            break;
+        }
+        if (loc_eng_conf_watch_match(buf, len)) {
+            changed = true;
+        }
+    }
+
+    pthread_mutex_lock(&loc_eng_conf_watch_lock);
+    watch->running = false;
+    pthread_cond_broadcast(&loc_eng_conf_watch_cond);
+    pthread_mutex_unlock(&loc_eng_conf_watch_lock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_watch_start
+
+DESCRIPTION
+   Starts watching the directory that holds gps.conf. The directory
+   rather than the file is watched, so that replacing the file by a
+   rename is seen as well. Only the first call does anything.
+
+DEPENDENCIES
+   loc_eng_init has created the client
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_conf_watch_start(loc_eng_data_s_type &loc_eng_data,
+                             gps_create_thread threadCreator)
+{
+    ENTRY_LOG();
+    loc_eng_conf_watch_s_type* watch = &loc_eng_conf_watch;
+    const char* file = GPS_CONF_FILE;
+    const char* slash = strrchr(file, '/');
+    int ret_val = -1;
+
+    if (NULL != watch->loc_eng_data_p) {
+        LOC_LOGV("%s: already watching", __func__);
+        EXIT_LOG(%d, 0);
+        return 0;
+    }
+
+    if (NULL == slash) {
+        strlcpy(watch->dir, ".", sizeof(watch->dir));
+        watch->name = file;
+    } else {
+        // keep the slash of a file in the root directory
+        strlcpy(watch->dir, file, sizeof(watch->dir));
+        watch->dir[slash - file + (slash == file)] = '\0';
+        watch->name = slash + 1;
+    }
+
+    watch->fd = inotify_init();
+    if (watch->fd < 0) {
+        LOC_LOGE("%s: inotify_init failed: %s", __func__, strerror(errno));
+    } else if (inotify_add_watch(watch->fd, watch->dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        LOC_LOGE("%s: cannot watch %s: %s", __func__, watch->dir, strerror(errno));
+        close(watch->fd);
+    } else if (pipe(watch->stopFds) < 0) {
+        LOC_LOGE("%s: pipe failed: %s", __func__, strerror(errno));
+        close(watch->fd);
+    } else {
+        watch->loc_eng_data_p = &loc_eng_data;
+        watch->running = true;
+        if (0 == threadCreator(
+                "loc_eng_conf_watch", loc_eng_conf_watch_thread, watch)) {
+            LOC_LOGE("%s: cannot create thread", __func__);
+            watch->loc_eng_data_p = NULL;
+            watch->running = false;
+            close(watch->fd);
+            close(watch->stopFds[0]);
+            close(watch->stopFds[1]);
+        } else {
+            ret_val = 0;
+        }
+    }
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_watch_stop
+
+DESCRIPTION
+   Stops the watcher thread and waits until it has returned, so no
+   loc_eng_reload_config is in flight once this returns. The framework
+   creates the thread detached, hence the wait rather than a join.
+   Does nothing if the watcher is not running.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_conf_watch_stop()
+{
+    ENTRY_LOG();
+    loc_eng_conf_watch_s_type* watch = &loc_eng_conf_watch;
+
+    if (NULL == watch->loc_eng_data_p) {
+        EXIT_LOG(%s, VOID_RET);
+        return;
+    }
+
+    char stop = 0;
+    while (write(watch->stopFds[1], &stop, 1) < 0 && EINTR == errno);
+
+    pthread_mutex_lock(&loc_eng_conf_watch_lock);
+    while (watch->running) {
+        pthread_cond_wait(&loc_eng_conf_watch_cond, &loc_eng_conf_watch_lock);
+    }
+    pthread_mutex_unlock(&loc_eng_conf_watch_lock);
+
+    close(watch->fd);
+    close(watch->stopFds[0]);
+    close(watch->stopFds[1]);
+    watch->fd = -1;
+    watch->loc_eng_data_p = NULL;
+
+    EXIT_LOG(%s, VOID_RET);
+}
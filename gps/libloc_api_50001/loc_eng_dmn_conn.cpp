@@ -96,22 +96,19 @@ static int loc_api_server_proc(void *context)
     int length, sz;
     int result = 0;
     static int cnt = 0;
-    struct ctrl_msgbuf * p_cmsgbuf;
-    struct ctrl_msgbuf cmsg_resp;
+    // one message at a time, no need for the heap
+    union {
+        struct ctrl_msgbuf cmsg;
+        char buf[sizeof(struct ctrl_msgbuf) + 256];
+    } msgbuf;
+    struct ctrl_msgbuf * p_cmsgbuf = &msgbuf.cmsg;
 
-    sz = sizeof(struct ctrl_msgbuf) + 256;
-    p_cmsgbuf = (struct ctrl_msgbuf *) malloc(sz);
-
-    if (!p_cmsgbuf) {
-        LOC_LOGE("%s:%d] Out of memory\n", __func__, __LINE__);
-        return -1;
-    }
+    sz = sizeof(msgbuf);
 
     cnt ++;
     LOC_LOGD("%s:%d] %d listening on %s...\n", __func__, __LINE__, cnt, (char *) context);
     length = loc_eng_dmn_conn_glue_msgrcv(loc_api_server_msgqid, p_cmsgbuf, sz);
     if (length <= 0) {
-        free(p_cmsgbuf);
         LOC_LOGE("%s:%d] fail receiving msg from gpsone_daemon, retry later\n", __func__, __LINE__);
         usleep(1000);
         return 0;
@@ -137,7 +134,6 @@ static int loc_api_server_proc(void *context)
             break;
     }
 
-    free(p_cmsgbuf);
     return 0;
 }
 
@@ -153,10 +149,8 @@ static int loc_api_server_proc_post(void *context)
 
 static int loc_eng_dmn_conn_unblock_proc(void)
 {
-    struct ctrl_msgbuf cmsgbuf;
-    cmsgbuf.ctrl_type = GPSONE_UNBLOCK;
     LOC_LOGD("%s:%d]\n", __func__, __LINE__);
-    loc_eng_dmn_conn_glue_msgsnd(loc_api_server_msgqid, & cmsgbuf, sizeof(cmsgbuf));
+    loc_eng_dmn_conn_glue_msgunblock(loc_api_server_msgqid);
     return 0;
 }
 
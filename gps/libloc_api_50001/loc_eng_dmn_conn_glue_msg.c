@@ -34,8 +34,12 @@
 #include "log_util.h"
 
 #include "loc_eng_dmn_conn_glue_msg.h"
+#include "loc_eng_dmn_conn_glue_sock.h"
 #include "loc_eng_dmn_conn_handler.h"
 
+/* FEATURE_LOC_ENG_DMN_CONN_SOCKET carries the queues over SOCK_SEQPACKET
+   sockets instead of named pipes. The daemon must be built to match. */
+
 /*===========================================================================
 FUNCTION    loc_eng_dmn_conn_glue_msgget
 
@@ -58,7 +62,11 @@ SIDE EFFECTS
 int loc_eng_dmn_conn_glue_msgget(const char * q_path, int mode)
 {
     int msgqid;
+#ifdef FEATURE_LOC_ENG_DMN_CONN_SOCKET
+    msgqid = loc_eng_dmn_conn_glue_sockget(q_path, mode);
+#else
     msgqid = loc_eng_dmn_conn_glue_pipeget(q_path, mode);
+#endif
     return msgqid;
 }
 
@@ -84,7 +92,11 @@ SIDE EFFECTS
 int loc_eng_dmn_conn_glue_msgremove(const char * q_path, int msgqid)
 {
     int result;
+#ifdef FEATURE_LOC_ENG_DMN_CONN_SOCKET
+    result = loc_eng_dmn_conn_glue_sockremove(q_path, msgqid);
+#else
     result = loc_eng_dmn_conn_glue_piperemove(q_path, msgqid);
+#endif
     return result;
 }
 
@@ -114,7 +126,11 @@ int loc_eng_dmn_conn_glue_msgsnd(int msgqid, const void * msgp, size_t msgsz)
     struct ctrl_msgbuf *pmsg = (struct ctrl_msgbuf *) msgp;
     pmsg->msgsz = msgsz;
 
+#ifdef FEATURE_LOC_ENG_DMN_CONN_SOCKET
+    result = loc_eng_dmn_conn_glue_sockwrite(msgqid, msgp, msgsz);
+#else
     result = loc_eng_dmn_conn_glue_pipewrite(msgqid, msgp, msgsz);
+#endif
     if (result != (int) msgsz) {
         LOC_LOGE("%s:%d] pipe broken %d, msgsz = %d\n", __func__, __LINE__, result, (int) msgsz);
         return -1;
@@ -148,6 +164,24 @@ int loc_eng_dmn_conn_glue_msgrcv(int msgqid, void *msgp, size_t msgbufsz)
     int result;
     struct ctrl_msgbuf *pmsg = (struct ctrl_msgbuf *) msgp;
 
+#ifdef FEATURE_LOC_ENG_DMN_CONN_SOCKET
+    /* a socket keeps message boundaries, one read gets the whole message */
+    result = loc_eng_dmn_conn_glue_sockread(msgqid, msgp, msgbufsz);
+    if (result < (int) sizeof(pmsg->msgsz)) {
+        LOC_LOGE("%s:%d] socket broken %d\n", __func__, __LINE__, result);
+        return -1;
+    }
+
+    if (msgbufsz < (size_t) result) {
+        LOC_LOGE("%s:%d] msgbuf is too small %d < %d\n", __func__, __LINE__, (int) msgbufsz, result);
+        return -1;
+    }
+
+    if (pmsg->msgsz != (size_t) result) {
+        LOC_LOGE("%s:%d] bad msgsz = %d, received %d\n", __func__, __LINE__, (int) pmsg->msgsz, result);
+        return -1;
+    }
+#else
     result = loc_eng_dmn_conn_glue_piperead(msgqid, &(pmsg->msgsz), sizeof(pmsg->msgsz));
     if (result != sizeof(pmsg->msgsz)) {
         LOC_LOGE("%s:%d] pipe broken %d\n", __func__, __LINE__, result);
@@ -164,6 +198,7 @@ int loc_eng_dmn_conn_glue_msgrcv(int msgqid, void *msgp, size_t msgbufsz)
         LOC_LOGE("%s:%d] pipe broken %d, msgsz = %d\n", __func__, __LINE__, result, (int) pmsg->msgsz);
         return -1;
     }
+#endif
 
     return pmsg->msgsz;
 }
@@ -172,7 +207,8 @@ int loc_eng_dmn_conn_glue_msgrcv(int msgqid, void *msgp, size_t msgbufsz)
 FUNCTION    loc_eng_dmn_conn_glue_msgunblock
 
 DESCRIPTION
-   unblock a message queue
+   unblock a message queue, i.e. wake up whoever is waiting in
+   loc_eng_dmn_conn_glue_msgrcv with a GPSONE_UNBLOCK message
 
    msgqid - message queue id
 
@@ -188,7 +224,15 @@ SIDE EFFECTS
 ===========================================================================*/
 int loc_eng_dmn_conn_glue_msgunblock(int msgqid)
 {
-    return loc_eng_dmn_conn_glue_pipeunblock(msgqid);
+    struct ctrl_msgbuf cmsgbuf;
+    cmsgbuf.msgsz = sizeof(cmsgbuf);
+    cmsgbuf.ctrl_type = GPSONE_UNBLOCK;
+#ifdef FEATURE_LOC_ENG_DMN_CONN_SOCKET
+    return loc_eng_dmn_conn_glue_sockunblock(msgqid, &cmsgbuf, sizeof(cmsgbuf)) < 0 ? -1 : 0;
+#else
+    /* the pipe is opened for read and write, so the reader gets it */
+    return loc_eng_dmn_conn_glue_msgsnd(msgqid, &cmsgbuf, sizeof(cmsgbuf)) < 0 ? -1 : 0;
+#endif
 }
 
 /*===========================================================================
@@ -211,6 +255,10 @@ SIDE EFFECTS
 ===========================================================================*/
 int loc_eng_dmn_conn_glue_msgflush(int msgqid)
 {
+#ifdef FEATURE_LOC_ENG_DMN_CONN_SOCKET
+    /* nothing is buffered outside of the messages themselves */
+    return 0;
+#else
     int length;
     char buf[128];
 
@@ -219,5 +267,6 @@ int loc_eng_dmn_conn_glue_msgflush(int msgqid)
         LOC_LOGD("%s:%d] %s\n", __func__, __LINE__, buf);
     } while(length);
     return length;
+#endif
 }
 
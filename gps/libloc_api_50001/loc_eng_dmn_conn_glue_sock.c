@@ -0,0 +1,442 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#include "loc_eng_dmn_conn_glue_sock.h"
+#include "log_util.h"
+
+/* Each queue path is a listening SOCK_SEQPACKET socket. The daemon, QuIPC
+   and MSAPM connect to it, so a queue can have several peers. A single
+   epoll set covers the listening sockets, their peers and the wake up
+   socket pair, and is served by whoever calls sockread. */
+#define SOCK_MAX_CHANNELS 4
+#define SOCK_MAX_PEERS    4
+
+/* epoll tags: channel index in bits 8-15, peer slot in bits 0-7 */
+#define SOCK_TAG(chan, slot) ((uint32_t) (((chan) << 8) | (slot)))
+#define SOCK_TAG_LISTEN      0xff
+#define SOCK_TAG_WAKE        0xffff
+
+struct sock_channel {
+    int used;
+    int listen_fd;
+    int peer_fd[SOCK_MAX_PEERS];
+};
+
+static struct sock_channel sock_channels[SOCK_MAX_CHANNELS];
+static int sock_epoll_fd = -1;
+/* [0] is watched, sockunblock writes to [1] */
+static int sock_wake_fd[2] = {-1, -1};
+/* sockwrite may run on any thread, the peer tables change in sockread */
+static pthread_mutex_t sock_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int sock_epoll_add(int fd, uint32_t tag)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = tag;
+    return epoll_ctl(sock_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static int sock_find_channel(int fd)
+{
+    int i;
+    for (i = 0; i < SOCK_MAX_CHANNELS; i++) {
+        if (sock_channels[i].used && sock_channels[i].listen_fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* sets up the epoll set on first use; called with sock_mutex held */
+static int sock_epoll_init(void)
+{
+    if (sock_epoll_fd >= 0) {
+        return 0;
+    }
+
+    sock_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (sock_epoll_fd < 0) {
+        LOC_LOGE("epoll_create1 failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sock_wake_fd) < 0 ||
+        sock_epoll_add(sock_wake_fd[0], SOCK_TAG_WAKE) < 0) {
+        LOC_LOGE("wake up socket failed: %s\n", strerror(errno));
+        if (sock_wake_fd[0] >= 0) {
+            close(sock_wake_fd[0]);
+            close(sock_wake_fd[1]);
+            sock_wake_fd[0] = sock_wake_fd[1] = -1;
+        }
+        close(sock_epoll_fd);
+        sock_epoll_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/* tears the epoll set down with the last channel; called with sock_mutex held */
+static void sock_epoll_deinit(void)
+{
+    int i;
+    for (i = 0; i < SOCK_MAX_CHANNELS; i++) {
+        if (sock_channels[i].used) {
+            return;
+        }
+    }
+
+    close(sock_wake_fd[0]);
+    close(sock_wake_fd[1]);
+    sock_wake_fd[0] = sock_wake_fd[1] = -1;
+    close(sock_epoll_fd);
+    sock_epoll_fd = -1;
+}
+
+static void sock_accept_peer(int chan)
+{
+    int slot;
+    int fd = accept(sock_channels[chan].listen_fd, NULL, NULL);
+    if (fd < 0) {
+        LOC_LOGE("accept failed: %s\n", strerror(errno));
+        return;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    pthread_mutex_lock(&sock_mutex);
+    for (slot = 0; slot < SOCK_MAX_PEERS; slot++) {
+        if (sock_channels[chan].peer_fd[slot] < 0) {
+            break;
+        }
+    }
+    if (slot == SOCK_MAX_PEERS || sock_epoll_add(fd, SOCK_TAG(chan, slot)) < 0) {
+        LOC_LOGE("no room for a peer on %d\n", sock_channels[chan].listen_fd);
+        close(fd);
+    } else {
+        sock_channels[chan].peer_fd[slot] = fd;
+        LOC_LOGD("peer fd = %d on %d\n", fd, sock_channels[chan].listen_fd);
+    }
+    pthread_mutex_unlock(&sock_mutex);
+}
+
+static void sock_drop_peer(int chan, int slot)
+{
+    pthread_mutex_lock(&sock_mutex);
+    LOC_LOGD("peer fd = %d on %d gone\n", sock_channels[chan].peer_fd[slot],
+             sock_channels[chan].listen_fd);
+    close(sock_channels[chan].peer_fd[slot]);
+    sock_channels[chan].peer_fd[slot] = -1;
+    pthread_mutex_unlock(&sock_mutex);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockget
+
+DESCRIPTION
+   create a listening SOCK_SEQPACKET socket on a path, replacing whatever
+   is on the path.
+
+   sock_name - socket path
+   mode - unused, a socket is both read and written
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   fd of the listening socket or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockget(const char * sock_name, int mode)
+{
+    struct sockaddr_un addr;
+    int chan, slot;
+    int fd = -1;
+
+    LOC_LOGD("%s, mode = %d\n", sock_name, mode);
+    if (strlen(sock_name) >= sizeof(addr.sun_path)) {
+        LOC_LOGE("path too long: %s\n", sock_name);
+        return -1;
+    }
+
+    pthread_mutex_lock(&sock_mutex);
+    for (chan = 0; chan < SOCK_MAX_CHANNELS; chan++) {
+        if (!sock_channels[chan].used) {
+            break;
+        }
+    }
+    if (chan == SOCK_MAX_CHANNELS || sock_epoll_init() < 0) {
+        LOC_LOGE("no room for %s\n", sock_name);
+        goto err;
+    }
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOC_LOGE("failed: %s\n", strerror(errno));
+        goto err;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strlcpy(addr.sun_path, sock_name, sizeof(addr.sun_path));
+    unlink(sock_name);
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        listen(fd, SOCK_MAX_PEERS) < 0 ||
+        sock_epoll_add(fd, SOCK_TAG(chan, SOCK_TAG_LISTEN)) < 0) {
+        LOC_LOGE("failed: %s\n", strerror(errno));
+        close(fd);
+        fd = -1;
+        goto err;
+    }
+
+    sock_channels[chan].used = 1;
+    sock_channels[chan].listen_fd = fd;
+    for (slot = 0; slot < SOCK_MAX_PEERS; slot++) {
+        sock_channels[chan].peer_fd[slot] = -1;
+    }
+
+err:
+    pthread_mutex_unlock(&sock_mutex);
+    LOC_LOGD("fd = %d, %s\n", fd, sock_name);
+    return fd;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockremove
+
+DESCRIPTION
+   close a listening socket with all its peers and remove its path
+
+    sock_name - socket path
+    fd - fd of the listening socket
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockremove(const char * sock_name, int fd)
+{
+    int chan, slot;
+
+    pthread_mutex_lock(&sock_mutex);
+    chan = sock_find_channel(fd);
+    if (chan >= 0) {
+        for (slot = 0; slot < SOCK_MAX_PEERS; slot++) {
+            if (sock_channels[chan].peer_fd[slot] >= 0) {
+                close(sock_channels[chan].peer_fd[slot]);
+            }
+        }
+        close(fd);
+        sock_channels[chan].used = 0;
+        sock_epoll_deinit();
+    }
+    pthread_mutex_unlock(&sock_mutex);
+
+    if (sock_name) unlink(sock_name);
+    LOC_LOGD("fd = %d, %s\n", fd, sock_name);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockwrite
+
+DESCRIPTION
+   send a message to every peer connected to a socket. A peer that does
+   not keep up is skipped rather than waited for.
+
+   fd - fd of the listening socket
+   buf - buffer for the message
+   sz - size of the message
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   sz if at least one peer got the message or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockwrite(int fd, const void * buf, size_t sz)
+{
+    int chan, slot;
+    int result = -1;
+
+    pthread_mutex_lock(&sock_mutex);
+    chan = sock_find_channel(fd);
+    for (slot = 0; chan >= 0 && slot < SOCK_MAX_PEERS; slot++) {
+        int peer = sock_channels[chan].peer_fd[slot];
+        if (peer >= 0) {
+            if (send(peer, buf, sz, MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t) sz) {
+                result = (int) sz;
+            } else {
+                LOC_LOGE("send to %d failed: %s\n", peer, strerror(errno));
+            }
+        }
+    }
+    pthread_mutex_unlock(&sock_mutex);
+
+    return result;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockread
+
+DESCRIPTION
+   wait for the next message from a peer of the socket fd, accepting new
+   peers and closing hung up ones on any socket on the way. The other
+   sockets only carry messages to their peers, whatever a peer sends on
+   one of them is read and dropped. One call reads one message.
+
+   fd - fd of a listening socket
+   buf - buffer to hold the message
+   sz - size of the buffer
+
+DEPENDENCIES
+   Only one thread may read.
+
+RETURN VALUE
+   size of the message, more than sz if it did not fit, or negative value
+   for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockread(int fd, void * buf, size_t sz)
+{
+    int want = sock_find_channel(fd);
+    if (want < 0) {
+        LOC_LOGE("unknown fd %d\n", fd);
+        return -1;
+    }
+
+    while (1) {
+        struct epoll_event ev;
+        int chan, slot, peer;
+        ssize_t len;
+
+        if (epoll_wait(sock_epoll_fd, &ev, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOC_LOGE("epoll_wait failed: %s\n", strerror(errno));
+            return -1;
+        }
+
+        if (ev.data.u32 == SOCK_TAG_WAKE) {
+            return recv(sock_wake_fd[0], buf, sz, MSG_TRUNC);
+        }
+
+        chan = ev.data.u32 >> 8;
+        slot = ev.data.u32 & 0xff;
+        if (slot == SOCK_TAG_LISTEN) {
+            sock_accept_peer(chan);
+            continue;
+        }
+
+        peer = sock_channels[chan].peer_fd[slot];
+        if (ev.events & EPOLLIN) {
+            /* with MSG_TRUNC the full length comes back even if cut */
+            len = recv(peer, buf, sz, MSG_TRUNC | MSG_DONTWAIT);
+            if (len > 0 && chan != want) {
+                LOC_LOGE("dropped %d bytes from peer fd = %d on %d\n", (int) len,
+                         peer, sock_channels[chan].listen_fd);
+                continue;
+            }
+            if (len > 0) {
+                return (int) len;
+            }
+            if (len < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+        }
+
+        /* end of file, error or hang up */
+        sock_drop_peer(chan, slot);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockunblock
+
+DESCRIPTION
+   hand a message straight to the reader waiting in sockread, e.g. to
+   get it to check for exit.
+
+   fd - fd of a listening socket
+   buf - buffer for the message
+   sz - size of the message
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of bytes written or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockunblock(int fd, const void * buf, size_t sz)
+{
+    int result = -1;
+
+    pthread_mutex_lock(&sock_mutex);
+    if (sock_find_channel(fd) >= 0) {
+        result = send(sock_wake_fd[1], buf, sz, MSG_NOSIGNAL);
+    }
+    pthread_mutex_unlock(&sock_mutex);
+
+    if (result < 0) {
+        LOC_LOGE("failure, %s\n", strerror(errno));
+    }
+    return result;
+}
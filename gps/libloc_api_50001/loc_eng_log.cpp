@@ -104,7 +104,10 @@ static loc_name_val_s_type loc_eng_msgs[] =
     NAME_VAL( ULP_MSG_INJECT_NETWORK_POSITION ),
     NAME_VAL( ULP_MSG_REPORT_QUIPC_POSITION ),
     NAME_VAL( ULP_MSG_REQUEST_COARSE_POSITION ),
-    NAME_VAL( LOC_ENG_MSG_LPP_CONFIG )
+    NAME_VAL( LOC_ENG_MSG_LPP_CONFIG ),
+    NAME_VAL( LOC_ENG_MSG_RUNTIME_CONFIG ),
+    NAME_VAL( LOC_ENG_MSG_DROP_AGPS_SUBSCRIBERS ),
+    NAME_VAL( LOC_ENG_MSG_INJECT_XTRA_FILE )
 };
 static int loc_eng_msgs_num = sizeof(loc_eng_msgs) / sizeof(loc_name_val_s_type);
 
@@ -33,10 +33,13 @@
 #include <hardware/gps.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/mman.h>
 #include "log_util.h"
 #include "loc.h"
 #include <loc_eng_log.h>
 #include "loc_eng_msg_id.h"
+#include "loc_eng_msg_slab.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -109,6 +112,12 @@ typedef uint16_t GpsLocationExtendedFlags;
 /** GpsLocation has valid mode indicator. */
 #define GPS_LOCATION_EXTENDED_HAS_MODE_IND 0x0008
 
+/** Highest PRN covered by the used in fix bitmap; PRN n is bit (n - 1)
+    of the bitmap, so word 0 lines up with GpsSvStatus::used_in_fix_mask.
+    GPS is 1 - 32, SBAS 33 - 64 and GLONASS 65 - 96. */
+#define LOC_ENG_SV_USED_MASK_MAX_PRN 96
+#define LOC_ENG_SV_USED_MASK_WORDS   ((LOC_ENG_SV_USED_MASK_MAX_PRN + 31) / 32)
+
 /** Represents gps location extended. */
 typedef struct {
     /** set to sizeof(GpsLocationExtended) */
@@ -141,11 +150,31 @@ typedef enum {
   LOC_ENG_IF_REQUEST_SENDER_ID_UNKNOWN
 } loc_if_req_sender_id_e_type;
 
+// CLOCK_MONOTONIC in ns, the time base of loc_eng_msg::enqueueTime
+static inline int64_t loc_eng_msg_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// CLOCK_BOOTTIME in ms, which keeps counting through suspend
+static inline int64_t loc_eng_msg_boot_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 struct loc_eng_msg {
     const void* owner;
     const int msgid;
+    // when the msg went into deferred_q, for the latency stats.
+    // Msgs are mostly queued right after they are built; those that
+    // go through loc_eng_msg_sender, e.g. via ULP, get restamped there.
+    int64_t enqueueTime;
     inline loc_eng_msg(void* instance, int id) :
-        owner(instance), msgid(id)
+        owner(instance), msgid(id), enqueueTime(loc_eng_msg_now())
     {
         LOC_LOGV("creating msg %s", loc_get_msg_name(msgid));
         LOC_LOGV("creating msg ox%x", msgid);
@@ -155,6 +184,10 @@ struct loc_eng_msg {
         LOC_LOGV("deleting msg %s", loc_get_msg_name(msgid));
         LOC_LOGV("deleting msg ox%x", msgid);
     }
+    // msgs of all kinds come out of the slab installed by setSlab()
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+    static void setSlab(LocEngMsgSlab* slab);
 };
 
 struct loc_eng_msg_suple_version : public loc_eng_msg {
@@ -177,6 +210,22 @@ struct loc_eng_msg_lpp_config : public loc_eng_msg {
         }
 };
 
+// a loc_gps_cfg_s_type, as re-read by loc_eng_reload_config()
+struct loc_eng_msg_runtime_config : public loc_eng_msg {
+    char* const conf;
+    inline loc_eng_msg_runtime_config(void* instance, const void* newConf, size_t size) :
+        loc_eng_msg(instance, LOC_ENG_MSG_RUNTIME_CONFIG),
+        conf(new char[size])
+    {
+        memcpy((void*)conf, newConf, size);
+        LOC_LOGV("size: %d", (int)size);
+    }
+    inline ~loc_eng_msg_runtime_config()
+    {
+        delete[] conf;
+    }
+};
+
 struct loc_eng_msg_ext_power_config : public loc_eng_msg {
     const int isBatteryCharging;
     inline loc_eng_msg_ext_power_config(void* instance, int isBattCharging) :
@@ -350,10 +399,14 @@ struct loc_eng_msg_report_position : public loc_eng_msg {
     const void* locationExt;
     const enum loc_sess_status status;
     const LocPosTechMask technology_mask;
+    // CLOCK_BOOTTIME when the adapter reported the fix, to set the
+    // UTC time of the fix against rather than the time it is handled
+    const int64_t bootMs;
     inline loc_eng_msg_report_position(void* instance, GpsLocation &loc, GpsLocationExtended &locExtended, void* locExt,
                                        enum loc_sess_status st) :
         loc_eng_msg(instance, LOC_ENG_MSG_REPORT_POSITION),
-        location(loc), locationExtended(locExtended), locationExt(locExt), status(st), technology_mask(LOC_POS_TECH_MASK_DEFAULT)
+        location(loc), locationExtended(locExtended), locationExt(locExt), status(st), technology_mask(LOC_POS_TECH_MASK_DEFAULT),
+        bootMs(loc_eng_msg_boot_ms())
     {
         LOC_LOGV("flags: %d\n  source: %d\n  latitude: %f\n  longitude: %f\n  altitude: %f\n  speed: %f\n  bearing: %f\n  accuracy: %f\n  timestamp: %lld\n  rawDataSize: %d\n  rawData: %p\n  Session status: %d\n Technology mask: %u",
                  location.flags, location.position_source, location.latitude, location.longitude,
@@ -363,7 +416,8 @@ struct loc_eng_msg_report_position : public loc_eng_msg {
     inline loc_eng_msg_report_position(void* instance, GpsLocation &loc, GpsLocationExtended &locExtended, void* locExt,
                                        enum loc_sess_status st, LocPosTechMask technology) :
         loc_eng_msg(instance, LOC_ENG_MSG_REPORT_POSITION),
-        location(loc), locationExtended(locExtended), locationExt(locExt), status(st), technology_mask(technology)
+        location(loc), locationExtended(locExtended), locationExt(locExt), status(st), technology_mask(technology),
+        bootMs(loc_eng_msg_boot_ms())
     {
         LOC_LOGV("flags: %d\n  source: %d\n  latitude: %f\n  longitude: %f\n  altitude: %f\n  speed: %f\n  bearing: %f\n  accuracy: %f\n  timestamp: %lld\n  rawDataSize: %d\n  rawData: %p\n  Session status: %d\n Technology mask: %u",
                  location.flags, location.position_source, location.latitude, location.longitude,
@@ -376,8 +430,30 @@ struct loc_eng_msg_report_sv : public loc_eng_msg {
     const GpsSvStatus svStatus;
     const GpsLocationExtended locationExtended;
     const void* svExt;
+    // used in fix bitmap over all constellations, see
+    // LOC_ENG_SV_USED_MASK_MAX_PRN
+    uint32_t svUsedMask[LOC_ENG_SV_USED_MASK_WORDS];
+    // words of svUsedMask the adapter actually knows, the PRNs past
+    // them may still be used in the fix
+    const int svUsedWords;
     inline loc_eng_msg_report_sv(void* instance, GpsSvStatus &sv, GpsLocationExtended &locExtended, void* ext) :
-        loc_eng_msg(instance, LOC_ENG_MSG_REPORT_SV), svStatus(sv), locationExtended(locExtended), svExt(ext)
+        loc_eng_msg(instance, LOC_ENG_MSG_REPORT_SV), svStatus(sv), locationExtended(locExtended), svExt(ext),
+        svUsedWords(1)
+    {
+        memset(svUsedMask, 0, sizeof(svUsedMask));
+        svUsedMask[0] = svStatus.used_in_fix_mask;
+        logSvs();
+    }
+    // usedMask is LOC_ENG_SV_USED_MASK_WORDS long
+    inline loc_eng_msg_report_sv(void* instance, GpsSvStatus &sv, GpsLocationExtended &locExtended, void* ext,
+                                 const uint32_t* usedMask) :
+        loc_eng_msg(instance, LOC_ENG_MSG_REPORT_SV), svStatus(sv), locationExtended(locExtended), svExt(ext),
+        svUsedWords(LOC_ENG_SV_USED_MASK_WORDS)
+    {
+        memcpy(svUsedMask, usedMask, sizeof(svUsedMask));
+        logSvs();
+    }
+    inline void logSvs() const
     {
         LOC_LOGV("num sv: %d\n  ephemeris mask: %dxn  almanac mask: %x\n  used in fix mask: %x\n      sv: prn         snr       elevation      azimuth",
                  svStatus.num_svs, svStatus.ephemeris_mask, svStatus.almanac_mask, svStatus.used_in_fix_mask);
@@ -402,21 +478,27 @@ struct loc_eng_msg_report_status : public loc_eng_msg {
 };
 
 struct loc_eng_msg_report_nmea : public loc_eng_msg {
+    LocEngNmeaBuf* const buf;
     char* const nmea;
     const int length;
     inline loc_eng_msg_report_nmea(void* instance,
                                    const char* data,
                                    int len) :
         loc_eng_msg(instance, LOC_ENG_MSG_REPORT_NMEA),
-        nmea(new char[len]), length(len)
+        buf(LocEngNmeaBuf::get(len)),
+        nmea(NULL == buf ? NULL : buf->data),
+        length(NULL == buf ? 0 : len)
     {
-        memcpy((void*)nmea, (void*)data, len);
-        LOC_LOGV("length: %d\n  nmea: %p - %c%c%c",
-                 length, nmea, nmea[3], nmea[4], nmea[5]);
+        if (NULL != nmea) {
+            memcpy((void*)nmea, (void*)data, len);
+        }
+        LOC_LOGV("length: %d\n  nmea: %p", length, nmea);
     }
     inline ~loc_eng_msg_report_nmea()
     {
-        delete[] nmea;
+        if (NULL != buf) {
+            buf->unref();
+        }
     }
 };
 
@@ -692,6 +774,26 @@ struct loc_eng_msg_inject_xtra_data : public loc_eng_msg {
     }
 };
 
+// takes over a read-only mapping of the XTRA cache file, the pages
+// are faulted in from the page cache as the adapter walks them. The
+// XTRA data starts offset bytes into the mapping.
+struct loc_eng_msg_inject_xtra_file : public loc_eng_msg {
+    char* const map;
+    const int mapLength;
+    char* const data;
+    const int length;
+    inline loc_eng_msg_inject_xtra_file(void* instance, char* m, int ml, int offset) :
+        loc_eng_msg(instance, LOC_ENG_MSG_INJECT_XTRA_FILE),
+        map(m), mapLength(ml), data(m + offset), length(ml - offset)
+    {
+        LOC_LOGV("length: %d\n  data: %p", length, data);
+    }
+    inline ~loc_eng_msg_inject_xtra_file()
+    {
+        munmap(map, mapLength);
+    }
+};
+
 struct loc_eng_msg_atl_open_success : public loc_eng_msg {
     const AGpsStatusValue agpsType;
     const int length;
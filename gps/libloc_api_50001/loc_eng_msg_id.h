@@ -134,6 +134,18 @@ enum loc_eng_msg_ids_t {
     // Message is sent by Android framework (GpsLocationProvider)
     // to inject the raw command
     ULP_MSG_INJECT_RAW_COMMAND,
+
+    /* Message is sent by HAL to itself when a gps.conf reload changed
+       settings that live in the HAL rather than in the modem */
+    LOC_ENG_MSG_RUNTIME_CONFIG,
+
+    /* Message is sent by HAL to the AGPS thread when the engine comes
+       back up, the modem forgot the data calls it had asked for */
+    LOC_ENG_MSG_DROP_AGPS_SUBSCRIBERS,
+
+    /* Message is sent by HAL to inject the XTRA cache file, mapped
+       instead of copied */
+    LOC_ENG_MSG_INJECT_XTRA_FILE,
 };
 
 #ifdef __cplusplus
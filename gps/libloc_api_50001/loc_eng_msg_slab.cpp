@@ -0,0 +1,260 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_adapter"
+
+#include <new>
+#include <stdlib.h>
+#include <stdint.h>
+#include <loc_eng_msg_slab.h>
+#include "loc_eng_msg.h"
+#include "log_util.h"
+
+// free list link, overlays a block while it sits in its class
+struct LocEngMsgSlabBlock {
+    LocEngMsgSlabBlock* next;
+};
+
+struct LocEngMsgSlabClass {
+    size_t blockSize;
+    char* arena;
+    char* arenaEnd;
+    pthread_mutex_t lock;
+    LocEngMsgSlabBlock* freeList;
+    // allocations served from the arena
+    unsigned long hits;
+    // allocations that found the arena used up and went to the heap
+    unsigned long misses;
+    unsigned int inUse;
+};
+
+// the slab of the LocEngContext, if one is up
+static LocEngMsgSlab* sMsgSlab = NULL;
+
+static LocEngNmeaBuf sNmeaPool[LOC_ENG_NMEA_POOL_BUFS];
+// buffers of sNmeaPool beyond this have never been handed out
+static int sNmeaPoolUsed = 0;
+static LocEngNmeaBuf* sNmeaFreeList = NULL;
+static pthread_mutex_t sNmeaPoolLock = PTHREAD_MUTEX_INITIALIZER;
+
+void* loc_eng_msg::operator new(size_t size)
+{
+    if (NULL != sMsgSlab) {
+        return sMsgSlab->alloc(size);
+    }
+    return ::operator new(size);
+}
+
+void loc_eng_msg::operator delete(void* ptr)
+{
+    // msgs may have been new-ed before the slab was up, or by code
+    // built without these operators; those are not in any arena.
+    if (NULL == sMsgSlab || !sMsgSlab->free(ptr)) {
+        ::operator delete(ptr);
+    }
+}
+
+void loc_eng_msg::setSlab(LocEngMsgSlab* slab)
+{
+    sMsgSlab = slab;
+}
+
+LocEngMsgSlab::LocEngMsgSlab() :
+    mNumClasses(0), mHeapAllocs(0)
+{
+    // one class per msg shape that shows up at fix rate, the
+    // smallest one also takes most of the control msgs.
+    addClass(sizeof(loc_eng_msg_report_nmea));
+    addClass(sizeof(loc_eng_msg_sensor_perf_control_config));
+    addClass(sizeof(loc_eng_msg_report_position));
+    addClass(sizeof(loc_eng_msg_report_sv));
+}
+
+LocEngMsgSlab::~LocEngMsgSlab()
+{
+    for (int i = 0; i < mNumClasses; i++) {
+        LocEngMsgSlabClass* cls = mClasses[i];
+        if (0 != cls->inUse) {
+            LOC_LOGE("%s: %u blocks of %d bytes still in use",
+                     __func__, cls->inUse, (int)cls->blockSize);
+        }
+        ::free(cls->arena);
+        pthread_mutex_destroy(&cls->lock);
+        delete cls;
+    }
+}
+
+void LocEngMsgSlab::addClass(size_t size)
+{
+    int i;
+
+    // keep every block 8 byte aligned
+    size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+    // keep the classes sorted by size, without duplicates
+    for (i = 0; i < mNumClasses && mClasses[i]->blockSize < size; i++);
+    if ((i < mNumClasses && mClasses[i]->blockSize == size) ||
+        LOC_ENG_MSG_SLAB_MAX_CLASSES == mNumClasses) {
+        return;
+    }
+
+    char* arena = (char*)malloc(size * LOC_ENG_MSG_SLAB_CLASS_BLOCKS);
+    if (NULL == arena) {
+        LOC_LOGE("%s: out of memory for %d byte blocks", __func__, (int)size);
+        return;
+    }
+
+    LocEngMsgSlabClass* cls = new LocEngMsgSlabClass;
+    cls->blockSize = size;
+    cls->arena = arena;
+    cls->arenaEnd = arena + size * LOC_ENG_MSG_SLAB_CLASS_BLOCKS;
+    pthread_mutex_init(&cls->lock, NULL);
+    cls->freeList = NULL;
+    cls->hits = 0;
+    cls->misses = 0;
+    cls->inUse = 0;
+
+    for (char* block = cls->arenaEnd - size; block >= arena; block -= size) {
+        ((LocEngMsgSlabBlock*)block)->next = cls->freeList;
+        cls->freeList = (LocEngMsgSlabBlock*)block;
+    }
+
+    for (int j = mNumClasses; j > i; j--) {
+        mClasses[j] = mClasses[j-1];
+    }
+    mClasses[i] = cls;
+    mNumClasses++;
+}
+
+void* LocEngMsgSlab::alloc(size_t size)
+{
+    LocEngMsgSlabBlock* block = NULL;
+    int i;
+
+    for (i = 0; i < mNumClasses && mClasses[i]->blockSize < size; i++);
+
+    if (i == mNumClasses) {
+        __sync_fetch_and_add(&mHeapAllocs, 1);
+        return ::operator new(size);
+    }
+
+    LocEngMsgSlabClass* cls = mClasses[i];
+    pthread_mutex_lock(&cls->lock);
+    if (NULL != cls->freeList) {
+        block = cls->freeList;
+        cls->freeList = block->next;
+        cls->inUse++;
+        cls->hits++;
+    } else {
+        cls->misses++;
+    }
+    pthread_mutex_unlock(&cls->lock);
+
+    return NULL != block ? (void*)block : ::operator new(size);
+}
+
+bool LocEngMsgSlab::free(void* ptr)
+{
+    for (int i = 0; i < mNumClasses; i++) {
+        LocEngMsgSlabClass* cls = mClasses[i];
+        if ((char*)ptr >= cls->arena && (char*)ptr < cls->arenaEnd) {
+            LocEngMsgSlabBlock* block = (LocEngMsgSlabBlock*)ptr;
+            pthread_mutex_lock(&cls->lock);
+            block->next = cls->freeList;
+            cls->freeList = block;
+            cls->inUse--;
+            pthread_mutex_unlock(&cls->lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+void LocEngMsgSlab::logStats() const
+{
+    for (int i = 0; i < mNumClasses; i++) {
+        LocEngMsgSlabClass* cls = mClasses[i];
+        unsigned long total = cls->hits + cls->misses;
+        LOC_LOGD("msg slab %4d bytes: %lu allocs, hit rate %lu%%, %u in use",
+                 (int)cls->blockSize, total,
+                 0 == total ? 0 : cls->hits * 100 / total,
+                 cls->inUse);
+    }
+    LOC_LOGD("msg slab: %lu allocs too big for any class", mHeapAllocs);
+}
+
+LocEngNmeaBuf* LocEngNmeaBuf::get(int len)
+{
+    LocEngNmeaBuf* buf = NULL;
+
+    if (len <= LOC_ENG_NMEA_POOL_BUF_SIZE) {
+        pthread_mutex_lock(&sNmeaPoolLock);
+        if (NULL != sNmeaFreeList) {
+            buf = sNmeaFreeList;
+            sNmeaFreeList = buf->next;
+        } else if (sNmeaPoolUsed < LOC_ENG_NMEA_POOL_BUFS) {
+            buf = &sNmeaPool[sNmeaPoolUsed++];
+            buf->pooled = true;
+        }
+        pthread_mutex_unlock(&sNmeaPoolLock);
+    }
+
+    if (NULL == buf) {
+        size_t size = offsetof(LocEngNmeaBuf, data) + len;
+        if (size < sizeof(LocEngNmeaBuf)) {
+            size = sizeof(LocEngNmeaBuf);
+        }
+        buf = (LocEngNmeaBuf*)malloc(size);
+        if (NULL == buf) {
+            LOC_LOGE("%s: out of memory for %d bytes", __func__, len);
+            return NULL;
+        }
+        buf->pooled = false;
+    }
+
+    buf->refs = 1;
+    buf->next = NULL;
+    return buf;
+}
+
+void LocEngNmeaBuf::unref()
+{
+    if (0 != __sync_sub_and_fetch(&refs, 1)) {
+        return;
+    }
+
+    if (pooled) {
+        pthread_mutex_lock(&sNmeaPoolLock);
+        next = sNmeaFreeList;
+        sNmeaFreeList = this;
+        pthread_mutex_unlock(&sNmeaPoolLock);
+    } else {
+        ::free(this);
+    }
+}
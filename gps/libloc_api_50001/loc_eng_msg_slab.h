@@ -0,0 +1,96 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_MSG_SLAB_H
+#define LOC_ENG_MSG_SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// number of blocks preallocated per size class
+#define LOC_ENG_MSG_SLAB_CLASS_BLOCKS 32
+// max number of size classes
+#define LOC_ENG_MSG_SLAB_MAX_CLASSES  8
+
+struct LocEngMsgSlabClass;
+
+// Block allocator behind loc_eng_msg::operator new / delete.
+// Each size class is sized after one of the loc_eng_msg_* structs
+// and owns one preallocated arena of blocks, so the steady stream
+// of position, sv and nmea reports is served without going to the
+// heap. Msgs bigger than the biggest class, or showing up when
+// their class is used up, go to the heap as before.
+class LocEngMsgSlab {
+    LocEngMsgSlabClass* mClasses[LOC_ENG_MSG_SLAB_MAX_CLASSES];
+    int mNumClasses;
+    // msgs too big for any class
+    unsigned long mHeapAllocs;
+
+    void addClass(size_t size);
+
+public:
+    LocEngMsgSlab();
+    // all the blocks must have been freed by now
+    ~LocEngMsgSlab();
+
+    void* alloc(size_t size);
+    // returns false if ptr is not from any of the arenas
+    bool free(void* ptr);
+
+    // logs block size, hit / miss counts and blocks in use per class
+    void logStats() const;
+};
+
+// number of preallocated NMEA sentence buffers
+#define LOC_ENG_NMEA_POOL_BUFS        16
+// capacity of a preallocated NMEA sentence buffer
+#define LOC_ENG_NMEA_POOL_BUF_SIZE    256
+
+// Refcounted NMEA sentence storage. The REPORT_NMEA msg copies the
+// adapter's sentence into a buffer once and holds a reference on it,
+// and nmea_cb is handed the very same bytes. Buffers come out of a
+// preallocated pool; sentences longer than LOC_ENG_NMEA_POOL_BUF_SIZE,
+// or showing up when the pool is used up, get a heap buffer.
+struct LocEngNmeaBuf {
+    volatile int32_t refs;
+    // free list link while in the pool
+    LocEngNmeaBuf* next;
+    // false if the buffer came from the heap
+    bool pooled;
+    char data[LOC_ENG_NMEA_POOL_BUF_SIZE];
+
+    // returns a buffer of at least len bytes, with one reference
+    // held by the caller; NULL if out of memory
+    static LocEngNmeaBuf* get(int len);
+    inline void ref() { __sync_fetch_and_add(&refs, 1); }
+    // gives the buffer back once the last reference is dropped
+    void unref();
+};
+
+#endif // LOC_ENG_MSG_SLAB_H
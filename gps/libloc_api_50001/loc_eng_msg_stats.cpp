@@ -0,0 +1,189 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+
+#include <stdio.h>
+#include <string.h>
+#include <loc_eng_msg_stats.h>
+#include "loc_eng_log.h"
+#include "log_util.h"
+
+// bucket index of a value, see LOC_ENG_MSG_STATS_SUB_BITS
+static inline int bucketOf(uint32_t v)
+{
+    if (v < (1U << LOC_ENG_MSG_STATS_SUB_BITS)) {
+        return (int)v;
+    }
+    int msb = 31 - __builtin_clz(v);
+    int shift = msb - LOC_ENG_MSG_STATS_SUB_BITS;
+    return ((shift + 1) << LOC_ENG_MSG_STATS_SUB_BITS) +
+           (int)((v >> shift) & ((1U << LOC_ENG_MSG_STATS_SUB_BITS) - 1));
+}
+
+// largest value that still falls into bucket b
+static inline uint32_t bucketMax(int b)
+{
+    if (b < (1 << LOC_ENG_MSG_STATS_SUB_BITS)) {
+        return (uint32_t)b;
+    }
+    int shift = (b >> LOC_ENG_MSG_STATS_SUB_BITS) - 1;
+    uint64_t sub = (uint64_t)(b & ((1 << LOC_ENG_MSG_STATS_SUB_BITS) - 1));
+    uint64_t lower = ((1ULL << LOC_ENG_MSG_STATS_SUB_BITS) + sub) << shift;
+    return (uint32_t)(lower + (1ULL << shift) - 1);
+}
+
+void LocEngLatencyHistogram::record(uint32_t us)
+{
+    counts[bucketOf(us)]++;
+    num++;
+    sumUs += us;
+    if (us > maxUs) {
+        maxUs = us;
+    }
+}
+
+uint32_t LocEngLatencyHistogram::percentile(unsigned int pct) const
+{
+    if (0 == num) {
+        return 0;
+    }
+    // rank of the sample we are after, 1 based
+    uint64_t rank = ((uint64_t)num * pct + 99) / 100;
+    if (0 == rank) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < LOC_ENG_MSG_STATS_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+            uint32_t top = bucketMax(b);
+            return top < maxUs ? top : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+LocEngMsgStats::LocEngMsgStats() :
+    mDropped(0)
+{
+    memset(mSlots, 0, sizeof(mSlots));
+    pthread_mutex_init(&mLock, NULL);
+}
+
+LocEngMsgStats::~LocEngMsgStats()
+{
+    pthread_mutex_destroy(&mLock);
+}
+
+// open addressing on the msgid; the ids are dense within a few
+// ranges, so probes stay short. Called with mLock held.
+LocEngMsgStats::Slot* LocEngMsgStats::slotFor(int msgid)
+{
+    unsigned int start = (unsigned int)msgid & (LOC_ENG_MSG_STATS_MAX_IDS - 1);
+    for (unsigned int i = 0; i < LOC_ENG_MSG_STATS_MAX_IDS; i++) {
+        Slot* slot = &mSlots[(start + i) & (LOC_ENG_MSG_STATS_MAX_IDS - 1)];
+        if (!slot->used) {
+            slot->used = true;
+            slot->msgid = msgid;
+            return slot;
+        }
+        if (slot->msgid == msgid) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static inline uint32_t toUs(int64_t ns)
+{
+    if (ns <= 0) {
+        return 0;
+    }
+    int64_t us = ns / 1000;
+    return us > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+void LocEngMsgStats::record(int msgid, int64_t enqueueNs, int64_t startNs, int64_t endNs)
+{
+    pthread_mutex_lock(&mLock);
+    Slot* slot = slotFor(msgid);
+    if (NULL == slot) {
+        mDropped++;
+    } else {
+        if (0 != enqueueNs) {
+            slot->wait.record(toUs(startNs - enqueueNs));
+        }
+        slot->handler.record(toUs(endNs - startNs));
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+int LocEngMsgStats::dump(char* buf, int size) const
+{
+    if (NULL == buf || size <= 0) {
+        return 0;
+    }
+
+    int len = snprintf(buf, size, "deferred_q latency, us: msg count "
+                       "wait(avg p50 p90 p99 max) handler(avg p50 p90 p99 max)\n");
+
+    pthread_mutex_lock(&mLock);
+    for (int i = 0; i < LOC_ENG_MSG_STATS_MAX_IDS && len < size; i++) {
+        const Slot &slot = mSlots[i];
+        if (!slot.used) {
+            continue;
+        }
+        const LocEngLatencyHistogram &w = slot.wait;
+        const LocEngLatencyHistogram &h = slot.handler;
+        len += snprintf(buf + len, size - len,
+                        "%s %u (%u %u %u %u %u) (%u %u %u %u %u)\n",
+                        loc_get_msg_name(slot.msgid), h.num,
+                        w.num ? (uint32_t)(w.sumUs / w.num) : 0,
+                        w.percentile(50), w.percentile(90), w.percentile(99), w.maxUs,
+                        h.num ? (uint32_t)(h.sumUs / h.num) : 0,
+                        h.percentile(50), h.percentile(90), h.percentile(99), h.maxUs);
+    }
+    if (mDropped > 0 && len < size) {
+        len += snprintf(buf + len, size - len, "untracked msgs %lu\n", mDropped);
+    }
+    pthread_mutex_unlock(&mLock);
+
+    // snprintf reports what it wanted to write
+    return len < size ? len : size - 1;
+}
+
+void LocEngMsgStats::reset()
+{
+    pthread_mutex_lock(&mLock);
+    memset(mSlots, 0, sizeof(mSlots));
+    mDropped = 0;
+    pthread_mutex_unlock(&mLock);
+}
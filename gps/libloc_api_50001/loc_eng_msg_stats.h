@@ -0,0 +1,84 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_MSG_STATS_H
+#define LOC_ENG_MSG_STATS_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+// Log-linear buckets: every power of 2 is split into
+// 1 << LOC_ENG_MSG_STATS_SUB_BITS linear steps, so a bucket is never
+// wider than 25% of its value. Covers 0 us up to ~71 minutes.
+#define LOC_ENG_MSG_STATS_SUB_BITS    2
+#define LOC_ENG_MSG_STATS_BUCKETS     ((32 - LOC_ENG_MSG_STATS_SUB_BITS + 1) << LOC_ENG_MSG_STATS_SUB_BITS)
+// max number of distinct msgids tracked, power of 2
+#define LOC_ENG_MSG_STATS_MAX_IDS     64
+
+struct LocEngLatencyHistogram {
+    uint32_t counts[LOC_ENG_MSG_STATS_BUCKETS];
+    uint32_t num;
+    uint32_t maxUs;
+    uint64_t sumUs;
+
+    void record(uint32_t us);
+    // upper bound of the bucket holding the pct-th percentile
+    uint32_t percentile(unsigned int pct) const;
+};
+
+// Per msgid latency of the deferred action thread: how long a msg
+// sat in deferred_q, and how long its case in the big switch took.
+// Fed by the deferred thread, read by loc_eng_get_internal_state().
+class LocEngMsgStats {
+    struct Slot {
+        int msgid;
+        bool used;
+        LocEngLatencyHistogram wait;
+        LocEngLatencyHistogram handler;
+    };
+    Slot mSlots[LOC_ENG_MSG_STATS_MAX_IDS];
+    // msgids beyond LOC_ENG_MSG_STATS_MAX_IDS
+    unsigned long mDropped;
+    mutable pthread_mutex_t mLock;
+
+    Slot* slotFor(int msgid);
+
+public:
+    LocEngMsgStats();
+    ~LocEngMsgStats();
+
+    // all in CLOCK_MONOTONIC ns, see loc_eng_msg_now(); an
+    // enqueueNs of 0 means the wait is not known
+    void record(int msgid, int64_t enqueueNs, int64_t startNs, int64_t endNs);
+    // writes one line per msgid into buf, returns the number of bytes
+    // written, not counting the NUL
+    int dump(char* buf, int size) const;
+    void reset();
+};
+
+#endif // LOC_ENG_MSG_STATS_H
@@ -39,6 +39,7 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <time.h>
+#include <stdint.h>
 
 #include <loc_eng.h>
 
@@ -49,13 +50,18 @@
  *                             DATA DECLARATION
  *
  *============================================================================*/
+/* Instance the NI timeout callback ends sessions on; the timer itself
+   carries the request ID it was started for. */
+static loc_eng_data_s_type* loc_eng_ni_data_owner = NULL;
 
 /*=============================================================================
  *
  *                             FUNCTION DECLARATIONS
  *
  *============================================================================*/
-static void* ni_thread_proc(void *args);
+static void ni_timeout_cb(void *args);
+static bool loc_eng_ni_send_response(loc_eng_data_s_type &loc_eng_data,
+                                     int reqID, GpsUserResponseType resp);
 
 /*===========================================================================
 
@@ -83,8 +89,10 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
     }
 
     /* If busy, use default or deny */
+    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
     if (NULL != loc_eng_ni_data_p->rawRequest)
     {
+        pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
         /* XXX Consider sending a NO RESPONSE reply or queue the request */
         LOC_LOGW("loc_eng_ni_request_handler, notification in progress, new NI request ignored, type: %d",
                  notif->ni_type);
@@ -95,9 +103,11 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
     else {
         /* Save request */
         loc_eng_ni_data_p->rawRequest = (void*)passThrough;
+        int reqID = loc_eng_ni_data_p->reqID;
+        pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
 
         /* Fill in notification */
-        ((GpsNiNotification*)notif)->notification_id = loc_eng_ni_data_p->reqID;
+        ((GpsNiNotification*)notif)->notification_id = reqID;
 
         if (notif->notify_flags == GPS_NI_PRIVACY_OVERRIDE)
         {
@@ -113,22 +123,17 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
             LOC_LOGI("              extras: %s", notif->extras);
         }
 
-        /* For robustness, spawn a thread at this point to timeout to clear up the notification status, even though
+        /* For robustness, start a timer at this point to timeout to clear up the notification status, even though
          * the OEM layer in java does not do so.
          **/
         loc_eng_ni_data_p->respTimeLeft = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
         LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", loc_eng_ni_data_p->respTimeLeft);
 
-        int rc = 0;
-        rc = pthread_create(&loc_eng_ni_data_p->thread, NULL, ni_thread_proc, &loc_eng_data);
-        if (rc)
-        {
-            LOC_LOGE("Loc NI thread is not created.\n");
-        }
-        rc = pthread_detach(loc_eng_ni_data_p->thread);
-        if (rc)
+        if (loc_timer_start(&loc_eng_ni_data_p->timer,
+                            loc_eng_ni_data_p->respTimeLeft * 1000,
+                            ni_timeout_cb, (void*)(intptr_t)reqID))
         {
-            LOC_LOGE("Loc NI thread is not detached.\n");
+            LOC_LOGE("Loc NI timer is not started.\n");
         }
 
         CALLBACK_LOG_CALLFLOW("ni_notify_cb - id", %d, notif->notification_id);
@@ -139,68 +144,60 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
 
 /*===========================================================================
 
-FUNCTION ni_thread_proc
+FUNCTION ni_timeout_cb
+
+DESCRIPTION
+   Sends 'no response' for the request the timer was started for. The
+   callback may run after that request ended and a new one began, so
+   args holds the request ID rather than the instance.
 
 ===========================================================================*/
-static void* ni_thread_proc(void *args)
+static void ni_timeout_cb(void *args)
 {
     ENTRY_LOG();
+    int reqID = (int)(intptr_t)args;
+    LOC_LOGD("ni_timeout_cb-Time out after waiting for the user response, notif %d\n", reqID);
+    if (!loc_eng_ni_send_response(*loc_eng_ni_data_owner, reqID, GPS_NI_RESPONSE_NORESP)) {
+        LOC_LOGD("ni_timeout_cb-notif %d has already ended\n", reqID);
+    }
+    EXIT_LOG(%s, VOID_RET);
+}
 
-    loc_eng_data_s_type* loc_eng_data_p = (loc_eng_data_s_type*)args;
-    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data_p->loc_eng_ni_data;
-    int rc = 0;          /* return code from pthread calls */
+/*===========================================================================
 
-    struct timeval present_time;
-    struct timespec expire_time;
+FUNCTION loc_eng_ni_send_response
 
-    LOC_LOGD("Starting Loc NI thread...\n");
-    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
-    /* Calculate absolute expire time */
-    gettimeofday(&present_time, NULL);
-    expire_time.tv_sec  = present_time.tv_sec + loc_eng_ni_data_p->respTimeLeft;
-    expire_time.tv_nsec = present_time.tv_usec * 1000;
-    LOC_LOGD("ni_thread_proc-Time out set for abs time %ld with delay %d sec\n",
-             (long) expire_time.tv_sec, loc_eng_ni_data_p->respTimeLeft );
-
-    while (!loc_eng_ni_data_p->respRecvd)
-    {
-        rc = pthread_cond_timedwait(&loc_eng_ni_data_p->tCond,
-                                    &loc_eng_ni_data_p->tLock,
-                                    &expire_time);
-        if (rc == ETIMEDOUT)
-        {
-            loc_eng_ni_data_p->resp = GPS_NI_RESPONSE_NORESP;
-            LOC_LOGD("ni_thread_proc-Thread time out after valting for specified time. Ret Val %d\n",rc );
-            break;
-        }
-    }
-    LOC_LOGD("ni_thread_proc-Java layer has sent us a user response and return value from "
-             "pthread_cond_timedwait = %d\n",rc );
-    loc_eng_ni_data_p->respRecvd = FALSE; /* Reset the user response flag for the next session*/
+DESCRIPTION
+   Ends NI session reqID with the given response, unless it has ended
+   already, i.e. the user responded, it timed out, or the modem restarted.
+
+RETURN VALUE
+   true if the response was sent, false if reqID is not in session
 
-    // adding this check to support modem restart, in which case, we need the thread
-    // to exit without calling sending data to loc_eng_msg_q. We made sure that
-    // rawRequest is NULL in loc_eng_ni_reset_on_engine_restart()
+===========================================================================*/
+static bool loc_eng_ni_send_response(loc_eng_data_s_type &loc_eng_data,
+                                     int reqID, GpsUserResponseType resp)
+{
+    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
     loc_eng_msg_inform_ni_response *msg = NULL;
 
-    if (NULL != loc_eng_ni_data_p->rawRequest) {
-        loc_eng_data_s_type *loc_eng_data_p = (loc_eng_data_s_type*)args;
-        msg = new loc_eng_msg_inform_ni_response(loc_eng_data_p,
-                                                 loc_eng_ni_data_p->resp,
+    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
+    if (NULL != loc_eng_ni_data_p->rawRequest &&
+        reqID == loc_eng_ni_data_p->reqID) {
+        msg = new loc_eng_msg_inform_ni_response(&loc_eng_data,
+                                                 resp,
                                                  loc_eng_ni_data_p->rawRequest);
         loc_eng_ni_data_p->rawRequest = NULL;
+        loc_eng_ni_data_p->respTimeLeft = 0;
+        loc_eng_ni_data_p->reqID++;
     }
     pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
 
-    loc_eng_ni_data_p->respTimeLeft = 0;
-    loc_eng_ni_data_p->reqID++;
-
-    if (NULL != msg) {
-        loc_eng_msg_sender(loc_eng_data_p, msg);
+    if (NULL == msg) {
+        return false;
     }
-
-    EXIT_LOG(%s, VOID_RET);
-    return NULL;
+    loc_eng_msg_sender(&loc_eng_data, msg);
+    return true;
 }
 
 void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
@@ -214,15 +211,17 @@ void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
     }
 
     // only if modem has requested but then died.
+    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
     if (NULL != loc_eng_ni_data_p->rawRequest) {
+        // the goal is to end the session without telling the modem.
         free(loc_eng_ni_data_p->rawRequest);
         loc_eng_ni_data_p->rawRequest = NULL;
+        loc_eng_ni_data_p->respTimeLeft = 0;
+        loc_eng_ni_data_p->reqID++;
+        pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
 
-        pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
-        // the goal is to wake up ni_thread_proc
-        // and let it exit.
-        loc_eng_ni_data_p->respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->tCond);
+        loc_timer_stop(&loc_eng_ni_data_p->timer);
+    } else {
         pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
     }
 
@@ -255,12 +254,12 @@ void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data, GpsNiCallbacks *callback
         EXIT_LOG(%s, "loc_eng_ni_init: already inited.");
     } else {
         loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
+        memset(&loc_eng_ni_data_p->timer, 0, sizeof(loc_eng_ni_data_p->timer));
         loc_eng_ni_data_p->respTimeLeft = 0;
-        loc_eng_ni_data_p->respRecvd = FALSE;
         loc_eng_ni_data_p->rawRequest = NULL;
         loc_eng_ni_data_p->reqID = 0;
-        pthread_cond_init(&loc_eng_ni_data_p->tCond, NULL);
         pthread_mutex_init(&loc_eng_ni_data_p->tLock, NULL);
+        loc_eng_ni_data_owner = &loc_eng_data;
 
         loc_eng_data.ni_notify_cb = callbacks->notify_cb;
         EXIT_LOG(%s, VOID_RET);
@@ -294,19 +293,22 @@ void loc_eng_ni_respond(loc_eng_data_s_type &loc_eng_data,
         return;
     }
 
-    if (notif_id == loc_eng_ni_data_p->reqID &&
-        NULL != loc_eng_ni_data_p->rawRequest)
+    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
+    bool inSession = (notif_id == loc_eng_ni_data_p->reqID &&
+                      NULL != loc_eng_ni_data_p->rawRequest);
+    pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
+
+    if (inSession)
     {
         LOC_LOGI("loc_eng_ni_respond: send user response %d for notif %d", user_response, notif_id);
-        pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
-        loc_eng_ni_data_p->resp = user_response;
-        loc_eng_ni_data_p->respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
+        // stop the timer while the session still holds it; if it fired
+        // already, whichever of the two comes second finds notif_id ended
+        loc_timer_stop(&loc_eng_ni_data_p->timer);
+        loc_eng_ni_send_response(loc_eng_data, notif_id, user_response);
     }
     else {
-        LOC_LOGE("loc_eng_ni_respond: reqID %d and notif_id %d mismatch or rawRequest %p, response: %d",
-                 loc_eng_ni_data_p->reqID, notif_id, loc_eng_ni_data_p->rawRequest, user_response);
+        LOC_LOGE("loc_eng_ni_respond: notif_id %d is not in session, response: %d",
+                 notif_id, user_response);
     }
 
     EXIT_LOG(%s, VOID_RET);
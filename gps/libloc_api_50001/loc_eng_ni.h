@@ -31,18 +31,16 @@
 #define LOC_ENG_NI_H
 
 #include <stdbool.h>
+#include <loc_timer.h>
 
 #define LOC_NI_NO_RESPONSE_TIME            20                      /* secs */
 #define LOC_NI_NOTIF_KEY_ADDRESS           "Address"
 
 typedef struct {
-    pthread_t               thread;            /* NI thread */
+    loc_timer               timer;             /* NI response timeout */
     int                     respTimeLeft;       /* examine time for NI response */
-    bool                    respRecvd;   /* NI User reponse received or not from Java layer*/
     void*                   rawRequest;
     int                     reqID;         /* ID to check against response */
-    GpsUserResponseType     resp;
-    pthread_cond_t          tCond;
     pthread_mutex_t         tLock;
 } loc_eng_ni_data_s_type;
 
@@ -32,6 +32,7 @@
 
 #include <loc_eng.h>
 #include <loc_eng_nmea.h>
+#include <loc_eng_nmea_enc.h>
 #include <math.h>
 #include "log_util.h"
 
@@ -93,6 +94,239 @@ int loc_eng_nmea_put_checksum(char *pNmea, int maxSize)
     return (length + checksumLength);
 }
 
+// PRN ranges of the constellations, as the modem numbers them.
+// SBAS goes out with GPS, which is where NMEA 0183 puts it.
+static const struct {
+    int minPrn;
+    int maxPrn;
+    loc_eng_nmea_sv_system_e_type system;
+} svSystemTable[] = {
+    {  1,  64, LOC_ENG_NMEA_SV_SYSTEM_GPS },
+    { 65,  96, LOC_ENG_NMEA_SV_SYSTEM_GLONASS }
+};
+
+// talker of each loc_eng_nmea_sv_system_e_type
+static const char* const svSystemTalker[LOC_ENG_NMEA_SV_SYSTEM_MAX] = {
+    "GP",
+    "GL"
+};
+
+// talker for sentences built from more than one constellation
+#define NMEA_TALKER_MULTI_GNSS "GN"
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_sv_system
+
+DESCRIPTION
+   Map a PRN to the constellation it belongs to. PRNs out of the known
+   ranges are counted as GPS.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   loc_eng_nmea_sv_system_e_type
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+loc_eng_nmea_sv_system_e_type loc_eng_nmea_sv_system(int prn)
+{
+    for (unsigned int i = 0; i < sizeof(svSystemTable) / sizeof(svSystemTable[0]); i++)
+    {
+        if (prn >= svSystemTable[i].minPrn && prn <= svSystemTable[i].maxPrn)
+            return svSystemTable[i].system;
+    }
+    return LOC_ENG_NMEA_SV_SYSTEM_GPS;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_put_lat_long
+
+DESCRIPTION
+   Append the "ddmm.mmmmmm,N,dddmm.mmmmmm,E," fields shared by $GPRMC
+   and $GPGGA, or empty fields if there is no position
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_put_lat_long(LocEngNmeaEncoder &enc, const GpsLocation &location)
+{
+    if (location.flags & GPS_LOCATION_HAS_LAT_LONG)
+    {
+        double latitude = location.latitude;
+        double longitude = location.longitude;
+        char latHemisphere;
+        char lonHemisphere;
+
+        if (latitude > 0)
+        {
+            latHemisphere = 'N';
+        }
+        else
+        {
+            latHemisphere = 'S';
+            latitude *= -1.0;
+        }
+
+        if (longitude < 0)
+        {
+            lonHemisphere = 'W';
+            longitude *= -1.0;
+        }
+        else
+        {
+            lonHemisphere = 'E';
+        }
+
+        enc.putUInt((uint8_t)floor(latitude), 2);
+        enc.putFixed(fmod(latitude * 60.0 , 60.0), 2, 6);
+        enc.putComma();
+        enc.putChar(latHemisphere);
+        enc.putComma();
+        enc.putUInt((uint8_t)floor(longitude), 3);
+        enc.putFixed(fmod(longitude * 60.0 , 60.0), 2, 6);
+        enc.putComma();
+        enc.putChar(lonHemisphere);
+        enc.putComma();
+    }
+    else
+    {
+        enc.putStr(",,,,");
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_put_mode
+
+DESCRIPTION
+   Append the mode indicator of $GPVTG and $GPRMC
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_put_mode(LocEngNmeaEncoder &enc, loc_eng_data_s_type *loc_eng_data_p,
+                                  const GpsLocation &location)
+{
+    if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
+        enc.putChar('N'); // N means no fix
+    else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
+        enc.putChar('A'); // A means autonomous
+    else
+        enc.putChar('D'); // D means differential
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_finish_and_send
+
+DESCRIPTION
+   Close the sentence in enc and send it out
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_finish_and_send(LocEngNmeaEncoder &enc, char *pNmea,
+                                         loc_eng_data_s_type *loc_eng_data_p)
+{
+    int length = enc.finish();
+    if (length > 0)
+    {
+        loc_eng_nmea_send(pNmea, length, loc_eng_data_p);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_send_gsv
+
+DESCRIPTION
+   Send the GSV sentences of one constellation, 4 svs per sentence.
+   svIndex lists the entries of svStatus.sv_list to go out.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_send_gsv(LocEngNmeaEncoder &enc, char *pNmea,
+                                  loc_eng_data_s_type *loc_eng_data_p,
+                                  const char *talker, const GpsSvStatus &svStatus,
+                                  const int *svIndex, int svCount)
+{
+    if (svCount <= 0)
+    {
+        // no svs in view, so just send a blank GSV sentence
+        enc.begin(talker);
+        enc.putStr("GSV,1,1,0,");
+        loc_eng_nmea_finish_and_send(enc, pNmea, loc_eng_data_p);
+        return;
+    }
+
+    int sentenceCount = svCount / 4;
+    if (svCount % 4)
+        sentenceCount++;
+    int sentenceNumber = 1;
+    int svNumber = 1;
+
+    while (sentenceNumber <= sentenceCount)
+    {
+        enc.begin(talker);
+        enc.putStr("GSV,");
+        enc.putUInt(sentenceCount, 1);
+        enc.putComma();
+        enc.putUInt(sentenceNumber, 1);
+        enc.putComma();
+        enc.putUInt(svCount, 2);
+
+        for (int i=0; (svNumber <= svCount) && (i < 4); i++, svNumber++)
+        {
+            const GpsSvInfo &sv = svStatus.sv_list[svIndex[svNumber-1]];
+
+            enc.putComma();
+            enc.putInt(sv.prn, 2);
+            enc.putComma();
+            enc.putInt((int)(0.5 + sv.elevation), 2); //float to int
+            enc.putComma();
+            enc.putInt((int)(0.5 + sv.azimuth), 3); //float to int
+            enc.putComma();
+
+            if (sv.snr > 0)
+            {
+                enc.putInt((int)(0.5 + sv.snr), 2); //float to int
+            }
+        }
+
+        loc_eng_nmea_finish_and_send(enc, pNmea, loc_eng_data_p);
+        sentenceNumber++;
+    }
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_nmea_generate_pos
 
@@ -114,268 +348,193 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
 {
     ENTRY_LOG();
 
-    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
-    int length = 0;
+    char sentence[NMEA_SENTENCE_MAX_LENGTH];
+    LocEngNmeaEncoder enc(sentence, sizeof(sentence));
 
-    time_t utcTime(location.timestamp/1000);
-    tm * pTm = gmtime(&utcTime);
-    int utcYear = pTm->tm_year % 100; // 2 digit year
-    int utcMonth = pTm->tm_mon + 1; // tm_mon starts at zero
-    int utcDay = pTm->tm_mday;
-    int utcHours = pTm->tm_hour;
-    int utcMinutes = pTm->tm_min;
-    int utcSeconds = pTm->tm_sec;
+    struct tm utcTm;
+    loc_eng_nmea_utc_time((time_t)(location.timestamp/1000), &utcTm);
+    int utcYear = utcTm.tm_year % 100; // 2 digit year
+    int utcMonth = utcTm.tm_mon + 1; // tm_mon starts at zero
+    int utcDay = utcTm.tm_mday;
+    int utcHours = utcTm.tm_hour;
+    int utcMinutes = utcTm.tm_min;
+    int utcSeconds = utcTm.tm_sec;
+
+    // dop is in locationExtended (QMI), or was cached from sv report (RPC)
+    bool hasDop = true;
+    float pdop = locationExtended.pdop;
+    float hdop = locationExtended.hdop;
+    float vdop = locationExtended.vdop;
+    if (!(locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP))
+    {
+        pdop = loc_eng_data_p->pdop;
+        hdop = loc_eng_data_p->hdop;
+        vdop = loc_eng_data_p->vdop;
+        hasDop = (pdop > 0 && hdop > 0 && vdop > 0);
+    }
 
     // ------------------
     // ------$GPGSA------
     // ------------------
 
+    // used svs, split by constellation
     uint32_t svUsedCount = 0;
-    uint32_t svUsedList[32] = {0};
-    uint32_t mask = loc_eng_data_p->sv_used_mask;
-    for (uint8_t i = 1; mask > 0 && svUsedCount < 32; i++)
+    uint32_t svUsedSystemCount[LOC_ENG_NMEA_SV_SYSTEM_MAX] = {0};
+    uint32_t svUsedList[LOC_ENG_NMEA_SV_SYSTEM_MAX][32] = {{0}};
+    for (int prn = 1; prn <= LOC_ENG_SV_USED_MASK_MAX_PRN; prn++)
     {
-        if (mask & 1)
-            svUsedList[svUsedCount++] = i;
-        mask = mask >> 1;
+        if (loc_eng_data_p->sv_used_mask[(prn - 1) / 32] & (1U << ((prn - 1) % 32)))
+        {
+            loc_eng_nmea_sv_system_e_type system = loc_eng_nmea_sv_system(prn);
+            if (svUsedSystemCount[system] < 32)
+            {
+                svUsedList[system][svUsedSystemCount[system]++] = prn;
+                svUsedCount++;
+            }
+        }
     }
     // clear the cache so they can't be used again
-    loc_eng_data_p->sv_used_mask = 0;
+    memset(loc_eng_data_p->sv_used_mask, 0, sizeof(loc_eng_data_p->sv_used_mask));
+
+    // a fix from a single constellation keeps its own talker, a
+    // combined fix goes out as $GN, with one $GNGSA per constellation
+    const char* talker = svSystemTalker[LOC_ENG_NMEA_SV_SYSTEM_GPS];
+    int svUsedSystems = 0;
+    for (int system = 0; system < LOC_ENG_NMEA_SV_SYSTEM_MAX; system++)
+    {
+        if (svUsedSystemCount[system] > 0)
+        {
+            talker = svSystemTalker[system];
+            svUsedSystems++;
+        }
+    }
+    if (svUsedSystems > 1)
+        talker = NMEA_TALKER_MULTI_GNSS;
 
     char fixType;
-    if (svUsedCount == 0)
+    if (svUsedCount > 3)
+        fixType = '3'; // 3D fix
+    else if (loc_eng_data_p->sv_used_words < LOC_ENG_SV_USED_MASK_WORDS)
+        // the count leaves out the svs past the known words, e.g. all of
+        // GLONASS, go by the fix itself
+        fixType = (location.flags & GPS_LOCATION_HAS_ALTITUDE) ? '3' : '2';
+    else if (svUsedCount == 0)
         fixType = '1'; // no fix
-    else if (svUsedCount <= 3)
-        fixType = '2'; // 2D fix
     else
-        fixType = '3'; // 3D fix
-
-    length = snprintf(pMarker, lengthRemaining, "$GPGSA,A,%c,", fixType);
+        fixType = '2'; // 2D fix
 
-    if (length < 0 || length >= lengthRemaining)
+    for (int system = 0; system < LOC_ENG_NMEA_SV_SYSTEM_MAX; system++)
     {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+        // with no sv used, still send one blank $GPGSA
+        if (svUsedSystemCount[system] == 0 &&
+            !(svUsedSystems == 0 && system == LOC_ENG_NMEA_SV_SYSTEM_GPS))
+            continue;
 
-    for (uint8_t i = 0; i < 12; i++) // only the first 12 sv go in sentence
-    {
-        if (i < svUsedCount)
-            length = snprintf(pMarker, lengthRemaining, "%02d,", svUsedList[i]);
-        else
-            length = snprintf(pMarker, lengthRemaining, ",");
+        enc.begin(talker);
+        enc.putStr("GSA,A,");
+        enc.putChar(fixType);
+        enc.putComma();
 
-        if (length < 0 || length >= lengthRemaining)
+        for (uint8_t i = 0; i < 12; i++) // only the first 12 sv go in sentence
         {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
+            if (i < svUsedSystemCount[system])
+                enc.putUInt(svUsedList[system][i], 2);
+            enc.putComma();
         }
-        pMarker += length;
-        lengthRemaining -= length;
-    }
 
-    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-    {   // dop is in locationExtended, (QMI)
-        length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                          locationExtended.pdop,
-                          locationExtended.hdop,
-                          locationExtended.vdop);
-    }
-    else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
-    {   // dop was cached from sv report (RPC)
-        length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                          loc_eng_data_p->pdop,
-                          loc_eng_data_p->hdop,
-                          loc_eng_data_p->vdop);
-    }
-    else
-    {   // no dop
-        length = snprintf(pMarker, lengthRemaining, ",,");
-    }
+        if (hasDop)
+        {
+            enc.putFixed(pdop, 1, 1);
+            enc.putComma();
+            enc.putFixed(hdop, 1, 1);
+            enc.putComma();
+            enc.putFixed(vdop, 1, 1);
+        }
+        else
+        {   // no dop
+            enc.putStr(",,");
+        }
 
-    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-    loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        loc_eng_nmea_finish_and_send(enc, sentence, loc_eng_data_p);
+    }
 
     // ------------------
     // ------$GPVTG------
     // ------------------
 
-    pMarker = sentence;
-    lengthRemaining = sizeof(sentence);
+    enc.begin(talker);
+    enc.putStr("VTG,");
 
     if (location.flags & GPS_LOCATION_HAS_BEARING)
     {
         float magTrack = location.bearing;
         if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
         {
-            float magTrack = location.bearing - locationExtended.magneticDeviation;
+            magTrack = location.bearing - locationExtended.magneticDeviation;
             if (magTrack < 0.0)
                 magTrack += 360.0;
             else if (magTrack > 360.0)
                 magTrack -= 360.0;
         }
 
-        length = snprintf(pMarker, lengthRemaining, "$GPVTG,%.1lf,T,%.1lf,M,", location.bearing, magTrack);
+        enc.putFixed(location.bearing, 1, 1);
+        enc.putStr(",T,");
+        enc.putFixed(magTrack, 1, 1);
+        enc.putStr(",M,");
     }
     else
     {
-        length = snprintf(pMarker, lengthRemaining, "$GPVTG,,T,,M,");
+        enc.putStr(",T,,M,");
     }
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
-
     if (location.flags & GPS_LOCATION_HAS_SPEED)
     {
         float speedKnots = location.speed * (3600.0/1852.0);
         float speedKmPerHour = location.speed * 3.6;
 
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,N,%.1lf,K,", speedKnots, speedKmPerHour);
+        enc.putFixed(speedKnots, 1, 1);
+        enc.putStr(",N,");
+        enc.putFixed(speedKmPerHour, 1, 1);
+        enc.putStr(",K,");
     }
     else
     {
-        length = snprintf(pMarker, lengthRemaining, ",N,,K,");
+        enc.putStr(",N,,K,");
     }
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
-
-    if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
-        length = snprintf(pMarker, lengthRemaining, "%c", 'N'); // N means no fix
-    else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
-        length = snprintf(pMarker, lengthRemaining, "%c", 'A'); // A means autonomous
-    else
-        length = snprintf(pMarker, lengthRemaining, "%c", 'D'); // D means differential
-
-    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-    loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+    loc_eng_nmea_put_mode(enc, loc_eng_data_p, location);
+    loc_eng_nmea_finish_and_send(enc, sentence, loc_eng_data_p);
 
     // ------------------
     // ------$GPRMC------
     // ------------------
 
-    pMarker = sentence;
-    lengthRemaining = sizeof(sentence);
-
-    length = snprintf(pMarker, lengthRemaining, "$GPRMC,%02d%02d%02d,A," ,
-                      utcHours, utcMinutes, utcSeconds);
-
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
-
-    if (location.flags & GPS_LOCATION_HAS_LAT_LONG)
-    {
-        double latitude = location.latitude;
-        double longitude = location.longitude;
-        char latHemisphere;
-        char lonHemisphere;
-        double latMinutes;
-        double lonMinutes;
-
-        if (latitude > 0)
-        {
-            latHemisphere = 'N';
-        }
-        else
-        {
-            latHemisphere = 'S';
-            latitude *= -1.0;
-        }
-
-        if (longitude < 0)
-        {
-            lonHemisphere = 'W';
-            longitude *= -1.0;
-        }
-        else
-        {
-            lonHemisphere = 'E';
-        }
-
-        latMinutes = fmod(latitude * 60.0 , 60.0);
-        lonMinutes = fmod(longitude * 60.0 , 60.0);
+    enc.begin(talker);
+    enc.putStr("RMC,");
+    enc.putUInt(utcHours, 2);
+    enc.putUInt(utcMinutes, 2);
+    enc.putUInt(utcSeconds, 2);
+    enc.putStr(",A,");
 
-        length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                          (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                          (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining,",,,,");
-    }
-
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+    loc_eng_nmea_put_lat_long(enc, location);
 
     if (location.flags & GPS_LOCATION_HAS_SPEED)
     {
         float speedKnots = location.speed * (3600.0/1852.0);
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,", speedKnots);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining, ",");
+        enc.putFixed(speedKnots, 1, 1);
     }
-
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+    enc.putComma();
 
     if (location.flags & GPS_LOCATION_HAS_BEARING)
     {
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,", location.bearing);
+        enc.putFixed(location.bearing, 1, 1);
     }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining, ",");
-    }
-
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
-
-    length = snprintf(pMarker, lengthRemaining, "%2.2d%2.2d%2.2d,",
-                      utcDay, utcMonth, utcYear);
+    enc.putComma();
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+    enc.putUInt(utcDay, 2);
+    enc.putUInt(utcMonth, 2);
+    enc.putUInt(utcYear, 2);
+    enc.putComma();
 
     if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
     {
@@ -391,98 +550,31 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
             direction = 'E';
         }
 
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,%c,",
-                          magneticVariation, direction);
+        enc.putFixed(magneticVariation, 1, 1);
+        enc.putComma();
+        enc.putChar(direction);
+        enc.putComma();
     }
     else
     {
-        length = snprintf(pMarker, lengthRemaining, ",,");
-    }
-
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
+        enc.putStr(",,");
     }
-    pMarker += length;
-    lengthRemaining -= length;
-
-    if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
-        length = snprintf(pMarker, lengthRemaining, "%c", 'N'); // N means no fix
-    else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
-        length = snprintf(pMarker, lengthRemaining, "%c", 'A'); // A means autonomous
-    else
-        length = snprintf(pMarker, lengthRemaining, "%c", 'D'); // D means differential
 
-    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-    loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+    loc_eng_nmea_put_mode(enc, loc_eng_data_p, location);
+    loc_eng_nmea_finish_and_send(enc, sentence, loc_eng_data_p);
 
     // ------------------
     // ------$GPGGA------
     // ------------------
 
-    pMarker = sentence;
-    lengthRemaining = sizeof(sentence);
-
-    length = snprintf(pMarker, lengthRemaining, "$GPGGA,%02d%02d%02d," ,
-                      utcHours, utcMinutes, utcSeconds);
-
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
-
-    if (location.flags & GPS_LOCATION_HAS_LAT_LONG)
-    {
-        double latitude = location.latitude;
-        double longitude = location.longitude;
-        char latHemisphere;
-        char lonHemisphere;
-        double latMinutes;
-        double lonMinutes;
-
-        if (latitude > 0)
-        {
-            latHemisphere = 'N';
-        }
-        else
-        {
-            latHemisphere = 'S';
-            latitude *= -1.0;
-        }
-
-        if (longitude < 0)
-        {
-            lonHemisphere = 'W';
-            longitude *= -1.0;
-        }
-        else
-        {
-            lonHemisphere = 'E';
-        }
-
-        latMinutes = fmod(latitude * 60.0 , 60.0);
-        lonMinutes = fmod(longitude * 60.0 , 60.0);
-
-        length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                          (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                          (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining,",,,,");
-    }
+    enc.begin(talker);
+    enc.putStr("GGA,");
+    enc.putUInt(utcHours, 2);
+    enc.putUInt(utcMinutes, 2);
+    enc.putUInt(utcSeconds, 2);
+    enc.putComma();
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+    loc_eng_nmea_put_lat_long(enc, location);
 
     char gpsQuality;
     if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
@@ -492,61 +584,38 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
     else
         gpsQuality = '2'; // 2 means DGPS fix
 
-    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-    {   // dop is in locationExtended, (QMI)
-        length = snprintf(pMarker, lengthRemaining, "%c,%02d,%.1f,",
-                          gpsQuality, svUsedCount, locationExtended.hdop);
-    }
-    else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
-    {   // dop was cached from sv report (RPC)
-        length = snprintf(pMarker, lengthRemaining, "%c,%02d,%.1f,",
-                          gpsQuality, svUsedCount, loc_eng_data_p->hdop);
-    }
-    else
-    {   // no hdop
-        length = snprintf(pMarker, lengthRemaining, "%c,%02d,,",
-                          gpsQuality, svUsedCount);
-    }
-
-    if (length < 0 || length >= lengthRemaining)
+    enc.putChar(gpsQuality);
+    enc.putComma();
+    enc.putUInt(svUsedCount, 2);
+    enc.putComma();
+    if (hasDop)
     {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
+        enc.putFixed(hdop, 1, 1);
     }
-    pMarker += length;
-    lengthRemaining -= length;
+    enc.putComma();
 
     if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL)
     {
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,M,",
-                          locationExtended.altitudeMeanSeaLevel);
+        enc.putFixed(locationExtended.altitudeMeanSeaLevel, 1, 1);
+        enc.putStr(",M,");
     }
     else
     {
-        length = snprintf(pMarker, lengthRemaining,",,");
+        enc.putStr(",,");
     }
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
-
     if ((location.flags & GPS_LOCATION_HAS_ALTITUDE) &&
         (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL))
     {
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,M,,",
-                          location.altitude - locationExtended.altitudeMeanSeaLevel);
+        enc.putFixed(location.altitude - locationExtended.altitudeMeanSeaLevel, 1, 1);
+        enc.putStr(",M,,");
     }
     else
     {
-        length = snprintf(pMarker, lengthRemaining,",,,");
+        enc.putStr(",,,");
     }
 
-    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-    loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+    loc_eng_nmea_finish_and_send(enc, sentence, loc_eng_data_p);
 
     // clear the dop cache so they can't be used again
     loc_eng_data_p->pdop = 0;
@@ -562,7 +631,9 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
 FUNCTION    loc_eng_nmea_generate_sv
 
 DESCRIPTION
-   Generate NMEA sentences generated based on sv report
+   Generate NMEA sentences generated based on sv report. svUsedMask is
+   the used in fix bitmap, LOC_ENG_SV_USED_MASK_WORDS long, of which the
+   first svUsedWords are known.
 
 DEPENDENCIES
    NONE
@@ -575,111 +646,73 @@ SIDE EFFECTS
 
 ===========================================================================*/
 void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
-                              const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended)
+                              const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended,
+                              const uint32_t *svUsedMask, int svUsedWords)
 {
     ENTRY_LOG();
 
-    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
-    int length = 0;
+    char sentence[NMEA_SENTENCE_MAX_LENGTH];
+    LocEngNmeaEncoder enc(sentence, sizeof(sentence));
 
     // ------------------
     // ------$GPGSV------
     // ------------------
 
-    if (svStatus.num_svs <= 0)
+    // svs in view, split by constellation
+    int svCount[LOC_ENG_NMEA_SV_SYSTEM_MAX] = {0};
+    int svIndex[LOC_ENG_NMEA_SV_SYSTEM_MAX][GPS_MAX_SVS];
+    for (int i = 0; i < svStatus.num_svs && i < GPS_MAX_SVS; i++)
     {
-        // no svs in view, so just send a blank $GPGSV sentence
-        strlcpy(sentence, "$GPGSV,1,1,0,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        loc_eng_nmea_sv_system_e_type system = loc_eng_nmea_sv_system(svStatus.sv_list[i].prn);
+        svIndex[system][svCount[system]++] = i;
     }
-    else
+
+    // $GPGSV always goes out, blank if there is no gps sv in view
+    for (int system = 0; system < LOC_ENG_NMEA_SV_SYSTEM_MAX; system++)
     {
-        int svCount = svStatus.num_svs;
-        int sentenceCount = svCount / 4;
-        if (svStatus.num_svs % 4)
-            sentenceCount++;
-        int sentenceNumber = 1;
-        int svNumber = 1;
-
-        while (sentenceNumber <= sentenceCount)
+        if (svCount[system] > 0 || system == LOC_ENG_NMEA_SV_SYSTEM_GPS)
         {
-            pMarker = sentence;
-            lengthRemaining = sizeof(sentence);
-
-            length = snprintf(pMarker, lengthRemaining, "$GPGSV,%d,%d,%02d",
-                          sentenceCount, sentenceNumber, svCount);
-
-            if (length < 0 || length >= lengthRemaining)
-            {
-                LOC_LOGE("NMEA Error in string formatting");
-                return;
-            }
-            pMarker += length;
-            lengthRemaining -= length;
-
-            for (int i=0; (svNumber <= svCount) && (i < 4); i++, svNumber++)
-            {
-                length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                                  svStatus.sv_list[svNumber-1].prn,
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].elevation), //float to int
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].azimuth)); //float to int
-
-                if (length < 0 || length >= lengthRemaining)
-                {
-                    LOC_LOGE("NMEA Error in string formatting");
-                    return;
-                }
-                pMarker += length;
-                lengthRemaining -= length;
-
-                if (svStatus.sv_list[svNumber-1].snr > 0)
-                {
-                    length = snprintf(pMarker, lengthRemaining,"%02d",
-                                     (int)(0.5 + svStatus.sv_list[svNumber-1].snr)); //float to int
-
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-                }
-            }
+            loc_eng_nmea_send_gsv(enc, sentence, loc_eng_data_p, svSystemTalker[system],
+                                  svStatus, svIndex[system], svCount[system]);
+        }
+    }
 
-            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-            sentenceNumber++;
+    bool svUsed = false;
+    for (int i = 0; i < LOC_ENG_SV_USED_MASK_WORDS; i++)
+    {
+        if (svUsedMask[i] != 0)
+            svUsed = true;
+    }
 
-        }
+    // an sv in view past the known words may well be used in the fix,
+    // e.g. GLONASS from an adapter that only fills used_in_fix_mask
+    bool svUsedUnknown = false;
+    for (int i = 0; i < svStatus.num_svs && i < GPS_MAX_SVS; i++)
+    {
+        if (svStatus.sv_list[i].prn > svUsedWords * 32)
+            svUsedUnknown = true;
     }
 
-    if (svStatus.used_in_fix_mask == 0)
+    if (!svUsed && !svUsedUnknown)
     {   // No sv used, so there will be no position report, so send
         // blank NMEA sentences
-        strlcpy(sentence, "$GPGSA,A,1,,,,,,,,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        enc.begin("GPGSA,A,1,,,,,,,,,,,,,,,");
+        loc_eng_nmea_finish_and_send(enc, sentence, loc_eng_data_p);
 
-        strlcpy(sentence, "$GPVTG,,T,,M,,N,,K,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        enc.begin("GPVTG,,T,,M,,N,,K,N");
+        loc_eng_nmea_finish_and_send(enc, sentence, loc_eng_data_p);
 
-        strlcpy(sentence, "$GPRMC,,V,,,,,,,,,,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        enc.begin("GPRMC,,V,,,,,,,,,,N");
+        loc_eng_nmea_finish_and_send(enc, sentence, loc_eng_data_p);
 
-        strlcpy(sentence, "$GPGGA,,,,,,0,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        enc.begin("GPGGA,,,,,,0,,,,,,,,");
+        loc_eng_nmea_finish_and_send(enc, sentence, loc_eng_data_p);
     }
     else
     {   // cache the used in fix mask, as it will be needed to send $GPGSA
         // during the position report
-        loc_eng_data_p->sv_used_mask = svStatus.used_in_fix_mask;
+        memcpy(loc_eng_data_p->sv_used_mask, svUsedMask, sizeof(loc_eng_data_p->sv_used_mask));
+        loc_eng_data_p->sv_used_words = svUsedWords;
 
         // For RPC, the DOP are sent during sv report, so cache them
         // now to be sent during position report.
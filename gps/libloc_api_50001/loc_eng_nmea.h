@@ -34,9 +34,19 @@
 
 #define NMEA_SENTENCE_MAX_LENGTH 200
 
+// constellations that get their own NMEA talker
+typedef enum {
+    LOC_ENG_NMEA_SV_SYSTEM_GPS = 0,   // GPS and SBAS, $GP
+    LOC_ENG_NMEA_SV_SYSTEM_GLONASS,   // $GL
+    LOC_ENG_NMEA_SV_SYSTEM_MAX
+} loc_eng_nmea_sv_system_e_type;
+
+loc_eng_nmea_sv_system_e_type loc_eng_nmea_sv_system(int prn);
+
 void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_data_p);
 int loc_eng_nmea_put_checksum(char *pNmea, int maxSize);
-void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p, const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended);
+void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p, const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended,
+                              const uint32_t *svUsedMask, int svUsedWords);
 void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p, const GpsLocation &location, const GpsLocationExtended &locationExtended);
 
 #endif // LOC_ENG_NMEA_H
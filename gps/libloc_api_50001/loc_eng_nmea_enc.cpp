@@ -0,0 +1,358 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng_nmea"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <loc_eng_nmea_enc.h>
+#include "log_util.h"
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+static const uint64_t pow10Table[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+    1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+// 2^53, where doubles stop having a fraction
+#define LOC_NMEA_EXACT_LIMIT 9007199254740992.0
+// 2^27 + 1, splits a double into two halves whose products are exact
+#define LOC_NMEA_SPLITTER 134217729.0
+
+// last second handed to loc_eng_nmea_utc_time() and its broken down time
+static time_t cachedUtcTime = (time_t)-1;
+static struct tm cachedUtcTm;
+
+/*===========================================================================
+FUNCTION    LocEngNmeaEncoder::begin
+
+DESCRIPTION
+   Reset the encoder and write the "$" and the address field of a new
+   sentence. The "$" is not part of the checksum.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void LocEngNmeaEncoder::begin(const char* address)
+{
+    mLen = 0;
+    mChecksum = 0;
+    mOverflow = false;
+    if (mSize > 6) {
+        mBuf[mLen++] = '$';
+    } else {
+        mOverflow = true;
+    }
+    putStr(address);
+}
+
+/*===========================================================================
+FUNCTION    LocEngNmeaEncoder::putStr
+
+DESCRIPTION
+   Append a NUL terminated string
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void LocEngNmeaEncoder::putStr(const char* s)
+{
+    while (*s != '\0') {
+        putChar(*s++);
+    }
+}
+
+/*===========================================================================
+FUNCTION    LocEngNmeaEncoder::putUInt
+
+DESCRIPTION
+   Append an unsigned decimal, zero padded to at least width digits
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void LocEngNmeaEncoder::putUInt(uint32_t value, int width)
+{
+    char digits[10];
+    int n = 0;
+
+    do {
+        digits[n++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    for (int i = n; i < width; i++) {
+        putChar('0');
+    }
+    while (n > 0) {
+        putChar(digits[--n]);
+    }
+}
+
+/*===========================================================================
+FUNCTION    LocEngNmeaEncoder::putInt
+
+DESCRIPTION
+   Append a signed decimal, zero padded to at least width digits after
+   the sign
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void LocEngNmeaEncoder::putInt(int32_t value, int width)
+{
+    if (value < 0) {
+        putChar('-');
+        putUInt((uint32_t)0 - (uint32_t)value, width - 1);
+    } else {
+        putUInt((uint32_t)value, width);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_mul_err
+
+DESCRIPTION
+   Rounding error of product = a * b, i.e. a * b - product exactly
+   (Dekker's two-product, without relying on fma)
+
+DEPENDENCIES
+   product is a * b rounded to nearest, and does not overflow
+
+RETURN VALUE
+   The error, itself exact as a double
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static double loc_eng_nmea_mul_err(double a, double b, double product)
+{
+    double t = LOC_NMEA_SPLITTER * a;
+    double aHi = t - (t - a);
+    double aLo = a - aHi;
+    t = LOC_NMEA_SPLITTER * b;
+    double bHi = t - (t - b);
+    double bLo = b - bHi;
+    return ((aHi * bHi - product) + aHi * bLo + aLo * bHi) + aLo * bLo;
+}
+
+/*===========================================================================
+FUNCTION    LocEngNmeaEncoder::putSprintf
+
+DESCRIPTION
+   putFixed() for the values its integer arithmetic cannot round exactly
+
+DEPENDENCIES
+   value is not negative
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void LocEngNmeaEncoder::putSprintf(double value, int intWidth, int fracDigits)
+{
+    char digits[32];
+    int width = intWidth + (fracDigits > 0 ? fracDigits + 1 : 0);
+    snprintf(digits, sizeof(digits), "%0*.*f", width, fracDigits, value);
+    putStr(digits);
+}
+
+/*===========================================================================
+FUNCTION    LocEngNmeaEncoder::putFixed
+
+DESCRIPTION
+   Append value rounded to fracDigits decimals, with the integer part
+   zero padded to intWidth digits. The value is scaled to an integer
+   once, the two parts are then written with integer arithmetic. The
+   digits are the ones "%0*.*f" gives, ties included.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void LocEngNmeaEncoder::putFixed(double value, int intWidth, int fracDigits)
+{
+    if (fracDigits < 0) {
+        fracDigits = 0;
+    } else if (fracDigits > 9) {
+        fracDigits = 9;
+    }
+
+    // also false for nan
+    if (!(value > -4e9 && value < 4e9)) {
+        LOC_LOGE("NMEA value out of range");
+        return;
+    }
+
+    if (value < 0) {
+        value = -value;
+        putChar('-');
+        intWidth--;
+    }
+
+    const uint64_t scale = pow10Table[fracDigits];
+    double product = value * (double)scale;
+    if (product >= LOC_NMEA_EXACT_LIMIT) {
+        // past 2^53 the product has no fraction bits left to round on
+        putSprintf(value, intWidth, fracDigits);
+        return;
+    }
+
+    // printf rounds the exact binary value, not the rounded product, so
+    // a product close to a tie is settled with its exact rounding error;
+    // that error stays below product * DBL_EPSILON / 2
+    uint64_t scaled = (uint64_t)product;
+    double rest = product - (double)scaled;
+    double toTie = rest - 0.5;
+    if (fabs(toTie) > product * DBL_EPSILON) {
+        if (toTie > 0) {
+            scaled++;
+        }
+    } else {
+        // value * scale == product + err, exactly
+        double err = loc_eng_nmea_mul_err(value, (double)scale, product);
+        if (toTie > -err || (toTie == -err && (scaled & 1))) {
+            scaled++;
+        }
+    }
+    putUInt((uint32_t)(scaled / scale), intWidth);
+
+    if (fracDigits > 0) {
+        putChar('.');
+        putUInt((uint32_t)(scaled % scale), fracDigits);
+    }
+}
+
+/*===========================================================================
+FUNCTION    LocEngNmeaEncoder::finish
+
+DESCRIPTION
+   Append the checksum, CR LF and the terminating NUL
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   Length of the sentence as nmea_cb expects it, or -1 on overflow
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int LocEngNmeaEncoder::finish()
+{
+    if (mOverflow) {
+        LOC_LOGE("NMEA Error in string formatting");
+        mBuf[0] = '\0';
+        return -1;
+    }
+
+    // putChar() always leaves room for this
+    mBuf[mLen++] = '*';
+    mBuf[mLen++] = hexDigits[mChecksum >> 4];
+    mBuf[mLen++] = hexDigits[mChecksum & 0xF];
+    mBuf[mLen++] = '\r';
+    mBuf[mLen++] = '\n';
+    mBuf[mLen] = '\0';
+
+    // loc_eng_nmea_put_checksum() does not count the leading "$"
+    return mLen - 1;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_utc_time
+
+DESCRIPTION
+   Break down utcTime into pTm, reusing the previous result if it is
+   for the same second
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_utc_time(time_t utcTime, struct tm* pTm)
+{
+    if (utcTime != cachedUtcTime) {
+        if (NULL == gmtime_r(&utcTime, &cachedUtcTm)) {
+            memset(pTm, 0, sizeof(*pTm));
+            cachedUtcTime = (time_t)-1;
+            return;
+        }
+        cachedUtcTime = utcTime;
+    }
+    *pTm = cachedUtcTm;
+}
@@ -0,0 +1,87 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_NMEA_ENC_H
+#define LOC_ENG_NMEA_ENC_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Writes one NMEA sentence into a caller supplied buffer. Fields are
+// formatted with integer arithmetic, digit for digit what printf gives,
+// and the checksum is folded in as the bytes go out, so finish() does
+// not have to rescan the sentence. Once the buffer runs out every
+// further put is dropped and finish() fails.
+class LocEngNmeaEncoder {
+    char* const mBuf;
+    const int mSize;
+    int mLen;
+    uint8_t mChecksum;
+    bool mOverflow;
+
+    // putFixed() for scaled values past 2^53
+    void putSprintf(double value, int intWidth, int fracDigits);
+
+public:
+    inline LocEngNmeaEncoder(char* buf, int size) :
+        mBuf(buf), mSize(size), mLen(0), mChecksum(0), mOverflow(false) {}
+
+    // starts a new sentence, i.e. "$" followed by address, e.g. "GPGGA"
+    void begin(const char* address);
+
+    inline void putChar(char c) {
+        // keep room for "*XX\r\n" and the terminating NUL
+        if (mLen + 6 < mSize) {
+            mBuf[mLen++] = c;
+            mChecksum ^= (uint8_t)c;
+        } else {
+            mOverflow = true;
+        }
+    }
+    inline void putComma() { putChar(','); }
+    void putStr(const char* s);
+    // decimal, zero padded to at least width digits, i.e. "%0<width>u"
+    void putUInt(uint32_t value, int width);
+    // i.e. "%0<width>d"
+    void putInt(int32_t value, int width);
+    // fixed point, i.e. "%0<intWidth + fracDigits + 1>.<fracDigits>f"
+    // fracDigits is at most 9; nan and inf leave the field empty
+    void putFixed(double value, int intWidth, int fracDigits);
+
+    // appends "*XX\r\n" and the NUL. Returns the length that goes to
+    // nmea_cb, i.e. the count loc_eng_nmea_put_checksum() gives, or
+    // -1 if the sentence did not fit.
+    int finish();
+};
+
+// gmtime_r() with a one entry cache; fixes come in once a second so
+// the split out date is mostly reused. Not thread safe, only to be
+// called from the deferred action thread.
+void loc_eng_nmea_utc_time(time_t utcTime, struct tm* pTm);
+
+#endif // LOC_ENG_NMEA_ENC_H
@@ -0,0 +1,120 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <loc_eng_sensor_tuner.h>
+#include "log_util.h"
+
+#define NS_PER_SEC 1000000000LL
+
+// weight of a new sample in the smoothed values, 1/4
+static inline float smooth(float avg, float sample)
+{
+    return avg < 0 ? sample : avg + (sample - avg) / 4;
+}
+
+LocEngSensorTuner::LocEngSensorTuner() :
+    // the high rates are what gps.conf asked for, so start there
+    mProfile(PROFILE_HIGH), mMoving(false), mScreenOn(true),
+    mIntervalSec(-1), mSpeed(-1),
+    mLastFixNs(0), mLastSwitchNs(0), mScreenCheckNs(0)
+{
+}
+
+// An unreadable backlight counts as on, which keeps the high profile
+// within reach.
+bool LocEngSensorTuner::screenOn(int64_t nowNs)
+{
+    if (0 != mScreenCheckNs &&
+        nowNs - mScreenCheckNs < LOC_ENG_SENSOR_TUNER_SCREEN_SEC * NS_PER_SEC) {
+        return mScreenOn;
+    }
+    mScreenCheckNs = nowNs;
+
+    char buf[16];
+    int fd = open(LOC_ENG_SENSOR_TUNER_BACKLIGHT, O_RDONLY);
+    if (fd >= 0) {
+        ssize_t len = read(fd, buf, sizeof(buf) - 1);
+        if (len > 0) {
+            buf[len] = '\0';
+            mScreenOn = atoi(buf) > 0;
+        }
+        close(fd);
+    }
+    return mScreenOn;
+}
+
+bool LocEngSensorTuner::update(const GpsLocation& location, int64_t nowNs)
+{
+    if (0 != mLastFixNs &&
+        nowNs - mLastFixNs < LOC_ENG_SENSOR_TUNER_TRACK_GAP_SEC * NS_PER_SEC) {
+        mIntervalSec = smooth(mIntervalSec, (float)(nowNs - mLastFixNs) / NS_PER_SEC);
+    } else {
+        mIntervalSec = -1;
+        mSpeed = -1;
+    }
+    mLastFixNs = nowNs;
+
+    if (location.flags & GPS_LOCATION_HAS_SPEED) {
+        mSpeed = smooth(mSpeed, location.speed);
+    }
+    if (mSpeed >= LOC_ENG_SENSOR_TUNER_MOVING_MPS) {
+        mMoving = true;
+    } else if (mSpeed >= 0 && mSpeed < LOC_ENG_SENSOR_TUNER_STATIONARY_MPS) {
+        mMoving = false;
+    }
+
+    // not enough fixes yet to tell
+    if (mIntervalSec < 0 || mSpeed < 0) {
+        return false;
+    }
+
+    Profile profile = PROFILE_NORMAL;
+    if (mMoving &&
+        (mIntervalSec <= LOC_ENG_SENSOR_TUNER_TRACKING_SEC || screenOn(nowNs))) {
+        profile = PROFILE_HIGH;
+    }
+
+    if (profile == mProfile ||
+        (0 != mLastSwitchNs &&
+         nowNs - mLastSwitchNs < LOC_ENG_SENSOR_TUNER_DWELL_SEC * NS_PER_SEC)) {
+        return false;
+    }
+
+    LOC_LOGI("%s: sensor profile %s, speed %.1f m/s, fix every %.1f s, screen %s",
+             __func__, PROFILE_HIGH == profile ? "high" : "normal",
+             mSpeed, mIntervalSec, mScreenOn ? "on" : "off");
+    mProfile = profile;
+    mLastSwitchNs = nowNs;
+    return true;
+}
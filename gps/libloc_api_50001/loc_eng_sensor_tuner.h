@@ -0,0 +1,83 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_SENSOR_TUNER_H
+#define LOC_ENG_SENSOR_TUNER_H
+
+#include <stdint.h>
+#include <hardware/gps.h>
+
+// Moving above this speed picks the high profile, slowing down below
+// the lower one drops back; m/s, smoothed over a few fixes
+#define LOC_ENG_SENSOR_TUNER_MOVING_MPS       1.0f
+#define LOC_ENG_SENSOR_TUNER_STATIONARY_MPS   0.5f
+// fixes at least this often, in s, count as tracking
+#define LOC_ENG_SENSOR_TUNER_TRACKING_SEC     2.0f
+// a gap this long, in s, starts over as a new track
+#define LOC_ENG_SENSOR_TUNER_TRACK_GAP_SEC    30
+// the profile stays at least this long, in s, once switched
+#define LOC_ENG_SENSOR_TUNER_DWELL_SEC        10
+// how often the screen state is looked up, in s
+#define LOC_ENG_SENSOR_TUNER_SCREEN_SEC       5
+#define LOC_ENG_SENSOR_TUNER_BACKLIGHT        "/sys/class/leds/lcd-backlight/brightness"
+
+// Picks the sensor batching profile from the fixes the engine reports,
+// for SENSOR_AUTO_TUNE in gps.conf. The high profile, i.e. the
+// SENSOR_*_HIGH rates, is only worth its wakeups when the device moves
+// and someone is following along, either through frequent fixes or with
+// the screen on. Otherwise the normal rates are used for both filters.
+// Fed and read by the deferred thread only.
+class LocEngSensorTuner {
+public:
+    enum Profile {
+        PROFILE_NORMAL,
+        PROFILE_HIGH
+    };
+
+    LocEngSensorTuner();
+
+    // nowNs in CLOCK_MONOTONIC, see loc_eng_msg_now(); returns true if
+    // the profile changed and the modem needs the new rates
+    bool update(const GpsLocation& location, int64_t nowNs);
+    inline Profile profile() const { return mProfile; }
+
+private:
+    bool screenOn(int64_t nowNs);
+
+    Profile mProfile;
+    bool mMoving;
+    bool mScreenOn;
+    // smoothed time between fixes, s, and speed, m/s; < 0 until known
+    float mIntervalSec;
+    float mSpeed;
+    int64_t mLastFixNs;
+    int64_t mLastSwitchNs;
+    int64_t mScreenCheckNs;
+};
+
+#endif // LOC_ENG_SENSOR_TUNER_H
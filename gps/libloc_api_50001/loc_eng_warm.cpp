@@ -0,0 +1,335 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng_warm"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <loc_eng.h>
+#include <loc_eng_bin.h>
+#include "log_util.h"
+
+#define WARM_MAGIC              0x4d52574c  /* "LWRM" */
+#define WARM_VERSION            1
+#define WARM_BOOT_ID_LENGTH     40
+// the device is assumed to move at most this fast while we are off
+#define WARM_DRIFT_MPS          10
+// a position less accurate than this does not help acquisition
+#define WARM_MAX_ACCURACY_M     100000
+// CLOCK_BOOTTIME against UTC, base uncertainty and drift (50 ppm)
+#define WARM_TIME_UNC_BASE_MS   100
+#define WARM_TIME_UNC_PPM       50
+#define WARM_MAX_TIME_UNC_MS    10000
+
+// host byte order, the file never leaves the device
+typedef struct
+{
+   uint32_t magic;
+   uint16_t version;
+   uint16_t reserved;
+   char     bootId[WARM_BOOT_ID_LENGTH];  // the boot utcOffsetMs holds in
+   int64_t  utcOffsetMs;
+   int64_t  fixBootMs;
+   int64_t  timestamp;                    // UTC ms of the fix
+   double   latitude;
+   double   longitude;
+   float    accuracy;
+   uint32_t crc;                          // CRC-32 of everything above
+} warm_cache_record;
+
+static int64_t loc_eng_warm_boot_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_warm_boot_id
+
+DESCRIPTION
+   Reads the kernel's random id of this boot into bootId.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None, bootId is left empty if it can not be read
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_warm_boot_id(char bootId[WARM_BOOT_ID_LENGTH])
+{
+    memset(bootId, 0, WARM_BOOT_ID_LENGTH);
+
+    int fd = open("/proc/sys/kernel/random/boot_id", O_RDONLY);
+    if (fd >= 0) {
+        ssize_t len = read(fd, bootId, WARM_BOOT_ID_LENGTH - 1);
+        if (len > 0 && '\n' == bootId[len - 1]) {
+            bootId[len - 1] = '\0';
+        }
+        close(fd);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_warm_load
+
+DESCRIPTION
+   Reads the warm start cache file into loc_eng_data, if it is there and
+   intact.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_warm_load(loc_eng_data_s_type &loc_eng_data)
+{
+    loc_eng_warm_data_s_type *warm = &loc_eng_data.warm_data;
+    warm_cache_record record;
+    char bootId[WARM_BOOT_ID_LENGTH];
+
+    warm->loaded = TRUE;
+
+    int fd = open(gps_conf.WARM_START_CACHE, O_RDONLY);
+    if (fd < 0) {
+        LOC_LOGI("%s: no warm start cache at %s", __func__, gps_conf.WARM_START_CACHE);
+        return;
+    }
+    ssize_t len = read(fd, &record, sizeof(record));
+    close(fd);
+
+    if (len != (ssize_t)sizeof(record) ||
+        record.magic != WARM_MAGIC ||
+        record.version != WARM_VERSION ||
+        record.crc != loc_eng_bin_crc32((const uint8_t*)&record,
+                                        offsetof(warm_cache_record, crc))) {
+        LOC_LOGE("%s: %s is not a valid warm start cache", __func__, gps_conf.WARM_START_CACHE);
+        return;
+    }
+
+    // a fix that came in while we were down beats the file
+    if (warm->haveFix) {
+        return;
+    }
+
+    memset(&warm->lastFix, 0, sizeof(warm->lastFix));
+    warm->lastFix.size = sizeof(warm->lastFix);
+    warm->lastFix.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ACCURACY;
+    warm->lastFix.latitude = record.latitude;
+    warm->lastFix.longitude = record.longitude;
+    warm->lastFix.accuracy = record.accuracy;
+    warm->lastFix.timestamp = record.timestamp;
+    warm->lastFixBootMs = record.fixBootMs;
+    warm->haveFix = TRUE;
+
+    loc_eng_warm_boot_id(bootId);
+    warm->utcOffsetMs = ('\0' != bootId[0] && 0 == strcmp(bootId, record.bootId)) ?
+                        record.utcOffsetMs : 0;
+
+    LOC_LOGD("%s: fix from %lld, time offset %s", __func__,
+             (long long)record.timestamp, warm->utcOffsetMs ? "valid" : "from another boot");
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_warm_record_fix
+
+DESCRIPTION
+   Remembers a good fix for the warm start cache. fixBootMs is
+   CLOCK_BOOTTIME when the adapter reported the fix: the UTC offset is
+   taken from it, as the fix may have waited in the queue since. Runs on
+   the deferred action thread.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_warm_record_fix(loc_eng_data_s_type &loc_eng_data, const GpsLocation &location,
+                             int64_t fixBootMs)
+{
+    loc_eng_warm_data_s_type *warm = &loc_eng_data.warm_data;
+
+    if ('\0' == gps_conf.WARM_START_CACHE[0] ||
+        !(location.flags & GPS_LOCATION_HAS_LAT_LONG) ||
+        !(location.flags & GPS_LOCATION_HAS_ACCURACY)) {
+        return;
+    }
+
+    warm->lastFix = location;
+    warm->lastFixBootMs = fixBootMs;
+    warm->utcOffsetMs = location.timestamp - warm->lastFixBootMs;
+    warm->haveFix = TRUE;
+    warm->dirty = TRUE;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_warm_save
+
+DESCRIPTION
+   Writes the last good fix to the warm start cache file, if there is a
+   new one. The file is written aside, synced and renamed into place, so
+   a crash never leaves a torn cache behind. Runs on the deferred action
+   thread.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_warm_save(loc_eng_data_s_type &loc_eng_data)
+{
+    loc_eng_warm_data_s_type *warm = &loc_eng_data.warm_data;
+    char tmp_path[LOC_MAX_PARAM_STRING + 8];
+    warm_cache_record record;
+
+    if ('\0' == gps_conf.WARM_START_CACHE[0] || !warm->dirty) {
+        return;
+    }
+    warm->dirty = FALSE;
+
+    memset(&record, 0, sizeof(record));
+    record.magic = WARM_MAGIC;
+    record.version = WARM_VERSION;
+    loc_eng_warm_boot_id(record.bootId);
+    record.utcOffsetMs = warm->utcOffsetMs;
+    record.fixBootMs = warm->lastFixBootMs;
+    record.timestamp = warm->lastFix.timestamp;
+    record.latitude = warm->lastFix.latitude;
+    record.longitude = warm->lastFix.longitude;
+    record.accuracy = warm->lastFix.accuracy;
+    record.crc = loc_eng_bin_crc32((const uint8_t*)&record,
+                                   offsetof(warm_cache_record, crc));
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", gps_conf.WARM_START_CACHE);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        LOC_LOGE("%s: open %s failed, %s", __func__, tmp_path, strerror(errno));
+        return;
+    }
+
+    if (write(fd, &record, sizeof(record)) != (ssize_t)sizeof(record) ||
+        fsync(fd) < 0) {
+        LOC_LOGE("%s: write %s failed, %s", __func__, tmp_path, strerror(errno));
+        close(fd);
+        unlink(tmp_path);
+        return;
+    }
+    close(fd);
+
+    if (rename(tmp_path, gps_conf.WARM_START_CACHE) < 0) {
+        LOC_LOGE("%s: rename to %s failed, %s", __func__, gps_conf.WARM_START_CACHE, strerror(errno));
+        unlink(tmp_path);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_warm_inject
+
+DESCRIPTION
+   Injects the cached position and time into the engine, once after
+   loc_eng_init or a modem restart, and only what is still plausible.
+   Runs on the deferred action thread, ahead of starting a session.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_warm_inject(loc_eng_data_s_type &loc_eng_data)
+{
+    loc_eng_warm_data_s_type *warm = &loc_eng_data.warm_data;
+
+    if ('\0' == gps_conf.WARM_START_CACHE[0] || warm->injected) {
+        return;
+    }
+    warm->injected = TRUE;
+
+    if (!warm->loaded) {
+        loc_eng_warm_load(loc_eng_data);
+    }
+    if (!warm->haveFix) {
+        return;
+    }
+
+    int64_t nowBootMs = loc_eng_warm_boot_ms();
+
+    if (warm->utcOffsetMs != 0) {
+        int64_t ageMs = nowBootMs - warm->lastFixBootMs;
+        int64_t uncMs = WARM_TIME_UNC_BASE_MS + ageMs * WARM_TIME_UNC_PPM / 1000000;
+        if (uncMs <= WARM_MAX_TIME_UNC_MS) {
+            LOC_LOGD("%s: time, uncertainty %lld ms", __func__, (long long)uncMs);
+            loc_eng_data.client_handle->setTime(nowBootMs + warm->utcOffsetMs,
+                                                nowBootMs, (int)uncMs);
+        }
+    }
+
+    // in another boot the fix's age can only be had from the system clock
+    int64_t ageSecs = (int64_t)time(NULL) - warm->lastFix.timestamp / 1000;
+    if (ageSecs < 0) {
+        return;
+    }
+    double accuracy = warm->lastFix.accuracy + (double)ageSecs * WARM_DRIFT_MPS;
+    if (accuracy <= WARM_MAX_ACCURACY_M) {
+        LOC_LOGD("%s: position, %lld secs old, accuracy %.0f m", __func__,
+                 (long long)ageSecs, accuracy);
+        loc_eng_data.client_handle->injectPosition(warm->lastFix.latitude,
+                                                   warm->lastFix.longitude,
+                                                   (float)accuracy);
+    }
+}
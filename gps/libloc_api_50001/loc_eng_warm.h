@@ -0,0 +1,56 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_WARM_H
+#define LOC_ENG_WARM_H
+
+#include <stdint.h>
+#include <hardware/gps.h>
+
+/* Warm start cache. With WARM_START_CACHE set in gps.conf, the last good
+   fix and the offset between UTC and CLOCK_BOOTTIME it gave are saved
+   to that file when a session stops, and injected again before the
+   first session after loc_eng_init or a modem restart. The position is
+   injected while its accuracy, grown with its age, is still of use. The
+   time only within the boot it was saved in. */
+
+typedef struct
+{
+   boolean                        loaded;     // cache file read in
+   boolean                        injected;   // since init or modem restart
+   boolean                        haveFix;
+   boolean                        dirty;      // fix changed since last save
+   GpsLocation                    lastFix;
+   // CLOCK_BOOTTIME ms when lastFix came in
+   int64_t                        lastFixBootMs;
+   // UTC - CLOCK_BOOTTIME in ms, taken from lastFix; 0 if not valid
+   // in this boot
+   int64_t                        utcOffsetMs;
+} loc_eng_warm_data_s_type;
+
+#endif // LOC_ENG_WARM_H
@@ -30,10 +30,126 @@
 #define LOG_NDDEBUG 0
 #define LOG_TAG "LocSvc_eng"
 
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <loc_eng.h>
 #include <loc_eng_msg.h>
+#include <loc_eng_bin.h>
 #include "log_util.h"
 
+// "XTRC", the XTRA cache file is this header followed by the XTRA data
+#define XTRA_CACHE_MAGIC          0x43525458
+// GPS time starts 1980-01-06, leap seconds are left out, the cache
+// works in hours
+#define XTRA_GPS_EPOCH_UTC        315964800
+#define XTRA_SECS_PER_WEEK        604800
+// ask for a download once the cached data has less than this left
+#define XTRA_REFRESH_MARGIN_SECS  (24 * 60 * 60)
+// swallow modem requests for this long after asking for a download
+#define XTRA_DOWNLOAD_RETRY_SECS  (10 * 60)
+// a modem that asks again this soon after a cache inject did not take
+// the cached data, or found it run out, so the cache is dropped
+#define XTRA_CACHE_REJECT_SECS    (60 * 60)
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t length;       // bytes of XTRA data after the header
+   int64_t  fetch_time;   // UTC seconds
+   uint32_t expiry_week;  // GPS week the data runs out in
+   uint32_t expiry_tow;   // seconds into that week
+   uint32_t crc;          // CRC-32 of the XTRA data
+} xtra_cache_header;
+
+static int64_t loc_eng_xtra_gps_now()
+{
+   return (int64_t)time(NULL) - XTRA_GPS_EPOCH_UTC;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_cache_open
+
+DESCRIPTION
+   Opens the XTRA cache file and reads its header. A file whose size does
+   not match the header, e.g. one cut short, is not taken.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The file descriptor, -1 if there is no valid cache
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_eng_xtra_cache_open(xtra_cache_header *header)
+{
+   struct stat st;
+   int fd;
+
+   if ('\0' == gps_conf.XTRA_CACHE[0]) {
+      return -1;
+   }
+
+   fd = open(gps_conf.XTRA_CACHE, O_RDONLY);
+   if (fd < 0) {
+      LOC_LOGI("%s: no XTRA cache at %s", __func__, gps_conf.XTRA_CACHE);
+      return -1;
+   }
+
+   if (read(fd, header, sizeof(*header)) != (ssize_t)sizeof(*header) ||
+       fstat(fd, &st) < 0 ||
+       header->magic != XTRA_CACHE_MAGIC ||
+       header->length == 0 ||
+       st.st_size != (off_t)(sizeof(*header) + header->length)) {
+      LOC_LOGE("%s: %s is not a valid XTRA cache", __func__, gps_conf.XTRA_CACHE);
+      close(fd);
+      return -1;
+   }
+   return fd;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_cache_load
+
+DESCRIPTION
+   Reads the header of the XTRA cache file, if there is one, and takes
+   over its expiry.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_xtra_cache_load(loc_eng_xtra_data_s_type *xtra_module_data_ptr)
+{
+   xtra_cache_header header;
+   int fd;
+
+   xtra_module_data_ptr->cache_expiry = 0;
+   if ((fd = loc_eng_xtra_cache_open(&header)) < 0) {
+      return;
+   }
+
+   xtra_module_data_ptr->cache_expiry =
+      (int64_t)header.expiry_week * XTRA_SECS_PER_WEEK + header.expiry_tow;
+   LOC_LOGI("%s: XTRA cache of %u bytes, fetched at %lld, valid until GPS week %u tow %u",
+            __func__, header.length, (long long)header.fetch_time,
+            header.expiry_week, header.expiry_tow);
+   close(fd);
+}
+
 
 /*===========================================================================
 FUNCTION    loc_eng_xtra_init
@@ -58,6 +174,9 @@ int loc_eng_xtra_init (loc_eng_data_s_type &loc_eng_data,
 
    xtra_module_data_ptr = &loc_eng_data.xtra_module_data;
    xtra_module_data_ptr->download_request_cb = callbacks->download_request_cb;
+   xtra_module_data_ptr->download_requested = 0;
+   xtra_module_data_ptr->cache_injected = 0;
+   loc_eng_xtra_cache_load(xtra_module_data_ptr);
 
    return 0;
 }
@@ -88,3 +207,266 @@ int loc_eng_xtra_inject_data(loc_eng_data_s_type &loc_eng_data,
 
     return 0;
 }
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_inject_fd
+
+DESCRIPTION
+   Injects the XTRA data found offset bytes into the file behind fd,
+   if it has CRC-32 crc. The file is mapped read-only and the mapping is
+   handed to the engine, so no copy of the data is made on the heap. The
+   engine reports the outcome to loc_eng_xtra_cache_injected. The caller
+   keeps ownership of fd.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0: success
+   >0: failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_eng_xtra_inject_fd(loc_eng_data_s_type &loc_eng_data, int fd, int offset,
+                                  uint32_t crc)
+{
+    struct stat st;
+    void* data;
+
+    if (fstat(fd, &st) < 0) {
+        LOC_LOGE("%s: fstat failed, %s", __func__, strerror(errno));
+        return 1;
+    }
+
+    if (st.st_size <= offset) {
+        LOC_LOGE("%s: no XTRA data in the file", __func__);
+        return 1;
+    }
+
+    // the mapping stays valid after the caller closes fd
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == data) {
+        LOC_LOGE("%s: mmap failed, %s", __func__, strerror(errno));
+        return 1;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    if (loc_eng_bin_crc32((const uint8_t*)data + offset, st.st_size - offset) != crc) {
+        LOC_LOGE("%s: XTRA data does not match its CRC", __func__);
+        munmap(data, st.st_size);
+        return 1;
+    }
+
+    loc_eng_msg_inject_xtra_file *msg(new loc_eng_msg_inject_xtra_file(&loc_eng_data,
+                                                                       (char*)data,
+                                                                       (int)st.st_size,
+                                                                       offset));
+    loc_eng_msg_sender(&loc_eng_data, msg);
+
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_cache_store
+
+DESCRIPTION
+   Saves XTRA data that was just injected to the XTRA cache file, stamped
+   with the current time. The file is written aside and renamed into
+   place, so a crash never leaves a torn cache behind. Runs on the
+   deferred action thread.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_cache_store(loc_eng_data_s_type &loc_eng_data,
+                              const char* data, int length)
+{
+    loc_eng_xtra_data_s_type *xtra_module_data_ptr = &loc_eng_data.xtra_module_data;
+    char tmp_path[LOC_MAX_PARAM_STRING + 8];
+    xtra_cache_header header;
+    int64_t expiry;
+    int fd;
+
+    // whatever was asked for has arrived
+    xtra_module_data_ptr->download_requested = 0;
+    xtra_module_data_ptr->cache_injected = 0;
+
+    if ('\0' == gps_conf.XTRA_CACHE[0] || length <= 0) {
+        return;
+    }
+
+    expiry = loc_eng_xtra_gps_now() + gps_conf.XTRA_CACHE_VALIDITY * 60 * 60;
+    memset(&header, 0, sizeof(header));
+    header.magic = XTRA_CACHE_MAGIC;
+    header.length = length;
+    header.fetch_time = time(NULL);
+    header.expiry_week = expiry / XTRA_SECS_PER_WEEK;
+    header.expiry_tow = expiry % XTRA_SECS_PER_WEEK;
+    header.crc = loc_eng_bin_crc32((const uint8_t*)data, length);
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", gps_conf.XTRA_CACHE);
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        LOC_LOGE("%s: open %s failed, %s", __func__, tmp_path, strerror(errno));
+        return;
+    }
+
+    if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+        write(fd, data, length) != (ssize_t)length ||
+        fsync(fd) < 0) {
+        LOC_LOGE("%s: write %s failed, %s", __func__, tmp_path, strerror(errno));
+        close(fd);
+        unlink(tmp_path);
+        return;
+    }
+    close(fd);
+
+    if (rename(tmp_path, gps_conf.XTRA_CACHE) < 0) {
+        LOC_LOGE("%s: rename to %s failed, %s", __func__, gps_conf.XTRA_CACHE, strerror(errno));
+        unlink(tmp_path);
+        return;
+    }
+
+    xtra_module_data_ptr->cache_expiry = expiry;
+    LOC_LOGD("%s: cached %d bytes, valid until GPS week %u tow %u",
+             __func__, length, header.expiry_week, header.expiry_tow);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_cache_inject
+
+DESCRIPTION
+   Hands the data of the XTRA cache file to the engine. Runs on the
+   deferred action thread.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   true if the data is on its way to the engine
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_xtra_cache_inject(loc_eng_data_s_type &loc_eng_data)
+{
+    xtra_cache_header header;
+    bool injected;
+    int fd;
+
+    if ((fd = loc_eng_xtra_cache_open(&header)) < 0) {
+        return false;
+    }
+    injected = (0 == loc_eng_xtra_inject_fd(loc_eng_data, fd, sizeof(header), header.crc));
+    close(fd);
+
+    return injected;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_cache_injected
+
+DESCRIPTION
+   Takes the outcome of injecting the XTRA cache. If the engine did not
+   take the data, the cache is no longer trusted and the modem request
+   it answered goes on to ask for a download. Runs on the deferred
+   action thread.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_cache_injected(loc_eng_data_s_type &loc_eng_data, bool injected)
+{
+    loc_eng_xtra_data_s_type *xtra_module_data_ptr = &loc_eng_data.xtra_module_data;
+
+    if (injected) {
+        LOC_LOGD("%s: injected cached XTRA data", __func__);
+        return;
+    }
+
+    LOC_LOGE("%s: cached XTRA data not taken", __func__);
+    xtra_module_data_ptr->cache_expiry = 0;
+    xtra_module_data_ptr->cache_injected = 0;
+    loc_eng_xtra_handle_request(loc_eng_data);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_handle_request
+
+DESCRIPTION
+   Answers a modem request for XTRA data. While the cached XTRA file is
+   valid it is injected straight away, a download is only asked of the
+   framework once the cache runs into its last day or is gone, and then
+   only once until the data comes in or the request goes stale.
+
+   The cache expiry is counted from the fetch, not read from the XTRA
+   data, so the modem is the judge of the data: if it asks again soon
+   after a cache inject, the cache is deleted and a download asked for.
+   Runs on the deferred action thread.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_handle_request(loc_eng_data_s_type &loc_eng_data)
+{
+    loc_eng_xtra_data_s_type *xtra_module_data_ptr = &loc_eng_data.xtra_module_data;
+    int64_t now = loc_eng_xtra_gps_now();
+
+    if (xtra_module_data_ptr->cache_injected != 0 &&
+        time(NULL) - xtra_module_data_ptr->cache_injected < XTRA_CACHE_REJECT_SECS) {
+        LOC_LOGW("%s: modem asked again %ld secs after the cached XTRA data, dropping the cache",
+                 __func__, (long)(time(NULL) - xtra_module_data_ptr->cache_injected));
+        unlink(gps_conf.XTRA_CACHE);
+        xtra_module_data_ptr->cache_expiry = 0;
+        xtra_module_data_ptr->cache_injected = 0;
+    }
+
+    if (xtra_module_data_ptr->cache_expiry > now) {
+        if (loc_eng_xtra_cache_inject(loc_eng_data)) {
+            xtra_module_data_ptr->cache_injected = time(NULL);
+            LOC_LOGD("%s: injecting cached XTRA data, %lld secs left", __func__,
+                     (long long)(xtra_module_data_ptr->cache_expiry - now));
+            if (xtra_module_data_ptr->cache_expiry - now > XTRA_REFRESH_MARGIN_SECS) {
+                return;
+            }
+        } else {
+            xtra_module_data_ptr->cache_expiry = 0;
+        }
+    }
+
+    if (xtra_module_data_ptr->download_requested != 0 &&
+        time(NULL) - xtra_module_data_ptr->download_requested < XTRA_DOWNLOAD_RETRY_SECS) {
+        LOC_LOGD("%s: XTRA download already requested", __func__);
+        return;
+    }
+
+    if (xtra_module_data_ptr->download_request_cb != NULL)
+    {
+        xtra_module_data_ptr->download_requested = time(NULL);
+        xtra_module_data_ptr->download_request_cb();
+    }
+}
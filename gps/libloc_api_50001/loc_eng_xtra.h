@@ -30,6 +30,7 @@
 #ifndef LOC_ENG_XTRA_H
 #define LOC_ENG_XTRA_H
 
+#include <time.h>
 #include <hardware/gps.h>
 
 // Module data
@@ -41,6 +42,11 @@ typedef struct
    // XTRA data buffer
    char                          *xtra_data_for_injection;  // NULL if no pending data
    int                            xtra_data_len;
+
+   // XTRA cache, see XTRA_CACHE in gps.conf
+   int64_t                        cache_expiry;        // GPS seconds, 0 if no cache
+   time_t                         download_requested;  // 0 if no download pending
+   time_t                         cache_injected;      // 0 if not injected since the last download
 } loc_eng_xtra_data_s_type;
 
 #endif // LOC_ENG_XTRA_H
@@ -0,0 +1,250 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Plays a made up one fix a second trace through loc_eng_init, with
+// ReplayLocApiAdapter standing in for the modem and stub location_cb,
+// sv_status_cb and nmea_cb for the framework, and times what reaches
+// them: throughput, the latency from a fix being played to its
+// location_cb, and at a non zero speed how far the fixes drift from the
+// pace of the trace. Fixes are stamped in ms, so the latency reads up
+// to 1 ms long. SV reports and NMEA may be coalesced or shed when the
+// engine falls behind, so only the fixes are waited for. Also checks
+// that the GLONASS used in fix words of the SV events make it into the
+// $GNGSA the engine generates, which it does with NMEA_PROVIDER=0 in
+// gps.conf. Exits 1 if they do not.
+// Usage: ReplayLocApiAdapter_bench [fixes] [speed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <loc_eng.h>
+#include <ReplayLocApiAdapter.h>
+
+#define BENCH_DEFAULT_FIXES 100000
+// GLONASS PRNs 65 and 66, in the third used mask word
+#define BENCH_GLONASS_USED  0x3
+
+struct bench_stats {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int wanted;
+    int fixes;
+    int svs;
+    int nmeas;
+    int glonassGsas;
+    int64_t firstFixNs;
+    int64_t lastFixNs;
+    int64_t maxDriftNs;
+    int64_t latencySumUs;
+    int64_t latencyMaxUs;
+};
+
+static bench_stats stats;
+static loc_eng_data_s_type locEngData;
+static const char* tracePath;
+static uint32_t speed;
+
+static int64_t bench_now_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bench_location(GpsLocation* location, void* locExt)
+{
+    int64_t utcUs = bench_now_ns(CLOCK_REALTIME) / 1000;
+    int64_t now = bench_now_ns(CLOCK_MONOTONIC);
+
+    pthread_mutex_lock(&stats.lock);
+    // the trace starts over while the run winds down
+    if (NULL == location || stats.fixes == stats.wanted) {
+        pthread_mutex_unlock(&stats.lock);
+        return;
+    }
+    int64_t latency = utcUs - location->timestamp * 1000;
+    stats.latencySumUs += latency;
+    if (latency > stats.latencyMaxUs) {
+        stats.latencyMaxUs = latency;
+    }
+    if (0 == stats.fixes) {
+        stats.firstFixNs = now;
+    } else if (0 != speed) {
+        int64_t drift = now - stats.firstFixNs - stats.fixes * 1000000000LL / speed;
+        if (drift < 0) {
+            drift = -drift;
+        }
+        if (drift > stats.maxDriftNs) {
+            stats.maxDriftNs = drift;
+        }
+    }
+    stats.lastFixNs = now;
+    if (++stats.fixes == stats.wanted) {
+        pthread_cond_signal(&stats.done);
+    }
+    pthread_mutex_unlock(&stats.lock);
+}
+
+static void bench_sv_status(GpsSvStatus* svStatus, void* svExt)
+{
+    pthread_mutex_lock(&stats.lock);
+    if (stats.fixes < stats.wanted) {
+        stats.svs++;
+    }
+    pthread_mutex_unlock(&stats.lock);
+}
+
+static void bench_nmea(GpsUtcTime timestamp, const char* nmea, int length)
+{
+    pthread_mutex_lock(&stats.lock);
+    if (stats.fixes < stats.wanted) {
+        stats.nmeas++;
+        if (0 == strncmp(nmea, "$GNGSA,", 7) && NULL != strstr(nmea, ",65,66,")) {
+            stats.glonassGsas++;
+        }
+    }
+    pthread_mutex_unlock(&stats.lock);
+}
+
+static void bench_status(GpsStatus* status) {}
+static void bench_wakelock() {}
+
+static pthread_t bench_create_thread(const char* name, void (*start)(void*), void* arg)
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, (void* (*)(void*))start, arg);
+    pthread_detach(thread);
+    return thread;
+}
+
+static LocApiAdapter* bench_adapter_factory(LocEng &locEng)
+{
+    return ReplayLocApiAdapter::create(locEng, tracePath, speed);
+}
+
+static bool bench_write_trace(const char* path, int fixes)
+{
+    FILE* trace = fopen(path, "w");
+    if (NULL == trace) {
+        return false;
+    }
+    for (int i = 0; i < fixes; i++) {
+        int64_t ms = (int64_t)i * 1000;
+        fprintf(trace, "%lld POS 32.881234 -117.234567 123.4 5.0 1.2 90.0\n",
+                (long long)ms);
+        fprintf(trace, "%lld SV ffffffff ffffffff 7 5 1 40.0 45.0 90.0 "
+                "2 38.5 30.0 180.0 3 35.0 60.0 270.0 65 36.0 50.0 20.0 "
+                "66 34.0 40.0 300.0 7 0 %x\n",
+                (long long)ms + 10, BENCH_GLONASS_USED);
+        fprintf(trace, "%lld NMEA $GPGSA,A,3,01,02,03,,,,,,,,,,1.8,0.9,1.5*33\n",
+                (long long)ms + 20);
+    }
+    return 0 == fclose(trace);
+}
+
+int main(int argc, char* argv[])
+{
+    int fixes = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_FIXES;
+    int replaySpeed = argc > 2 ? atoi(argv[2]) : 0;
+    if (fixes < 1 || replaySpeed < 0) {
+        fprintf(stderr, "usage: %s [fixes] [speed]\n", argv[0]);
+        return 1;
+    }
+    speed = replaySpeed;
+
+    const char* tmpDir = getenv("TMPDIR");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/replay_bench_%d.trace",
+             NULL != tmpDir ? tmpDir : "/data/local/tmp", (int)getpid());
+    tracePath = path;
+    if (!bench_write_trace(tracePath, fixes)) {
+        fprintf(stderr, "cannot write %s\n", tracePath);
+        return 1;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_init(&stats.lock, NULL);
+    pthread_cond_init(&stats.done, NULL);
+    stats.wanted = fixes;
+
+    LocCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.location_cb = bench_location;
+    callbacks.status_cb = bench_status;
+    callbacks.sv_status_cb = bench_sv_status;
+    callbacks.nmea_cb = bench_nmea;
+    callbacks.acquire_wakelock_cb = bench_wakelock;
+    callbacks.release_wakelock_cb = bench_wakelock;
+    callbacks.create_thread_cb = bench_create_thread;
+    LocApiAdapter::testAdapterFactory = bench_adapter_factory;
+    if (0 != loc_eng_init(locEngData, &callbacks,
+                          LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+                          LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+                          LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT |
+                          LOC_API_ADAPTER_BIT_STATUS_REPORT,
+                          NULL)) {
+        fprintf(stderr, "loc_eng_init failed\n");
+        unlink(tracePath);
+        return 1;
+    }
+
+    LocPosMode mode(LOC_POSITION_MODE_STANDALONE, GPS_POSITION_RECURRENCE_PERIODIC,
+                    0, 0, 0, NULL, NULL);
+    loc_eng_set_position_mode(locEngData, mode);
+    int64_t start = bench_now_ns(CLOCK_MONOTONIC);
+    loc_eng_start(locEngData);
+    pthread_mutex_lock(&stats.lock);
+    while (stats.fixes < stats.wanted) {
+        pthread_cond_wait(&stats.done, &stats.lock);
+    }
+    pthread_mutex_unlock(&stats.lock);
+    loc_eng_stop(locEngData);
+    loc_eng_cleanup(locEngData);
+    unlink(tracePath);
+
+    int64_t elapsedNs = stats.lastFixNs - start;
+    printf("fixes:    %d in %.3f s, %.0f fixes/s\n", stats.fixes,
+           elapsedNs / 1e9, stats.fixes * 1e9 / elapsedNs);
+    printf("sv:       %d, %.0f callbacks/s\n", stats.svs, stats.svs * 1e9 / elapsedNs);
+    printf("nmea:     %d, %.0f callbacks/s\n", stats.nmeas, stats.nmeas * 1e9 / elapsedNs);
+    printf("latency:  %.3f ms mean, %.3f ms max, played to location_cb\n",
+           stats.latencySumUs / 1e3 / stats.fixes, stats.latencyMaxUs / 1e3);
+    if (0 != speed) {
+        printf("drift:    %.3f ms max\n", stats.maxDriftNs / 1e6);
+    }
+    if (0 == stats.glonassGsas) {
+        printf("no $GNGSA carried the GLONASS used in fix words\n");
+        return 1;
+    }
+    printf("glonass:  %d $GNGSA with PRNs 65 and 66\n", stats.glonassGsas);
+    return 0;
+}
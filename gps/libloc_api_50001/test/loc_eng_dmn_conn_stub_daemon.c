@@ -0,0 +1,158 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Stand-in for gpsone_daemon on the SOCK_SEQPACKET transport, i.e. a
+   HAL built with FEATURE_LOC_ENG_DMN_CONN_SOCKET. Connects to the
+   loc_api and resp sockets the HAL listens on, then asks for the data
+   connection and gives it back again, printing every response.
+   Usage: loc_eng_dmn_conn_stub_daemon [rounds] */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "loc_eng_dmn_conn.h"
+#include "loc_eng_dmn_conn_handler.h"
+
+/* how long a response may take, the HAL has to bring up a data call */
+#define STUB_RESPONSE_TIMEOUT_MS 30000
+
+static int stub_connect(const char * path)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) {
+        fprintf(stderr, "socket failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "connect %s failed: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int stub_send(int fd, uint8_t ctrl_type)
+{
+    struct ctrl_msgbuf cmsgbuf;
+
+    memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+    cmsgbuf.msgsz = sizeof(cmsgbuf);
+    cmsgbuf.ctrl_type = ctrl_type;
+    cmsgbuf.cmsg.cmsg_if_request.type = IF_REQUEST_TYPE_SUPL;
+    cmsgbuf.cmsg.cmsg_if_request.sender_id = IF_REQUEST_SENDER_ID_GPSONE_DAEMON;
+    if (send(fd, &cmsgbuf, sizeof(cmsgbuf), MSG_NOSIGNAL) != (ssize_t) sizeof(cmsgbuf)) {
+        fprintf(stderr, "send failed: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* returns the result of the next GPSONE_LOC_API_RESPONSE, or -1 */
+static int stub_wait_response(int fd)
+{
+    struct ctrl_msgbuf cmsgbuf;
+    struct pollfd pfd;
+    ssize_t len;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    for (;;) {
+        int ready = poll(&pfd, 1, STUB_RESPONSE_TIMEOUT_MS);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            fprintf(stderr, "no response: %s\n", ready ? strerror(errno) : "timed out");
+            return -1;
+        }
+
+        len = recv(fd, &cmsgbuf, sizeof(cmsgbuf), 0);
+        if (len <= 0) {
+            fprintf(stderr, "resp socket closed\n");
+            return -1;
+        }
+        if (len >= (ssize_t) sizeof(cmsgbuf) &&
+            cmsgbuf.ctrl_type == GPSONE_LOC_API_RESPONSE) {
+            return cmsgbuf.cmsg.cmsg_response.result;
+        }
+        printf("ignored ctrl_type = %d, %d bytes\n", cmsgbuf.ctrl_type, (int) len);
+    }
+}
+
+static const char * stub_result_name(int result)
+{
+    switch (result) {
+    case GPSONE_LOC_API_IF_REQUEST_SUCCESS: return "IF_REQUEST_SUCCESS";
+    case GPSONE_LOC_API_IF_RELEASE_SUCCESS: return "IF_RELEASE_SUCCESS";
+    case GPSONE_LOC_API_IF_FAILURE:         return "IF_FAILURE";
+    default:                                return "unknown";
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 1;
+    int api_fd, resp_fd, i, result;
+
+    api_fd = stub_connect(GPSONE_LOC_API_Q_PATH);
+    resp_fd = stub_connect(GPSONE_LOC_API_RESP_Q_PATH);
+    if (api_fd < 0 || resp_fd < 0) {
+        return 1;
+    }
+
+    for (i = 0; i < rounds; i++) {
+        if (stub_send(api_fd, GPSONE_LOC_API_IF_REQUEST) < 0) {
+            return 1;
+        }
+        result = stub_wait_response(resp_fd);
+        printf("%d: request -> %s (%d)\n", i, stub_result_name(result), result);
+
+        if (stub_send(api_fd, GPSONE_LOC_API_IF_RELEASE) < 0) {
+            return 1;
+        }
+        result = stub_wait_response(resp_fd);
+        printf("%d: release -> %s (%d)\n", i, stub_result_name(result), result);
+    }
+
+    close(api_fd);
+    close(resp_fd);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Sentences per second for a $GPGGA built with LocEngNmeaEncoder, and
+// for the same sentence built the way loc_eng_nmea.cpp used to, with
+// snprintf, gmtime and a checksum pass at the end.
+// Usage: loc_eng_nmea_enc_bench [sentences]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <loc_eng_nmea_enc.h>
+
+#define BENCH_DEFAULT_SENTENCES 1000000
+
+struct bench_fix {
+    time_t utcTime;
+    double latitude;
+    double longitude;
+    double altitude;
+    float hdop;
+};
+
+static int64_t bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int bench_encoder(const bench_fix& fix, char* sentence, int size)
+{
+    LocEngNmeaEncoder enc(sentence, size);
+    struct tm utcTm;
+    loc_eng_nmea_utc_time(fix.utcTime, &utcTm);
+
+    double latMinutes = (fix.latitude - (int)fix.latitude) * 60.0;
+    double lonMinutes = (fix.longitude - (int)fix.longitude) * 60.0;
+
+    enc.begin("GP");
+    enc.putStr("GGA,");
+    enc.putUInt(utcTm.tm_hour, 2);
+    enc.putUInt(utcTm.tm_min, 2);
+    enc.putUInt(utcTm.tm_sec, 2);
+    enc.putComma();
+    enc.putUInt((int)fix.latitude, 2);
+    enc.putFixed(latMinutes, 2, 4);
+    enc.putStr(",N,");
+    enc.putUInt((int)fix.longitude, 3);
+    enc.putFixed(lonMinutes, 2, 4);
+    enc.putStr(",E,1,08,");
+    enc.putFixed(fix.hdop, 1, 1);
+    enc.putComma();
+    enc.putFixed(fix.altitude, 1, 1);
+    enc.putStr(",M,,M,,");
+    return enc.finish();
+}
+
+static int bench_snprintf(const bench_fix& fix, char* sentence, int size)
+{
+    struct tm* pTm = gmtime(&fix.utcTime);
+
+    double latMinutes = (fix.latitude - (int)fix.latitude) * 60.0;
+    double lonMinutes = (fix.longitude - (int)fix.longitude) * 60.0;
+
+    int length = snprintf(sentence, size,
+                          "$GPGGA,%02d%02d%02d,%02d%07.4lf,N,%03d%07.4lf,E,1,08,"
+                          "%.1f,%.1lf,M,,M,,",
+                          pTm->tm_hour, pTm->tm_min, pTm->tm_sec,
+                          (int)fix.latitude, latMinutes,
+                          (int)fix.longitude, lonMinutes,
+                          fix.hdop, fix.altitude);
+
+    uint8_t checksum = 0;
+    for (int i = 1; i < length; i++) {
+        checksum ^= sentence[i];
+    }
+    length += snprintf(sentence + length, size - length, "*%02X\r\n", checksum);
+    return length;
+}
+
+int main(int argc, char* argv[])
+{
+    int sentences = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_SENTENCES;
+    if (sentences <= 0) {
+        fprintf(stderr, "usage: %s [sentences]\n", argv[0]);
+        return 1;
+    }
+
+    bench_fix fix = { 1370000000, 32.8812345, 117.2345678, 123.45, 0.9f };
+    char sentence[200];
+    char reference[200];
+    bench_encoder(fix, sentence, sizeof(sentence));
+    bench_snprintf(fix, reference, sizeof(reference));
+    if (strcmp(sentence, reference)) {
+        fprintf(stderr, "sentences differ:\n%s%s", sentence, reference);
+        return 1;
+    }
+
+    // one fix a second, as the modem reports them
+    int64_t start = bench_now_ns();
+    for (int i = 0; i < sentences; i++) {
+        fix.utcTime++;
+        bench_encoder(fix, sentence, sizeof(sentence));
+    }
+    int64_t encoderNs = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (int i = 0; i < sentences; i++) {
+        fix.utcTime++;
+        bench_snprintf(fix, sentence, sizeof(sentence));
+    }
+    int64_t snprintfNs = bench_now_ns() - start;
+
+    printf("encoder:  %.0f sentences/s\n", sentences * 1e9 / encoderNs);
+    printf("snprintf: %.0f sentences/s\n", sentences * 1e9 / snprintfNs);
+    printf("speedup:  %.2fx\n", (double)snprintfNs / encoderNs);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Checks LocEngNmeaEncoder::putFixed() digit for digit against "%0*.*f",
+// on random values and on the decimal ties whose binary value lands on
+// either side of the tie. Prints every mismatch, exits 1 if there was any.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <loc_eng_nmea_enc.h>
+
+#define TEST_RANDOM_VALUES 200000
+
+static int mismatches = 0;
+static int checked = 0;
+
+static void check(double value, int intWidth, int fracDigits)
+{
+    char expected[64];
+    int width = intWidth + (fracDigits > 0 ? fracDigits + 1 : 0);
+    snprintf(expected, sizeof(expected), "%0*.*f", width, fracDigits, value);
+
+    char buf[64];
+    LocEngNmeaEncoder enc(buf, sizeof(buf));
+    enc.putFixed(value, intWidth, fracDigits);
+    enc.finish();
+    // strip "*XX\r\n"
+    *strchr(buf, '*') = '\0';
+
+    checked++;
+    if (strcmp(buf, expected)) {
+        if (mismatches++ < 20) {
+            printf("%.17g %d %d: got \"%s\", printf \"%s\"\n",
+                   value, intWidth, fracDigits, buf, expected);
+        }
+    }
+}
+
+int main()
+{
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+    };
+
+    srand48(20130601);
+    for (int fracDigits = 0; fracDigits <= 9; fracDigits++) {
+        // k + 0.5 units of the last digit, e.g. 0.35, 0.05, 1.05
+        for (int k = 0; k < 20000; k++) {
+            double tie = (k + 0.5) / pow10[fracDigits];
+            check(tie, 1, fracDigits);
+            check(-tie, 3, fracDigits);
+        }
+        for (int i = 0; i < TEST_RANDOM_VALUES / 10; i++) {
+            // lat/long minutes, altitude, speed; up to the 4e9 limit
+            double magnitude = pow10[lrand48() % 10];
+            double value = (drand48() - 0.25) * magnitude;
+            check(value, 2, fracDigits);
+        }
+    }
+    // products past 2^53
+    check(3999999999.123456789, 10, 9);
+    check(123456789.0000000005, 1, 9);
+
+    printf("%d values, %d mismatches\n", checked, mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Runs the XTRA cache of loc_eng_xtra.cpp through loc_eng_init, with a
+// stub adapter standing in for the modem and a stub download_request_cb
+// for the framework: a modem request without a cache asks for a
+// download, the downloaded data is cached and injected from the cache
+// on the next request, a modem asking again right after that drops the
+// cache, and a cache that ran out, was cut short, does not match its
+// CRC or was refused by the engine is not used. Prints every failed
+// check, exits 1 if there was any. The cache is written to $TMPDIR, or
+// /data/local/tmp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <loc_eng.h>
+
+#define TEST_XTRA_LENGTH (40 * 1024)
+#define TEST_SYNC_MS     2000
+
+#define CHECK(cond) test_check((cond), #cond, __LINE__)
+
+static int failures = 0;
+static int checks = 0;
+
+static pthread_mutex_t testLock = PTHREAD_MUTEX_INITIALIZER;
+static int downloads;        // download_request_cb calls
+static int injects;          // setXtraData calls
+static int timeSets;         // setTime calls, see test_sync
+static bool refuseXtra;      // setXtraData fails
+static char* injected;       // data of the last setXtraData
+static int injectedLength;
+
+static loc_eng_data_s_type locEngData;
+static char xtraData[TEST_XTRA_LENGTH];
+static char cachePath[LOC_MAX_PARAM_STRING + 1];
+
+static void test_check(bool ok, const char* what, int line)
+{
+    checks++;
+    if (!ok) {
+        failures++;
+        printf("line %d: %s failed\n", line, what);
+    }
+}
+
+class XtraTestAdapter : public LocApiAdapter {
+public:
+    XtraTestAdapter(LocEng &locEng) : LocApiAdapter(locEng) {}
+
+    virtual enum loc_api_adapter_err setXtraData(char* data, int length)
+    {
+        pthread_mutex_lock(&testLock);
+        injects++;
+        free(injected);
+        injected = (char*)malloc(length);
+        memcpy(injected, data, length);
+        injectedLength = length;
+        bool refuse = refuseXtra;
+        pthread_mutex_unlock(&testLock);
+        return refuse ? LOC_API_ADAPTER_ERR_FAILURE : LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+
+    virtual enum loc_api_adapter_err setTime(GpsUtcTime time, int64_t timeReference,
+                                             int uncertainty)
+    {
+        pthread_mutex_lock(&testLock);
+        timeSets++;
+        pthread_mutex_unlock(&testLock);
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+};
+
+static LocApiAdapter* test_adapter_factory(LocEng &locEng)
+{
+    return new XtraTestAdapter(locEng);
+}
+
+static void test_download_request()
+{
+    pthread_mutex_lock(&testLock);
+    downloads++;
+    pthread_mutex_unlock(&testLock);
+}
+
+static pthread_t test_create_thread(const char* name, void (*start)(void*), void* arg)
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, (void* (*)(void*))start, arg);
+    pthread_detach(thread);
+    return thread;
+}
+
+static void test_status(GpsStatus* status) {}
+static void test_wakelock() {}
+
+static GpsXtraCallbacks xtraCallbacks = {
+    test_download_request,
+    test_create_thread
+};
+
+// Waits until the deferred action thread is done with everything sent
+// to it so far, and with what that sent in turn. Time injections queue
+// up behind the other msgs and are seen by the adapter.
+static void test_sync()
+{
+    for (int round = 0; round < 2; round++) {
+        pthread_mutex_lock(&testLock);
+        int wanted = timeSets + 1;
+        pthread_mutex_unlock(&testLock);
+
+        loc_eng_inject_time(locEngData, 0, 0, 0);
+        for (int ms = 0; ms < TEST_SYNC_MS; ms++) {
+            pthread_mutex_lock(&testLock);
+            bool done = timeSets >= wanted;
+            pthread_mutex_unlock(&testLock);
+            if (done) {
+                break;
+            }
+            usleep(1000);
+        }
+    }
+}
+
+// Restarts the XTRA module, as after a reboot, and clears the counts
+static void test_restart(unsigned long validityHours)
+{
+    gps_conf.XTRA_CACHE_VALIDITY = validityHours;
+    loc_eng_xtra_init(locEngData, &xtraCallbacks);
+    pthread_mutex_lock(&testLock);
+    downloads = injects = 0;
+    refuseXtra = false;
+    pthread_mutex_unlock(&testLock);
+}
+
+static void test_modem_request()
+{
+    locEngData.client_handle->requestXtraData();
+    test_sync();
+}
+
+// The framework comes back with the download, which is then cached
+static void test_download(unsigned long validityHours)
+{
+    gps_conf.XTRA_CACHE_VALIDITY = validityHours;
+    loc_eng_xtra_inject_data(locEngData, xtraData, sizeof(xtraData));
+    test_sync();
+    pthread_mutex_lock(&testLock);
+    downloads = injects = 0;
+    pthread_mutex_unlock(&testLock);
+}
+
+static bool test_injected_xtra_data()
+{
+    pthread_mutex_lock(&testLock);
+    bool same = injectedLength == (int)sizeof(xtraData) &&
+                0 == memcmp(injected, xtraData, sizeof(xtraData));
+    pthread_mutex_unlock(&testLock);
+    return same;
+}
+
+static bool test_cache_exists()
+{
+    return 0 == access(cachePath, F_OK);
+}
+
+static void test_no_cache()
+{
+    unlink(cachePath);
+    test_restart(168);
+
+    test_modem_request();
+    CHECK(downloads == 1 && injects == 0);
+    // only asked for once while the download is under way
+    test_modem_request();
+    CHECK(downloads == 1 && injects == 0);
+
+    loc_eng_xtra_inject_data(locEngData, xtraData, sizeof(xtraData));
+    test_sync();
+    CHECK(injects == 1 && test_injected_xtra_data());
+    CHECK(test_cache_exists());
+}
+
+static void test_cached()
+{
+    test_restart(168);
+
+    test_modem_request();
+    CHECK(downloads == 0 && injects == 1);
+    CHECK(test_injected_xtra_data());
+
+    // the modem did not take it, the cache is no good
+    test_modem_request();
+    CHECK(downloads == 1 && injects == 1);
+    CHECK(!test_cache_exists());
+}
+
+static void test_expired()
+{
+    test_download(0);
+    test_restart(168);
+    test_modem_request();
+    CHECK(downloads == 1 && injects == 0);
+    CHECK(test_cache_exists());
+
+    // in its last day, injected and replaced
+    test_download(12);
+    test_restart(168);
+    test_modem_request();
+    CHECK(downloads == 1 && injects == 1);
+}
+
+static void test_corrupt(off_t offset, bool truncate)
+{
+    test_download(168);
+
+    int fd = open(cachePath, O_RDWR);
+    struct stat st;
+    CHECK(fd >= 0 && 0 == fstat(fd, &st));
+    if (truncate) {
+        CHECK(0 == ftruncate(fd, st.st_size - 1));
+    } else {
+        char c;
+        off_t at = offset < 0 ? st.st_size + offset : offset;
+        CHECK(1 == pread(fd, &c, 1, at));
+        c ^= 0x10;
+        CHECK(1 == pwrite(fd, &c, 1, at));
+    }
+    close(fd);
+
+    test_restart(168);
+    test_modem_request();
+    CHECK(downloads == 1 && injects == 0);
+}
+
+static void test_refused()
+{
+    test_download(168);
+    test_restart(168);
+    refuseXtra = true;
+
+    test_modem_request();
+    CHECK(downloads == 1 && injects == 1);
+    // not tried again
+    test_modem_request();
+    CHECK(downloads == 1 && injects == 1);
+}
+
+int main()
+{
+    const char* dir = getenv("TMPDIR");
+    LocCallbacks callbacks;
+
+    snprintf(cachePath, sizeof(cachePath), "%s/loc_eng_xtra_test.%d",
+             dir ? dir : "/data/local/tmp", (int)getpid());
+    srand48(20130601);
+    for (int i = 0; i < (int)sizeof(xtraData); i++) {
+        xtraData[i] = (char)lrand48();
+    }
+
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.status_cb = test_status;
+    callbacks.acquire_wakelock_cb = test_wakelock;
+    callbacks.release_wakelock_cb = test_wakelock;
+    callbacks.create_thread_cb = test_create_thread;
+    LocApiAdapter::testAdapterFactory = test_adapter_factory;
+    if (0 != loc_eng_init(locEngData, &callbacks, LOC_API_ADAPTER_BIT_ASSISTANCE_DATA_REQUEST,
+                          NULL)) {
+        printf("loc_eng_init failed\n");
+        return 1;
+    }
+    strlcpy(gps_conf.XTRA_CACHE, cachePath, sizeof(gps_conf.XTRA_CACHE));
+
+    test_no_cache();
+    test_cached();
+    test_expired();
+    test_corrupt(0, false);     // magic
+    test_corrupt(0, true);      // size
+    test_corrupt(-1, false);    // CRC
+    test_refused();
+
+    loc_eng_cleanup(locEngData);
+    unlink(cachePath);
+    printf("%d checks, %d failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
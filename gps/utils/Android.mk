@@ -14,12 +14,18 @@ LOCAL_SRC_FILES += \
     loc_log.cpp \
     loc_cfg.cpp \
     msg_q.c \
-    linked_list.c
+    msg_q_ring.c \
+    linked_list.c \
+    loc_timer.c
 
 LOCAL_CFLAGS += \
      -fno-short-enums \
      -D_ANDROID_
 
+## Most verbose LOC_LOG level compiled in, see log_util.h
+LOC_UTILS_LOG_MIN_LEVEL ?= 5
+LOCAL_CFLAGS += -DLOC_LOG_MIN_LEVEL=$(LOC_UTILS_LOG_MIN_LEVEL)
+
 LOCAL_LDFLAGS += -Wl,--export-dynamic
 
 ## Includes
@@ -31,7 +37,8 @@ LOCAL_COPY_HEADERS:= \
    loc_cfg.h \
    log_util.h \
    linked_list.h \
-   msg_q.h
+   msg_q.h \
+   loc_timer.h
 
 LOCAL_MODULE := libgps.utils
 
@@ -39,5 +46,104 @@ LOCAL_MODULE_TAGS := optional
 
 LOCAL_MODULE_RELATIVE_PATH :=
 include $(BUILD_SHARED_LIBRARY)
+
+# loc_log_bench, with every LOC_LOG level compiled in and with
+# LOC_LOG_MIN_LEVEL=3; both compile the queue in, to log at their level
+LOC_LOG_BENCH_SRC_FILES := \
+    test/loc_log_bench.c \
+    loc_log.cpp \
+    loc_cfg.cpp \
+    msg_q.c \
+    msg_q_ring.c \
+    linked_list.c
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := loc_log_bench
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils
+
+LOCAL_SRC_FILES := $(LOC_LOG_BENCH_SRC_FILES)
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_ \
+     -DLOC_LOG_MIN_LEVEL=5
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := loc_log_bench_min3
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils
+
+LOCAL_SRC_FILES := $(LOC_LOG_BENCH_SRC_FILES)
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_ \
+     -DLOC_LOG_MIN_LEVEL=3
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := loc_cfg_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libgps.utils
+
+LOCAL_SRC_FILES := test/loc_cfg_test.c
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := loc_timer_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_STATIC_LIBRARIES := \
+    libutils \
+    libcutils \
+    liblog
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+# loc_timer.c is built in with a wheel of 16, 4 and 4 slots
+LOCAL_SRC_FILES := \
+    test/loc_timer_test.c \
+    loc_timer.c \
+    loc_log.cpp \
+    loc_cfg.cpp \
+    msg_q.c \
+    msg_q_ring.c \
+    linked_list.c
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_ \
+     -DLOC_TIMER_L0_BITS=4 \
+     -DLOC_TIMER_L1_BITS=2 \
+     -DLOC_TIMER_L2_BITS=2
+
+include $(BUILD_HOST_EXECUTABLE)
 endif # not BUILD_TINY_ANDROID
 
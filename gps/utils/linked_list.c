@@ -46,8 +46,78 @@ typedef struct list_element {
 typedef struct list_state {
    list_element* p_head;
    list_element* p_tail;
+   list_element* p_free;            /* Released elements kept for reuse */
+   unsigned int free_num;           /* Number of elements in p_free */
+   unsigned int free_max;           /* High-water mark of p_free */
 } list_state;
 
+/*===========================================================================
+FUNCTION    linked_list_alloc_elem
+
+DESCRIPTION
+   Gets a list element from the free pool of the list, or from the heap if
+   the pool is empty.
+
+   p_list: List the element is for.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The element; NULL if out of memory
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static list_element* linked_list_alloc_elem(list_state* p_list)
+{
+   list_element* elem = p_list->p_free;
+
+   if( elem != NULL )
+   {
+      p_list->p_free = elem->next;
+      p_list->free_num--;
+      return elem;
+   }
+
+   return (list_element*)malloc(sizeof(list_element));
+}
+
+/*===========================================================================
+FUNCTION    linked_list_release_elem
+
+DESCRIPTION
+   Returns a list element to the free pool of the list, or to the heap if
+   the pool is at its high-water mark.
+
+   p_list: List the element was on.
+   elem:   Element to release.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void linked_list_release_elem(list_state* p_list, list_element* elem)
+{
+   if( p_list->free_num < p_list->free_max )
+   {
+      elem->next = p_list->p_free;
+      p_list->p_free = elem;
+      p_list->free_num++;
+   }
+   else
+   {
+      free(elem);
+   }
+}
+
 /* ----------------------- END INTERNAL FUNCTIONS ---------------------------------------- */
 
 /*===========================================================================
@@ -56,6 +126,16 @@ typedef struct list_state {
 
   ===========================================================================*/
 linked_list_err_type linked_list_init(void** list_data)
+{
+   return linked_list_init_pool(list_data, LINKED_LIST_DEFAULT_POOL_MAX);
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_init_pool
+
+  ===========================================================================*/
+linked_list_err_type linked_list_init_pool(void** list_data, unsigned int pool_max)
 {
    if( list_data == NULL )
    {
@@ -73,6 +153,9 @@ linked_list_err_type linked_list_init(void** list_data)
 
    tmp_list->p_head = NULL;
    tmp_list->p_tail = NULL;
+   tmp_list->p_free = NULL;
+   tmp_list->free_num = 0;
+   tmp_list->free_max = pool_max;
 
    *list_data = tmp_list;
 
@@ -96,6 +179,13 @@ linked_list_err_type linked_list_destroy(void** list_data)
 
    linked_list_flush(p_list);
 
+   while( p_list->p_free != NULL )
+   {
+      list_element* tmp = p_list->p_free->next;
+      free(p_list->p_free);
+      p_list->p_free = tmp;
+   }
+
    free(*list_data);
    *list_data = NULL;
 
@@ -123,7 +213,7 @@ linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dea
    }
 
    list_state* p_list = (list_state*)list_data;
-   list_element* elem = (list_element*)malloc(sizeof(list_element));
+   list_element* elem = linked_list_alloc_elem(p_list);
    if( elem == NULL )
    {
       LOC_LOGE("%s: Memory allocation failed\n", __FUNCTION__);
@@ -197,8 +287,8 @@ linked_list_err_type linked_list_remove(void* list_data, void **data_obj)
    /* Copy data to output param */
    *data_obj = tmp->data_ptr;
 
-   /* Free allocated list element */
-   free(tmp);
+   /* Release list element */
+   linked_list_release_elem(p_list, tmp);
 
    return eLINKED_LIST_SUCCESS;
 }
@@ -248,8 +338,8 @@ linked_list_err_type linked_list_flush(void* list_data)
          p_list->p_head->dealloc_func(p_list->p_head->data_ptr);
       }
 
-      /* Free list element */
-      free(p_list->p_head);
+      /* Release list element */
+      linked_list_release_elem(p_list, p_list->p_head);
 
       p_list->p_head = tmp;
    }
@@ -314,7 +404,7 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
          if (NULL == data_p && NULL != tmp->dealloc_func) {
              tmp->dealloc_func(tmp->data_ptr);
          }
-         free(tmp);
+         linked_list_release_elem(p_list, tmp);
        }
 
        tmp = NULL;
@@ -326,3 +416,145 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
    return eLINKED_LIST_SUCCESS;
 }
 
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_init
+
+  ===========================================================================*/
+linked_list_err_type linked_list_intr_init(linked_list_node* head)
+{
+   if( head == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_PARAMETER;
+   }
+
+   head->next = head;
+   head->prev = head;
+
+   return eLINKED_LIST_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_add
+
+  ===========================================================================*/
+linked_list_err_type linked_list_intr_add(linked_list_node* head, linked_list_node* node)
+{
+   if( head == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   if( node == NULL )
+   {
+      LOC_LOGE("%s: Invalid input parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_PARAMETER;
+   }
+
+   node->next = head->next;
+   node->prev = head;
+   head->next->prev = node;
+   head->next = node;
+
+   return eLINKED_LIST_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_remove
+
+  ===========================================================================*/
+linked_list_err_type linked_list_intr_remove(linked_list_node* head, linked_list_node** node)
+{
+   if( head == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   if( node == NULL )
+   {
+      LOC_LOGE("%s: Invalid input parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_PARAMETER;
+   }
+
+   if( head->prev == head )
+   {
+      return eLINKED_LIST_UNAVAILABLE_RESOURCE;
+   }
+
+   *node = head->prev;
+
+   return linked_list_intr_unlink(*node);
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_unlink
+
+  ===========================================================================*/
+linked_list_err_type linked_list_intr_unlink(linked_list_node* node)
+{
+   if( node == NULL || node->next == NULL || node->prev == NULL )
+   {
+      LOC_LOGE("%s: Invalid input parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_PARAMETER;
+   }
+
+   node->prev->next = node->next;
+   node->next->prev = node->prev;
+   node->next = node->prev = NULL;
+
+   return eLINKED_LIST_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_empty
+
+  ===========================================================================*/
+int linked_list_intr_empty(const linked_list_node* head)
+{
+   if( head == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return (int)eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   return head->next == head ? 1 : 0;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_search
+
+  ===========================================================================*/
+linked_list_err_type linked_list_intr_search(linked_list_node* head, linked_list_node** node_p,
+                                             bool (*equal)(void* data_0, linked_list_node* node),
+                                             void* data_0)
+{
+   if( head == NULL || NULL == equal || NULL == node_p )
+   {
+      LOC_LOGE("%s: Invalid list parameter! head %p equal %p\n",
+               __FUNCTION__, head, equal);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   linked_list_node* tmp;
+
+   *node_p = NULL;
+
+   for( tmp = head->next; tmp != head; tmp = tmp->next )
+   {
+      if( (*equal)(data_0, tmp) )
+      {
+         *node_p = tmp;
+         break;
+      }
+   }
+
+   return eLINKED_LIST_SUCCESS;
+}
@@ -34,6 +34,7 @@ extern "C" {
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 /** Linked List Return Codes */
 typedef enum
@@ -52,6 +53,21 @@ typedef enum
      /**< Failed because an the supplied buffer was too small. */
 }linked_list_err_type;
 
+/** Number of released list elements linked_list_init keeps for reuse */
+#define LINKED_LIST_DEFAULT_POOL_MAX 16
+
+/** Link embedded in the objects of an intrusive list. An intrusive list
+    is headed by a linked_list_node of its own. */
+typedef struct linked_list_node
+{
+  struct linked_list_node* next;
+  struct linked_list_node* prev;
+}linked_list_node;
+
+/** Gets the object of type that embeds node_p as its member */
+#define LINKED_LIST_ENTRY(node_p, type, member) \
+   ((type*)((char*)(node_p) - offsetof(type, member)))
+
 /*===========================================================================
 FUNCTION    linked_list_init
 
@@ -72,6 +88,30 @@ SIDE EFFECTS
 ===========================================================================*/
 linked_list_err_type linked_list_init(void** list_data);
 
+/*===========================================================================
+FUNCTION    linked_list_init_pool
+
+DESCRIPTION
+   Initializes internal structures for linked list, like linked_list_init,
+   with the given high-water mark of its free element pool. Elements
+   released by remove, search and flush are kept in the pool, up to pool_max
+   of them, and reused by later adds instead of going back to the heap.
+
+   list_data: State of list to be initialized.
+   pool_max:  Max number of free elements kept. 0 disables the pool.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_init_pool(void** list_data, unsigned int pool_max);
+
 /*===========================================================================
 FUNCTION    linked_list_destroy
 
@@ -210,6 +250,141 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
                                         bool (*equal)(void* data_0, void* data),
                                         void* data_0, bool rm_if_found);
 
+/*===========================================================================
+FUNCTION    linked_list_intr_init
+
+DESCRIPTION
+   Initializes the head of an intrusive list to an empty list. The objects
+   of an intrusive list embed their own linked_list_node, so adding and
+   removing them never allocates or frees memory. The list does not own
+   the objects.
+
+   head: Head of the list.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_intr_init(linked_list_node* head);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_add
+
+DESCRIPTION
+   Adds a node to the head of an intrusive list. The node must not be on
+   any list.
+
+   head: Head of the list.
+   node: Node to add.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_intr_add(linked_list_node* head, linked_list_node* node);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_remove
+
+DESCRIPTION
+   Takes the tail node off an intrusive list, i.e. the node that was added
+   first.
+
+   head: Head of the list.
+   node: Set to the removed node.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above. eLINKED_LIST_UNAVAILABLE_RESOURCE if empty.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_intr_remove(linked_list_node* head, linked_list_node** node);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_unlink
+
+DESCRIPTION
+   Takes a node off whichever intrusive list it is on.
+
+   node: Node to take off.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_intr_unlink(linked_list_node* node);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_empty
+
+DESCRIPTION
+   Tells whether an intrusive list currently contains any nodes
+
+   head: Head of the list.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0/FALSE : List contains nodes
+   1/TRUE  : List is Empty
+   Otherwise look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int linked_list_intr_empty(const linked_list_node* head);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_search
+
+DESCRIPTION
+   Searches an intrusive list from its head for a node.
+
+   head:   Head of the list.
+   node_p: Set to the node found; NULL if no match.
+   equal:  Function ptr takes in a node, and returns indication if this
+           the one looking for.
+   data_0: The data being compared against.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_intr_search(linked_list_node* head, linked_list_node** node_p,
+                                             bool (*equal)(void* data_0, linked_list_node* node),
+                                             void* data_0);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -37,8 +37,14 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <loc_cfg.h>
 #include <log_util.h>
+#include <loc_log.h>
 
 /*=============================================================================
  *
@@ -46,15 +52,25 @@
  *
  *============================================================================*/
 
-/* Parameter data */
-static uint8_t DEBUG_LEVEL = 3;
-static uint8_t TIMESTAMP = 0;
+/* Parameter data, 'n' parameters are stored as 32 bit integers */
+static uint32_t DEBUG_LEVEL = 3;
+static uint32_t TIMESTAMP = 0;
+static uint32_t ASYNC_LOGGING = 0;
 
 /* Parameter spec table */
 static loc_param_s_type loc_parameter_table[] =
 {
   {"DEBUG_LEVEL",                    &DEBUG_LEVEL, NULL,                   'n'},
   {"TIMESTAMP",                      &TIMESTAMP,   NULL,                   'n'},
+  {"ASYNC_LOGGING",                  &ASYNC_LOGGING, NULL,                 'n'},
+};
+
+/* Limits of the parameters above, in the same order */
+static const loc_param_range_s_type loc_parameter_ranges[] =
+{
+  {0, 5},
+  {0, 1},
+  {0, 1},
 };
 
 int loc_param_num = sizeof(loc_parameter_table) / sizeof(loc_param_s_type);
@@ -80,9 +96,11 @@ static void loc_default_parameters()
    /* defaults */
    DEBUG_LEVEL = 3; /* debug level */
    TIMESTAMP = 0;
+   ASYNC_LOGGING = 0;
 
    /* reset logging mechanism */
    loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+   loc_logger_async_init(ASYNC_LOGGING);
 }
 
 /*===========================================================================
@@ -136,39 +154,86 @@ typedef struct loc_param_v_type
    char* param_str_value;
    int param_int_value;
    double param_double_value;
+   uint8_t param_int_valid;      /* whole value parsed as an integer */
+   uint8_t param_double_valid;   /* whole value parsed as a float */
+   uint32_t param_line;
 }loc_param_v_type;
 
 /*===========================================================================
-FUNCTION loc_set_config_entry
+FUNCTION loc_check_config_value
 
 DESCRIPTION
-   Potentially sets a given configuration table entry based on the passed in
-   configuration value. This is done by using a string comparison of the
-   parameter names and those found in the configuration file.
+   Checks a configuration value against the type of a table entry and,
+   for numbers, against its range.
 
 PARAMETERS:
-   config_entry: configuration entry in the table to possibly set
-   config_value: value to store in the entry if the parameter names match
+   config_entry: configuration entry the value is meant for
+   config_range: limits of the entry, NULL if it has none
+   config_value: value to check
 
 DEPENDENCIES
    N/A
 
 RETURN VALUE
-   None
+   0 if the value may be stored, otherwise the loc_param_err_e_type
 
 SIDE EFFECTS
    N/A
 ===========================================================================*/
-void loc_set_config_entry(loc_param_s_type* config_entry, loc_param_v_type* config_value)
+static int loc_check_config_value(const loc_param_s_type* config_entry,
+                                  const loc_param_range_s_type* config_range,
+                                  const loc_param_v_type* config_value)
 {
-   if(NULL == config_entry || NULL == config_value)
+   double number;
+
+   switch (config_entry->param_type)
    {
-      LOC_LOGE("%s: INVALID config entry or parameter", __FUNCTION__);
-      return;
+   case 's':
+      return (strlen(config_value->param_str_value) > LOC_MAX_PARAM_STRING) ?
+             LOC_PARAM_ERR_LENGTH : 0;
+   case 'n':
+      if (!config_value->param_int_valid) return LOC_PARAM_ERR_TYPE;
+      number = config_value->param_int_value;
+      break;
+   case 'f':
+      if (!config_value->param_double_valid) return LOC_PARAM_ERR_TYPE;
+      number = config_value->param_double_value;
+      break;
+   default:
+      return 0;
    }
 
-   if (strcmp(config_entry->param_name, config_value->param_name) == 0 &&
-               config_entry->param_ptr)
+   if (NULL != config_range && config_range->min_value <= config_range->max_value &&
+       (number < config_range->min_value || number > config_range->max_value))
+   {
+      return LOC_PARAM_ERR_RANGE;
+   }
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION loc_set_config_value
+
+DESCRIPTION
+   Stores a configuration value into a table entry, converted to the type
+   of the entry. The caller has already matched the parameter names.
+
+PARAMETERS:
+   config_entry: configuration entry in the table to set
+   config_value: value to store in the entry
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_set_config_value(loc_param_s_type* config_entry, const loc_param_v_type* config_value)
+{
+   if (config_entry->param_ptr)
    {
       switch (config_entry->param_type)
       {
@@ -217,17 +282,16 @@ void loc_set_config_entry(loc_param_s_type* config_entry, loc_param_v_type* conf
 }
 
 /*===========================================================================
-FUNCTION loc_read_conf
+FUNCTION loc_set_config_entry
 
 DESCRIPTION
-   Reads the specified configuration file and sets defined values based on
-   the passed in configuration table. This table maps strings to values to
-   set along with the type of each of these values.
+   Potentially sets a given configuration table entry based on the passed in
+   configuration value. This is done by using a string comparison of the
+   parameter names and those found in the configuration file.
 
 PARAMETERS:
-   conf_file_name: configuration file to read
-   config_table: table definition of strings to places to store information
-   table_length: length of the configuration table
+   config_entry: configuration entry in the table to possibly set
+   config_value: value to store in the entry if the parameter names match
 
 DEPENDENCIES
    N/A
@@ -238,73 +302,665 @@ RETURN VALUE
 SIDE EFFECTS
    N/A
 ===========================================================================*/
-void loc_read_conf(const char* conf_file_name, loc_param_s_type* config_table, uint32_t table_length)
+void loc_set_config_entry(loc_param_s_type* config_entry, loc_param_v_type* config_value)
 {
-   FILE *gps_conf_fp = NULL;
-   char input_buf[LOC_MAX_PARAM_LINE];  /* declare a char array */
-   char *lasts;
-   loc_param_v_type config_value;
-   uint32_t i;
+   if(NULL == config_entry || NULL == config_value)
+   {
+      LOC_LOGE("%s: INVALID config entry or parameter", __FUNCTION__);
+      return;
+   }
 
-   loc_default_parameters();
+   if (strcmp(config_entry->param_name, config_value->param_name) == 0)
+   {
+      loc_set_config_value(config_entry, config_value);
+   }
+}
+
+/*=============================================================================
+ *
+ *                          PARAMETER INDEX
+ *
+ * The configuration file is parsed once into a name -> value index. Every
+ * loc_read_conf call, whatever its table, is then served from the index
+ * with one hash lookup per table entry. The index is rebuilt only when the
+ * file name, identity, size or modification time changes.
+ *
+ * The file is mapped privately and tokenized in place: names and values
+ * point into the mapping and are terminated by overwriting the separator
+ * after them, so lines of any length are read without being copied.
+ *
+ *============================================================================*/
+#define LOC_PARAM_INDEX_LOAD_FACTOR  8    /* Slots per parameter */
+#define LOC_PARAM_INDEX_MIN_SLOTS    16
+#define LOC_PARAM_INDEX_SEEDS        32   /* Seeds tried for a collision free hash */
 
-   if((gps_conf_fp = fopen(conf_file_name, "r")) != NULL)
+typedef struct
+{
+   char                          file_name[LOC_MAX_PARAM_NAME * 4];
+   struct stat                   file_stat;
+   char                         *map;            /* Private mapping of the file */
+   size_t                        map_size;
+   char                         *last_line;      /* Copy of an unterminated last line */
+   loc_param_v_type             *entries;
+   uint32_t                      num_entries;
+   uint32_t                     *slots;          /* Entry index + 1, 0 if free */
+   uint32_t                      mask;           /* Number of slots - 1 */
+   uint32_t                      seed;
+} loc_param_index_s_type;
+
+static loc_param_index_s_type loc_param_index;
+static pthread_mutex_t loc_param_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* FNV-1a, seeded */
+static uint32_t loc_param_hash(const char* name, uint32_t seed)
+{
+   uint32_t hash = 2166136261u ^ (seed * 16777619u);
+
+   while (*name)
    {
-      LOC_LOGD("%s: using %s", __FUNCTION__, GPS_CONF_FILE);
+      hash ^= (uint8_t)*name++;
+      hash *= 16777619u;
    }
-   else
+   return hash;
+}
+
+static void loc_param_index_free(loc_param_index_s_type* index)
+{
+   if (NULL != index->map)
    {
-      LOC_LOGW("%s: no %s file found", __FUNCTION__, GPS_CONF_FILE);
-      return; /* no parameter file */
+      munmap(index->map, index->map_size);
    }
+   free(index->last_line);
+   free(index->entries);
+   free(index->slots);
+   memset(index, 0, sizeof(*index));
+}
+
+/*===========================================================================
+FUNCTION loc_param_index_insert
 
-   /* Clear all validity bits */
-   for(i = 0; NULL != config_table && i < table_length; i++)
+DESCRIPTION
+   Adds an entry to the hash slots with linear probing. A later entry with
+   the same name replaces the earlier one, so the last line of the file
+   wins as it always did.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Number of slots probed beyond the first one
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static uint32_t loc_param_index_insert(loc_param_index_s_type* index, uint32_t entry)
+{
+   const char* name = index->entries[entry].param_name;
+   uint32_t slot = loc_param_hash(name, index->seed) & index->mask;
+   uint32_t probes = 0;
+
+   while (index->slots[slot] != 0 &&
+          strcmp(index->entries[index->slots[slot] - 1].param_name, name) != 0)
    {
-      if(NULL != config_table[i].param_set)
+      slot = (slot + 1) & index->mask;
+      probes++;
+   }
+   index->slots[slot] = entry + 1;
+   return probes;
+}
+
+/*===========================================================================
+FUNCTION loc_param_index_hash
+
+DESCRIPTION
+   Builds the hash slots of a loaded index. Seeds are tried until one maps
+   every parameter name to its own slot, so a lookup is a single probe; if
+   none does, the last seed is kept and lookups fall back to probing.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if out of memory
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_param_index_hash(loc_param_index_s_type* index)
+{
+   uint32_t num_slots = LOC_PARAM_INDEX_MIN_SLOTS;
+   uint32_t seed, i, probes = 0;
+
+   while (num_slots < index->num_entries * LOC_PARAM_INDEX_LOAD_FACTOR)
+   {
+      num_slots <<= 1;
+   }
+
+   index->slots = (uint32_t*) malloc(num_slots * sizeof(uint32_t));
+   if (NULL == index->slots)
+   {
+      return -1;
+   }
+   index->mask = num_slots - 1;
+
+   for (seed = 0; seed < LOC_PARAM_INDEX_SEEDS; seed++)
+   {
+      memset(index->slots, 0, num_slots * sizeof(uint32_t));
+      index->seed = seed;
+      probes = 0;
+      for (i = 0; i < index->num_entries; i++)
       {
-         *(config_table[i].param_set) = 0;
+         probes += loc_param_index_insert(index, i);
+      }
+      if (probes == 0)
+      {
+         break;
       }
    }
 
-   while(fgets(input_buf, LOC_MAX_PARAM_LINE, gps_conf_fp) != NULL)
+   LOC_LOGV("%s: %u parameters in %u slots, seed %u, %u extra probes",
+            __FUNCTION__, index->num_entries, num_slots, index->seed, probes);
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION loc_param_trim
+
+DESCRIPTION
+   Trims the spaces around the text between start and end in place, by
+   skipping the leading ones and terminating the string after the last
+   non space.
+
+DEPENDENCIES
+   *end must be writable
+
+RETURN VALUE
+   Start of the trimmed string
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static char* loc_param_trim(char* start, char* end)
+{
+   while (start < end && isspace((unsigned char)*start)) start++;
+   while (end > start && isspace((unsigned char)end[-1])) end--;
+   *end = '\0';
+   return start;
+}
+
+/*===========================================================================
+FUNCTION loc_param_parse_numbers
+
+DESCRIPTION
+   Parses the numeric forms of a value. Hex values ("0x...") are only
+   integers. Either form is valid only if it takes up the whole value.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_param_parse_numbers(loc_param_v_type* value)
+{
+   const char* str = value->param_str_value;
+   char* end;
+   long number;
+
+   errno = 0;
+   if (str[0] == '0' && tolower(str[1]) == 'x')
    {
-      memset(&config_value, 0, sizeof(config_value));
+      /* hex, the full 32 bits can be used for masks */
+      unsigned long mask = strtoul(&str[2], &end, 16);
+      value->param_int_value = (int) mask;
+      value->param_int_valid = (end != &str[2] && *end == '\0' && errno == 0 &&
+                                mask <= UINT_MAX);
+      return;
+   }
+
+   number = strtol(str, &end, 10);
+   value->param_int_value = (int) number;
+   value->param_int_valid = (end != str && *end == '\0' && errno == 0 &&
+                             number >= INT_MIN && number <= INT_MAX);
+
+   errno = 0;
+   value->param_double_value = strtod(str, &end);
+   value->param_double_valid = (end != str && *end == '\0' && errno == 0);
+}
+
+/*===========================================================================
+FUNCTION loc_param_index_add_line
+
+DESCRIPTION
+   Tokenizes one line in place and adds it to the index. The name is the
+   text up to the first '=' and the value the text up to the next one,
+   both trimmed, as strtok_r used to split them.
+
+   line:     first character of the line
+   line_end: the '\n' ending the line, or a writable terminator
+   line_num: line number, from 1
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if out of memory
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_param_index_add_line(loc_param_index_s_type* index, uint32_t* capacity,
+                                    char* line, char* line_end, uint32_t line_num)
+{
+   char *name, *name_end, *value, *value_end;
+   loc_param_v_type* entry;
+
+   for (name = line; name < line_end && *name == '='; name++);
+   name_end = (char*) memchr(name, '=', line_end - name);
+   if (NULL == name_end) return 0;       /* skip lines that do not contain "=" */
 
-      /* Separate variable and value */
-      config_value.param_name = strtok_r(input_buf, "=", &lasts);
-      if (config_value.param_name == NULL) continue;       /* skip lines that do not contain "=" */
-      config_value.param_str_value = strtok_r(NULL, "=", &lasts);
-      if (config_value.param_str_value == NULL) continue;  /* skip lines that do not contain two operands */
+   for (value = name_end; value < line_end && *value == '='; value++);
+   if (value == line_end) return 0;      /* skip lines that do not contain two operands */
+   value_end = (char*) memchr(value, '=', line_end - value);
+   if (NULL == value_end) value_end = line_end;
 
-      /* Trim leading and trailing spaces */
-      trim_space(config_value.param_name);
-      trim_space(config_value.param_str_value);
+   name = loc_param_trim(name, name_end);
+   value = loc_param_trim(value, value_end);
+   if (name[0] == '#') return 0;         /* commented out, can never match */
 
-      /* Parse numerical value */
-      if (config_value.param_str_value[0] == '0' && tolower(config_value.param_str_value[1]) == 'x')
+   if (index->num_entries == *capacity)
+   {
+      loc_param_v_type* entries;
+      *capacity = *capacity ? *capacity * 2 : 32;
+      entries = (loc_param_v_type*) realloc(index->entries, *capacity * sizeof(loc_param_v_type));
+      if (NULL == entries)
       {
-         /* hex */
-         config_value.param_int_value = (int) strtol(&config_value.param_str_value[2], (char**) NULL, 16);
+         return -1;
       }
-      else {
-         config_value.param_double_value = (double) atof(config_value.param_str_value); /* float */
-         config_value.param_int_value = atoi(config_value.param_str_value); /* dec */
+      index->entries = entries;
+   }
+
+   entry = &index->entries[index->num_entries++];
+   memset(entry, 0, sizeof(*entry));
+   entry->param_name = name;
+   entry->param_str_value = value;
+   entry->param_line = line_num;
+   loc_param_parse_numbers(entry);
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION loc_param_index_load
+
+DESCRIPTION
+   Maps a configuration file and parses it into an index
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 on failure
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_param_index_load(loc_param_index_s_type* index, int fd, size_t size)
+{
+   uint32_t capacity = 0, line_num = 0;
+   char *line, *line_end, *end;
+
+   if (size == 0)
+   {
+      return loc_param_index_hash(index);
+   }
+
+   index->map = (char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+   if (MAP_FAILED == index->map)
+   {
+      index->map = NULL;
+      return -1;
+   }
+   index->map_size = size;
+
+   for (line = index->map, end = line + size; line < end; line = line_end + 1)
+   {
+      line_num++;
+      line_end = (char*) memchr(line, '\n', end - line);
+      if (NULL == line_end)
+      {
+         /* Nothing past the mapping may be written, terminate a copy */
+         index->last_line = (char*) malloc(end - line + 1);
+         if (NULL == index->last_line)
+         {
+            return -1;
+         }
+         memcpy(index->last_line, line, end - line);
+         line_end = index->last_line + (end - line);
+         line = index->last_line;
+         end = line_end;
+      }
+
+      if (loc_param_index_add_line(index, &capacity, line, line_end, line_num) != 0)
+      {
+         return -1;
+      }
+   }
+
+   return loc_param_index_hash(index);
+}
+
+/*===========================================================================
+FUNCTION loc_param_index_find
+
+DESCRIPTION
+   Looks a parameter up by name
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The value last given to the parameter in the file, NULL if not present
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static const loc_param_v_type* loc_param_index_find(const loc_param_index_s_type* index,
+                                                    const char* name)
+{
+   uint32_t slot;
+
+   if (index->num_entries == 0)
+   {
+      return NULL;
+   }
+
+   slot = loc_param_hash(name, index->seed) & index->mask;
+   while (index->slots[slot] != 0)
+   {
+      const loc_param_v_type* entry = &index->entries[index->slots[slot] - 1];
+      if (strcmp(entry->param_name, name) == 0)
+      {
+         return entry;
+      }
+      slot = (slot + 1) & index->mask;
+   }
+   return NULL;
+}
+
+/*===========================================================================
+FUNCTION loc_param_index_get
+
+DESCRIPTION
+   Returns the index of a configuration file, parsing the file only if it
+   is not the one indexed last or has changed since.
+
+DEPENDENCIES
+   loc_param_index_mutex must be held
+
+RETURN VALUE
+   The index, or NULL if the file could not be read
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static const loc_param_index_s_type* loc_param_index_get(const char* conf_file_name)
+{
+   loc_param_index_s_type* index = &loc_param_index;
+   struct stat file_stat;
+   int fd, result;
+
+   if (stat(conf_file_name, &file_stat) != 0)
+   {
+      loc_param_index_free(index);
+      return NULL;
+   }
+
+   if (index->slots != NULL &&
+       strcmp(index->file_name, conf_file_name) == 0 &&
+       index->file_stat.st_dev == file_stat.st_dev &&
+       index->file_stat.st_ino == file_stat.st_ino &&
+       index->file_stat.st_size == file_stat.st_size &&
+       index->file_stat.st_mtime == file_stat.st_mtime)
+   {
+      return index;
+   }
+
+   loc_param_index_free(index);
+   if ((fd = open(conf_file_name, O_RDONLY)) < 0)
+   {
+      return NULL;
+   }
+
+   /* The file may have been replaced since the stat above */
+   result = fstat(fd, &file_stat);
+   if (result == 0)
+   {
+      result = loc_param_index_load(index, fd, file_stat.st_size);
+   }
+   close(fd);
+
+   if (result != 0)
+   {
+      LOC_LOGE("%s: unable to index %s: %s", __FUNCTION__, conf_file_name, strerror(errno));
+      loc_param_index_free(index);
+      return NULL;
+   }
+
+   strlcpy(index->file_name, conf_file_name, sizeof(index->file_name));
+   index->file_stat = file_stat;
+   return index;
+}
+
+/*===========================================================================
+FUNCTION loc_param_err_string
+
+DESCRIPTION
+   Returns a printable name of a configuration error
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Name of the error
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+const char* loc_param_err_string(loc_param_err_e_type error)
+{
+   switch (error)
+   {
+   case LOC_PARAM_ERR_TYPE:   return "invalid type";
+   case LOC_PARAM_ERR_RANGE:  return "out of range";
+   case LOC_PARAM_ERR_LENGTH: return "too long";
+   }
+   return UNKNOWN_STR;
+}
+
+/*===========================================================================
+FUNCTION loc_apply_config_table
+
+DESCRIPTION
+   Sets the entries of a configuration table from an index. Values failing
+   loc_check_config_value are not stored, so the entry keeps its default,
+   and are reported through errors.
+
+DEPENDENCIES
+   loc_param_index_mutex must be held
+
+RETURN VALUE
+   Number of errors found, which may be more than max_errors
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static uint32_t loc_apply_config_table(const loc_param_index_s_type* index,
+                                       loc_param_s_type* config_table,
+                                       const loc_param_range_s_type* config_ranges,
+                                       uint32_t table_length, int clear_set_bits,
+                                       loc_param_err_s_type* errors, uint32_t max_errors)
+{
+   const loc_param_v_type* config_value;
+   uint32_t i, num_errors = 0;
+   int error;
+
+   for (i = 0; NULL != config_table && i < table_length; i++)
+   {
+      /* Clear the validity bit, then look the parameter up */
+      if (clear_set_bits && NULL != config_table[i].param_set)
+      {
+         *(config_table[i].param_set) = 0;
       }
 
-      for(i = 0; NULL != config_table && i < table_length; i++)
+      if ((config_value = loc_param_index_find(index, config_table[i].param_name)) == NULL)
       {
-         loc_set_config_entry(&config_table[i], &config_value);
+         continue;
       }
 
-      for(i = 0; i < loc_param_num; i++)
+      error = loc_check_config_value(&config_table[i],
+                                     config_ranges ? &config_ranges[i] : NULL,
+                                     config_value);
+      if (error != 0)
       {
-         loc_set_config_entry(&loc_parameter_table[i], &config_value);
+         if (NULL != errors && num_errors < max_errors)
+         {
+            loc_param_err_s_type* err = &errors[num_errors];
+            strlcpy(err->param_name, config_table[i].param_name, sizeof(err->param_name));
+            strlcpy(err->param_value, config_value->param_str_value, sizeof(err->param_value));
+            err->line = config_value->param_line;
+            err->error = (loc_param_err_e_type) error;
+         }
+         else if (NULL == errors)
+         {
+            LOC_LOGE("%s: line %u: %s = %s, %s", __FUNCTION__, config_value->param_line,
+                     config_table[i].param_name, config_value->param_str_value,
+                     loc_param_err_string((loc_param_err_e_type) error));
+         }
+         num_errors++;
+         continue;
       }
+
+      loc_set_config_value(&config_table[i], config_value);
    }
 
-   fclose(gps_conf_fp);
+   return num_errors;
+}
+
+/*===========================================================================
+FUNCTION loc_read_conf_checked
+
+DESCRIPTION
+   Reads the specified configuration file and sets defined values based on
+   the passed in configuration table, like loc_read_conf. Every value is
+   also checked against the type of its entry and, if config_ranges is
+   given, against the range of its entry. Values that fail are reported in
+   errors instead of being logged.
+
+PARAMETERS:
+   conf_file_name: configuration file to read
+   config_table: table definition of strings to places to store information
+   config_ranges: limits of the table entries, in the same order, or NULL
+   table_length: length of the configuration table
+   errors: receives up to max_errors errors, or NULL to log them
+   max_errors: size of errors
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Number of errors found in the table, which may be more than max_errors
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+uint32_t loc_read_conf_checked(const char* conf_file_name, loc_param_s_type* config_table,
+                               const loc_param_range_s_type* config_ranges, uint32_t table_length,
+                               loc_param_err_s_type* errors, uint32_t max_errors)
+{
+   const loc_param_index_s_type* index;
+   uint32_t num_errors;
+
+   pthread_mutex_lock(&loc_param_index_mutex);
+
+   loc_default_parameters();
+
+   if((index = loc_param_index_get(conf_file_name)) != NULL)
+   {
+      LOC_LOGD("%s: using %s", __FUNCTION__, GPS_CONF_FILE);
+   }
+   else
+   {
+      LOC_LOGW("%s: no %s file found", __FUNCTION__, GPS_CONF_FILE);
+      pthread_mutex_unlock(&loc_param_index_mutex);
+      return 0; /* no parameter file */
+   }
+
+   num_errors = loc_apply_config_table(index, config_table, config_ranges, table_length, 1,
+                                       errors, max_errors);
+   loc_apply_config_table(index, loc_parameter_table, loc_parameter_ranges, loc_param_num, 0,
+                          NULL, 0);
+
+   pthread_mutex_unlock(&loc_param_index_mutex);
 
    /* Initialize logging mechanism with parsed data */
    loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+   loc_logger_async_init(ASYNC_LOGGING);
+
+   return num_errors;
+}
+
+/*===========================================================================
+FUNCTION loc_read_conf
+
+DESCRIPTION
+   Reads the specified configuration file and sets defined values based on
+   the passed in configuration table. This table maps strings to values to
+   set along with the type of each of these values. Values that do not
+   match the type of their entry are logged and ignored.
+
+PARAMETERS:
+   conf_file_name: configuration file to read
+   config_table: table definition of strings to places to store information
+   table_length: length of the configuration table
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_read_conf(const char* conf_file_name, loc_param_s_type* config_table, uint32_t table_length)
+{
+   loc_read_conf_checked(conf_file_name, config_table, NULL, table_length, NULL, 0);
+}
+
+/*===========================================================================
+FUNCTION loc_read_conf_invalidate
+
+DESCRIPTION
+   Drops the cached index so the next read parses the file again. The
+   cache is keyed on the file's size and mtime, which an in place edit
+   within the same second can leave unchanged; callers that know the file
+   was rewritten call this before reading it.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_read_conf_invalidate(void)
+{
+   pthread_mutex_lock(&loc_param_index_mutex);
+   loc_param_index_free(&loc_param_index);
+   pthread_mutex_unlock(&loc_param_index_mutex);
 }
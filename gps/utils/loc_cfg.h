@@ -34,7 +34,7 @@
 
 #define LOC_MAX_PARAM_NAME                 48
 #define LOC_MAX_PARAM_STRING               80
-#define LOC_MAX_PARAM_LINE                 80
+#define LOC_MAX_PARAM_LINE                 80   /* No longer a limit of the reader */
 
 // Don't want to overwrite the pre-def'ed value
 #ifndef GPS_CONF_FILE
@@ -47,6 +47,14 @@
 #define UTIL_READ_CONF(filename, config_table) \
             loc_read_conf((filename), (config_table), sizeof(config_table) / sizeof(config_table[0]))
 
+#define UTIL_READ_CONF_CHECKED(filename, config_table, config_ranges, errors) \
+            loc_read_conf_checked((filename), (config_table), (config_ranges), \
+                                  sizeof(config_table) / sizeof(config_table[0]), \
+                                  (errors), sizeof(errors) / sizeof(errors[0]))
+
+/* Range entry of a parameter that is not range checked */
+#define LOC_PARAM_NO_RANGE                 { 1, 0 }
+
 /*=============================================================================
  *
  *                        MODULE TYPE DECLARATION
@@ -62,6 +70,31 @@ typedef struct
                                                  'f' for float */
 } loc_param_s_type;
 
+/* Limits of a numeric parameter, in a table parallel to a loc_param_s_type
+   table. min_value > max_value disables the check, see LOC_PARAM_NO_RANGE. */
+typedef struct
+{
+  double                         min_value;
+  double                         max_value;
+} loc_param_range_s_type;
+
+typedef enum
+{
+  LOC_PARAM_ERR_TYPE = 1,        /* not a number of the parameter type */
+  LOC_PARAM_ERR_RANGE,           /* number outside of the parameter range */
+  LOC_PARAM_ERR_LENGTH           /* string longer than LOC_MAX_PARAM_STRING */
+} loc_param_err_e_type;
+
+/* A configuration value that was rejected. Rejected values leave the
+   parameter untouched, a truncated string is no more usable than none. */
+typedef struct
+{
+  char                           param_name[LOC_MAX_PARAM_NAME];
+  char                           param_value[LOC_MAX_PARAM_STRING + 1];
+  uint32_t                       line;        /* line in the file, from 1 */
+  loc_param_err_e_type           error;
+} loc_param_err_s_type;
+
 /*=============================================================================
  *
  *                          MODULE EXTERNAL DATA
@@ -80,6 +113,14 @@ extern "C" {
 extern void loc_read_conf(const char* conf_file_name,
                           loc_param_s_type* config_table,
                           uint32_t table_length);
+extern uint32_t loc_read_conf_checked(const char* conf_file_name,
+                                      loc_param_s_type* config_table,
+                                      const loc_param_range_s_type* config_ranges,
+                                      uint32_t table_length,
+                                      loc_param_err_s_type* errors,
+                                      uint32_t max_errors);
+extern const char* loc_param_err_string(loc_param_err_e_type error);
+extern void loc_read_conf_invalidate(void);
 
 #ifdef __cplusplus
 }
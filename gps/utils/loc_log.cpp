@@ -31,7 +31,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <sys/time.h>
+#include <time.h>
 #include "loc_log.h"
 #include "msg_q.h"
 
@@ -181,3 +188,715 @@ char * get_timestamp(char *str, unsigned long buf_size)
   return str;
 }
 
+
+
+/*===========================================================================
+FUNCTION loc_log_ratelimit
+
+DESCRIPTION
+   Decides whether a rate limited log call site may log now. At most one
+   call per interval_ms is let through; the others are counted as
+   suppressed. Safe to call from several threads on the same call site.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if the caller should log, with the number of calls suppressed since
+   the last logged one stored in suppressed; 0 otherwise
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+int loc_log_ratelimit(loc_log_ratelimit_s_type* rl, unsigned long interval_ms,
+                      unsigned long* suppressed)
+{
+   struct timespec ts;
+   long long now_ms, next_ms;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   now_ms = (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+   next_ms = rl->next_ms;
+
+   if( now_ms < next_ms ||
+       !__sync_bool_compare_and_swap(&rl->next_ms, next_ms, now_ms + interval_ms) )
+   {
+      __sync_fetch_and_add(&rl->suppressed, 1);
+      return 0;
+   }
+
+   *suppressed = __sync_lock_test_and_set(&rl->suppressed, 0);
+   return 1;
+}
+
+
+/*=============================================================================
+ *
+ *                          ASYNCHRONOUS LOGGING
+ *
+ * Every logging thread owns a single producer / single consumer ring. The
+ * producer only copies the format pointer, the raw arguments and a
+ * monotonic timestamp into its ring; the flusher thread formats the entries
+ * of all rings in timestamp order and writes them to the log.
+ *
+ *============================================================================*/
+#define LOC_LOG_RING_SIZE         128      /* Entries per thread, power of 2 */
+#define LOC_LOG_MAX_ARGS          12       /* Arguments an entry can carry */
+#define LOC_LOG_STR_SPACE         128      /* Room for copies of %s arguments */
+#define LOC_LOG_LINE_SIZE         1024     /* Longest formatted line */
+#define LOC_LOG_SPEC_SIZE         32       /* Longest single conversion spec */
+#define LOC_LOG_FLUSH_PERIOD_US   20000
+
+/* Argument classes of a printf conversion */
+typedef enum {
+   LOC_LOG_ARG_INT,
+   LOC_LOG_ARG_LONG,
+   LOC_LOG_ARG_LLONG,
+   LOC_LOG_ARG_SIZE,
+   LOC_LOG_ARG_INTMAX,
+   LOC_LOG_ARG_PTRDIFF,
+   LOC_LOG_ARG_DOUBLE,
+   LOC_LOG_ARG_LDOUBLE,
+   LOC_LOG_ARG_PTR,
+   LOC_LOG_ARG_STR
+} loc_log_arg_e_type;
+
+/* One conversion of a format string */
+typedef struct {
+   const char*          start;      /* The '%' */
+   const char*          end;        /* One past the conversion character */
+   int                  stars;      /* Number of '*' width / precision args */
+   loc_log_arg_e_type   arg;
+} loc_log_conv_s_type;
+
+typedef union {
+   long long            ll;
+   double               d;
+   const void*          p;
+} loc_log_arg_u_type;
+
+typedef struct {
+   long long            ts_ns;
+   const char*          tag;
+   const char*          fmt;
+   int                  prio;
+   int                  num_args;
+   loc_log_arg_u_type   args[LOC_LOG_MAX_ARGS];
+   char                 str[LOC_LOG_STR_SPACE];
+} loc_log_entry_s_type;
+
+typedef struct loc_log_ring {
+   struct loc_log_ring* next;       /* Registered rings, owned by the flusher */
+   volatile int         orphaned;   /* Owning thread has exited */
+   volatile uint32_t    dropped;    /* Entries lost to a full ring */
+   char                 pad0[64];
+   volatile uint32_t    head;       /* Next entry to write, producer owned */
+   char                 pad1[64];
+   volatile uint32_t    tail;       /* Next entry to read, flusher owned */
+   char                 pad2[64];
+   loc_log_entry_s_type entries[LOC_LOG_RING_SIZE];
+} loc_log_ring_s_type;
+
+static pthread_once_t loc_log_async_once = PTHREAD_ONCE_INIT;
+static pthread_key_t loc_log_ring_key;
+static pthread_mutex_t loc_log_rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static loc_log_ring_s_type* loc_log_rings = NULL;
+static pthread_mutex_t loc_log_flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int loc_log_flusher_started = 0;
+static pthread_mutex_t loc_log_wake_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loc_log_wake_cond = PTHREAD_COND_INITIALIZER;
+
+static long long loc_log_now_ns()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*===========================================================================
+FUNCTION loc_log_next_conv
+
+DESCRIPTION
+   Finds the next conversion of a printf format string and classifies its
+   argument. "%%" is skipped as it takes no argument.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if a supported conversion was found, 0 at the end of the format,
+   -1 for a conversion the asynchronous path can not carry (%n, %m, ...)
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_log_next_conv(const char* p, loc_log_conv_s_type* conv)
+{
+   int longs = 0;
+
+   for( ;; )
+   {
+      p = strchr(p, '%');
+      if( p == NULL ) return 0;
+      if( p[1] != '%' ) break;
+      p += 2;
+   }
+
+   conv->start = p++;
+   conv->stars = 0;
+   conv->arg = LOC_LOG_ARG_INT;
+
+   while( *p != '\0' && strchr("-+ #0'", *p) != NULL ) p++;
+   if( *p == '*' ) { conv->stars++; p++; }
+   while( *p >= '0' && *p <= '9' ) p++;
+   if( *p == '.' )
+   {
+      p++;
+      if( *p == '*' ) { conv->stars++; p++; }
+      while( *p >= '0' && *p <= '9' ) p++;
+   }
+
+   switch( *p )
+   {
+   case 'h':
+      while( *p == 'h' ) p++;
+      break;
+   case 'l':
+      while( *p == 'l' ) { longs++; p++; }
+      break;
+   case 'q':
+      longs = 2; p++;
+      break;
+   case 'L':
+      conv->arg = LOC_LOG_ARG_LDOUBLE; p++;
+      break;
+   case 'z':
+      conv->arg = LOC_LOG_ARG_SIZE; p++;
+      break;
+   case 'j':
+      conv->arg = LOC_LOG_ARG_INTMAX; p++;
+      break;
+   case 't':
+      conv->arg = LOC_LOG_ARG_PTRDIFF; p++;
+      break;
+   }
+
+   switch( *p )
+   {
+   case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+      if( conv->arg == LOC_LOG_ARG_LDOUBLE ) conv->arg = LOC_LOG_ARG_LLONG;
+      else if( longs == 1 ) conv->arg = LOC_LOG_ARG_LONG;
+      else if( longs >= 2 ) conv->arg = LOC_LOG_ARG_LLONG;
+      break;
+   case 'c':
+      conv->arg = LOC_LOG_ARG_INT;
+      break;
+   case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      if( conv->arg != LOC_LOG_ARG_LDOUBLE ) conv->arg = LOC_LOG_ARG_DOUBLE;
+      break;
+   case 'p':
+      conv->arg = LOC_LOG_ARG_PTR;
+      break;
+   case 's':
+      if( longs != 0 ) return -1;
+      conv->arg = LOC_LOG_ARG_STR;
+      break;
+   default:
+      return -1;
+   }
+
+   conv->end = p + 1;
+   return (conv->end - conv->start < LOC_LOG_SPEC_SIZE) ? 1 : -1;
+}
+
+/*===========================================================================
+FUNCTION loc_log_capture
+
+DESCRIPTION
+   Copies the arguments of a log call into a ring entry without formatting
+   them. Strings are copied into the entry, truncated if they do not fit.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 on success, 0 if the format can not be carried asynchronously
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_log_capture(loc_log_entry_s_type* entry, const char* fmt, va_list ap)
+{
+   loc_log_conv_s_type conv;
+   const char* p = fmt;
+   int n = 0, rc, i;
+   size_t str_used = 0;
+
+   while( (rc = loc_log_next_conv(p, &conv)) > 0 )
+   {
+      if( n + conv.stars + 1 > LOC_LOG_MAX_ARGS ) return 0;
+      for( i = 0; i < conv.stars; i++ )
+      {
+         entry->args[n++].ll = va_arg(ap, int);
+      }
+
+      switch( conv.arg )
+      {
+      case LOC_LOG_ARG_INT:     entry->args[n].ll = va_arg(ap, int); break;
+      case LOC_LOG_ARG_LONG:    entry->args[n].ll = va_arg(ap, long); break;
+      case LOC_LOG_ARG_LLONG:   entry->args[n].ll = va_arg(ap, long long); break;
+      case LOC_LOG_ARG_SIZE:    entry->args[n].ll = va_arg(ap, size_t); break;
+      case LOC_LOG_ARG_INTMAX:  entry->args[n].ll = va_arg(ap, intmax_t); break;
+      case LOC_LOG_ARG_PTRDIFF: entry->args[n].ll = va_arg(ap, ptrdiff_t); break;
+      case LOC_LOG_ARG_DOUBLE:  entry->args[n].d = va_arg(ap, double); break;
+      case LOC_LOG_ARG_LDOUBLE: entry->args[n].d = (double)va_arg(ap, long double); break;
+      case LOC_LOG_ARG_PTR:     entry->args[n].p = va_arg(ap, void*); break;
+      case LOC_LOG_ARG_STR:
+      {
+         const char* str = va_arg(ap, const char*);
+         size_t room = sizeof(entry->str) - str_used;
+         size_t len;
+         if( str == NULL )
+         {
+            str = "(null)";
+         }
+         if( room == 0 )
+         {
+            /* Out of space, point at the terminator of the last string */
+            entry->args[n].ll = sizeof(entry->str) - 1;
+         }
+         else
+         {
+            entry->args[n].ll = str_used;
+            len = strlcpy(entry->str + str_used, str, room);
+            str_used += (len + 1 < room) ? len + 1 : room;
+         }
+         break;
+      }
+      }
+      n++;
+      p = conv.end;
+   }
+
+   entry->num_args = n;
+   return rc == 0;
+}
+
+/*===========================================================================
+FUNCTION loc_log_append_literal
+
+DESCRIPTION
+   Appends the text of a format string between two conversions to a line,
+   turning "%%" into '%'.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   New length of the line
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static size_t loc_log_append_literal(char* line, size_t size, size_t len,
+                                     const char* p, const char* end)
+{
+   while( (end == NULL ? *p != '\0' : p < end) && len + 1 < size )
+   {
+      line[len++] = *p;
+      p += (p[0] == '%' && p[1] == '%') ? 2 : 1;
+   }
+   line[len] = '\0';
+   return len;
+}
+
+/*===========================================================================
+FUNCTION loc_log_format
+
+DESCRIPTION
+   Formats a ring entry captured by loc_log_capture into a line, one
+   conversion at a time.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_log_format(const loc_log_entry_s_type* entry, char* line, size_t size,
+                           size_t len)
+{
+   loc_log_conv_s_type conv;
+   const char* p = entry->fmt;
+   char spec[LOC_LOG_SPEC_SIZE];
+   int n = 0, w = 0, s0, s1;
+
+   while( loc_log_next_conv(p, &conv) > 0 && n < entry->num_args )
+   {
+      const loc_log_arg_u_type* arg;
+      char* out;
+      size_t room;
+
+      len = loc_log_append_literal(line, size, len, p, conv.start);
+      memcpy(spec, conv.start, conv.end - conv.start);
+      spec[conv.end - conv.start] = '\0';
+      s0 = (conv.stars > 0) ? (int)entry->args[n].ll : 0;
+      s1 = (conv.stars > 1) ? (int)entry->args[n + 1].ll : 0;
+      arg = &entry->args[n + conv.stars];
+      out = line + len;
+      room = size - len;
+
+#define LOC_LOG_SNPRINTF(VAL)                                                \
+      (conv.stars == 0 ? snprintf(out, room, spec, VAL) :                   \
+       conv.stars == 1 ? snprintf(out, room, spec, s0, VAL) :               \
+                         snprintf(out, room, spec, s0, s1, VAL))
+
+      switch( conv.arg )
+      {
+      case LOC_LOG_ARG_INT:     w = LOC_LOG_SNPRINTF((int)arg->ll); break;
+      case LOC_LOG_ARG_LONG:    w = LOC_LOG_SNPRINTF((long)arg->ll); break;
+      case LOC_LOG_ARG_LLONG:   w = LOC_LOG_SNPRINTF(arg->ll); break;
+      case LOC_LOG_ARG_SIZE:    w = LOC_LOG_SNPRINTF((size_t)arg->ll); break;
+      case LOC_LOG_ARG_INTMAX:  w = LOC_LOG_SNPRINTF((intmax_t)arg->ll); break;
+      case LOC_LOG_ARG_PTRDIFF: w = LOC_LOG_SNPRINTF((ptrdiff_t)arg->ll); break;
+      case LOC_LOG_ARG_DOUBLE:  w = LOC_LOG_SNPRINTF(arg->d); break;
+      case LOC_LOG_ARG_LDOUBLE: w = LOC_LOG_SNPRINTF((long double)arg->d); break;
+      case LOC_LOG_ARG_PTR:     w = LOC_LOG_SNPRINTF(arg->p); break;
+      case LOC_LOG_ARG_STR:     w = LOC_LOG_SNPRINTF(entry->str + arg->ll); break;
+      }
+
+#undef LOC_LOG_SNPRINTF
+
+      if( w > 0 )
+      {
+         len += ((size_t)w < room) ? (size_t)w : room - 1;
+      }
+      n += conv.stars + 1;
+      p = conv.end;
+   }
+
+   loc_log_append_literal(line, size, len, p, NULL);
+}
+
+/*===========================================================================
+FUNCTION loc_log_ring_destructor
+
+DESCRIPTION
+   Thread exit hook of the ring key. The ring is left for the flusher to
+   drain and free.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_log_ring_destructor(void* arg)
+{
+   loc_log_ring_s_type* ring = (loc_log_ring_s_type*)arg;
+   __atomic_store_n(&ring->orphaned, 1, __ATOMIC_RELEASE);
+}
+
+/*===========================================================================
+FUNCTION loc_log_get_ring
+
+DESCRIPTION
+   Returns the ring of the calling thread, creating and registering it on
+   the first call.
+
+DEPENDENCIES
+   loc_logger_async_init must have succeeded
+
+RETURN VALUE
+   The ring, or NULL if it could not be allocated
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static loc_log_ring_s_type* loc_log_get_ring()
+{
+   loc_log_ring_s_type* ring = (loc_log_ring_s_type*)pthread_getspecific(loc_log_ring_key);
+
+   if( ring == NULL )
+   {
+      ring = (loc_log_ring_s_type*)calloc(1, sizeof(loc_log_ring_s_type));
+      if( ring == NULL )
+      {
+         return NULL;
+      }
+      pthread_setspecific(loc_log_ring_key, ring);
+
+      pthread_mutex_lock(&loc_log_rings_mutex);
+      ring->next = loc_log_rings;
+      loc_log_rings = ring;
+      pthread_mutex_unlock(&loc_log_rings_mutex);
+   }
+
+   return ring;
+}
+
+/*===========================================================================
+FUNCTION loc_log_async
+
+DESCRIPTION
+   Records a log message in the ring of the calling thread. Formats that
+   can not be carried (too many arguments, %n, ...) are written right away.
+   When the ring is full the message is dropped and counted.
+
+DEPENDENCIES
+   loc_logger_async_init must have succeeded
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_log_async(int prio, const char* tag, const char* fmt, ...)
+{
+   loc_log_ring_s_type* ring = loc_log_get_ring();
+   loc_log_entry_s_type* entry;
+   uint32_t head, tail;
+   int captured = 0;
+   va_list ap;
+
+   if( ring != NULL )
+   {
+      head = ring->head;
+      tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+      if( head - tail >= LOC_LOG_RING_SIZE )
+      {
+         __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+         return;
+      }
+
+      entry = &ring->entries[head & (LOC_LOG_RING_SIZE - 1)];
+      va_start(ap, fmt);
+      captured = loc_log_capture(entry, fmt, ap);
+      va_end(ap);
+
+      if( captured )
+      {
+         entry->ts_ns = loc_log_now_ns();
+         entry->tag = tag;
+         entry->fmt = fmt;
+         entry->prio = prio;
+         __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+         /* Wake the flusher early rather than start dropping */
+         if( head + 1 - tail == LOC_LOG_RING_SIZE / 2 )
+         {
+            pthread_mutex_lock(&loc_log_wake_mutex);
+            pthread_cond_signal(&loc_log_wake_cond);
+            pthread_mutex_unlock(&loc_log_wake_mutex);
+         }
+      }
+   }
+
+   if( !captured )
+   {
+      va_start(ap, fmt);
+      __android_log_vprint(prio, tag, fmt, ap);
+      va_end(ap);
+   }
+}
+
+/*===========================================================================
+FUNCTION loc_log_async_flush
+
+DESCRIPTION
+   Formats and writes everything recorded so far, merging the rings of all
+   threads in timestamp order. Rings of exited threads are freed once
+   drained. Called periodically by the flusher thread; may also be called
+   directly, e.g. before the process exits.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_log_async_flush(void)
+{
+   char line[LOC_LOG_LINE_SIZE];
+   loc_log_ring_s_type* ring;
+   loc_log_ring_s_type** link;
+   long long wall_offset_ns = 0;
+   struct timespec ts;
+
+   pthread_mutex_lock(&loc_log_flush_mutex);
+
+   if( loc_logger.TIMESTAMP )
+   {
+      clock_gettime(CLOCK_REALTIME, &ts);
+      wall_offset_ns = (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec - loc_log_now_ns();
+   }
+
+   for( ;; )
+   {
+      loc_log_ring_s_type* oldest = NULL;
+      loc_log_entry_s_type* entry;
+      size_t len = 0;
+
+      /* Producers only ever push at the front, so the list can be walked
+         without the lock as long as the head is read under it */
+      pthread_mutex_lock(&loc_log_rings_mutex);
+      ring = loc_log_rings;
+      pthread_mutex_unlock(&loc_log_rings_mutex);
+
+      for( ; ring != NULL; ring = ring->next )
+      {
+         uint32_t dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+         if( dropped != 0 )
+         {
+            /* Not LOC_LOGE, with ASYNC on that would land in a ring again */
+            __android_log_print(ANDROID_LOG_ERROR, "LocSvc_log",
+                                "%u messages dropped", dropped);
+         }
+
+         if( ring->tail != __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) &&
+             (oldest == NULL ||
+              ring->entries[ring->tail & (LOC_LOG_RING_SIZE - 1)].ts_ns <
+              oldest->entries[oldest->tail & (LOC_LOG_RING_SIZE - 1)].ts_ns) )
+         {
+            oldest = ring;
+         }
+      }
+
+      if( oldest == NULL )
+      {
+         break;
+      }
+
+      entry = &oldest->entries[oldest->tail & (LOC_LOG_RING_SIZE - 1)];
+      if( loc_logger.TIMESTAMP )
+      {
+         long long wall_us = (entry->ts_ns + wall_offset_ns) / 1000;
+         long long secs = wall_us / 1000000;
+         len = snprintf(line, sizeof(line), "[%02d:%02d:%02d.%06ld] ",
+                        (int)(secs / 3600 % 24), (int)(secs % 3600 / 60), (int)(secs % 60),
+                        (long)(wall_us % 1000000));
+      }
+      loc_log_format(entry, line, sizeof(line), len);
+      __android_log_write(entry->prio, entry->tag, line);
+
+      __atomic_store_n(&oldest->tail, oldest->tail + 1, __ATOMIC_RELEASE);
+   }
+
+   /* Free the drained rings of threads that have exited */
+   pthread_mutex_lock(&loc_log_rings_mutex);
+   for( link = &loc_log_rings; *link != NULL; )
+   {
+      ring = *link;
+      if( __atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE) &&
+          ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) &&
+          ring->dropped == 0 )
+      {
+         *link = ring->next;
+         free(ring);
+      }
+      else
+      {
+         link = &ring->next;
+      }
+   }
+   pthread_mutex_unlock(&loc_log_rings_mutex);
+
+   pthread_mutex_unlock(&loc_log_flush_mutex);
+}
+
+/*===========================================================================
+FUNCTION loc_log_flusher
+
+DESCRIPTION
+   Body of the flusher thread. Flushes every LOC_LOG_FLUSH_PERIOD_US, or
+   earlier when a ring fills up to half.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void* loc_log_flusher(void* arg)
+{
+   struct timespec deadline;
+   (void)arg;
+
+   for( ;; )
+   {
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += LOC_LOG_FLUSH_PERIOD_US * 1000;
+      if( deadline.tv_nsec >= 1000000000 )
+      {
+         deadline.tv_sec++;
+         deadline.tv_nsec -= 1000000000;
+      }
+
+      pthread_mutex_lock(&loc_log_wake_mutex);
+      pthread_cond_timedwait(&loc_log_wake_cond, &loc_log_wake_mutex, &deadline);
+      pthread_mutex_unlock(&loc_log_wake_mutex);
+
+      loc_log_async_flush();
+   }
+   return NULL;
+}
+
+static void loc_log_async_start()
+{
+   pthread_t thread;
+
+   if( pthread_key_create(&loc_log_ring_key, loc_log_ring_destructor) != 0 )
+   {
+      return;
+   }
+   if( pthread_create(&thread, NULL, loc_log_flusher, NULL) != 0 )
+   {
+      return;
+   }
+   pthread_detach(thread);
+   loc_log_flusher_started = 1;
+}
+
+/*===========================================================================
+FUNCTION loc_logger_async_init
+
+DESCRIPTION
+   Turns asynchronous logging on or off. The flusher thread is started the
+   first time it is turned on and keeps running afterwards, so messages
+   still queued when logging goes back to synchronous are written too.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_logger_async_init(unsigned long async)
+{
+   if( async )
+   {
+      pthread_once(&loc_log_async_once, loc_log_async_start);
+      if( !loc_log_flusher_started )
+      {
+         async = 0;
+         LOC_LOGE("%s: unable to start the flusher thread", __FUNCTION__);
+      }
+   }
+   loc_logger.ASYNC = async;
+}
@@ -0,0 +1,368 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#define LOG_TAG "LocSvc_utils_timer"
+#include "log_util.h"
+
+#include "loc_timer.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+
+/* Three wheel levels of 256, 64 and 64 slots. A timer waits in level 0
+   when it expires within 256 ticks, else in the level whose slots span
+   its delay, and is moved down (cascaded) as the wheel turns. The test
+   builds a smaller wheel, to reach every level within seconds. */
+#ifndef LOC_TIMER_L0_BITS
+#define LOC_TIMER_L0_BITS  8
+#endif
+#ifndef LOC_TIMER_L1_BITS
+#define LOC_TIMER_L1_BITS  6
+#endif
+#ifndef LOC_TIMER_L2_BITS
+#define LOC_TIMER_L2_BITS  6
+#endif
+#define LOC_TIMER_L0_SIZE  (1 << LOC_TIMER_L0_BITS)
+#define LOC_TIMER_L1_SIZE  (1 << LOC_TIMER_L1_BITS)
+#define LOC_TIMER_L2_SIZE  (1 << LOC_TIMER_L2_BITS)
+#define LOC_TIMER_L1_SHIFT LOC_TIMER_L0_BITS
+#define LOC_TIMER_L2_SHIFT (LOC_TIMER_L0_BITS + LOC_TIMER_L1_BITS)
+#define LOC_TIMER_MAX_TICKS (1ULL << (LOC_TIMER_L2_SHIFT + LOC_TIMER_L2_BITS))
+
+static linked_list_node loc_timer_wheel0[LOC_TIMER_L0_SIZE];
+static linked_list_node loc_timer_wheel1[LOC_TIMER_L1_SIZE];
+static linked_list_node loc_timer_wheel2[LOC_TIMER_L2_SIZE];
+/* Timers that expired and wait for their callback */
+static linked_list_node loc_timer_expired;
+
+static uint64_t loc_timer_wheel_now;   /* Last tick the wheel turned to */
+static uint64_t loc_timer_armed_tick;  /* Tick timerfd is armed for, 0 if not */
+static unsigned int loc_timer_num_pending;
+static int loc_timer_fd = -1;
+
+static pthread_mutex_t loc_timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t loc_timer_once = PTHREAD_ONCE_INIT;
+
+/* Current CLOCK_MONOTONIC time in msec */
+static uint64_t loc_timer_now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Current CLOCK_MONOTONIC time in ticks */
+static uint64_t loc_timer_now(void)
+{
+   return loc_timer_now_ms() / LOC_TIMER_TICK_MS;
+}
+
+/* Puts a timer in its slot. Called with loc_timer_mutex held. */
+static void loc_timer_insert(loc_timer* timer)
+{
+   uint64_t delta;
+   linked_list_node* slot;
+
+   if( timer->expires <= loc_timer_wheel_now )
+   {
+      timer->expires = loc_timer_wheel_now + 1;
+   }
+   delta = timer->expires - loc_timer_wheel_now;
+   if( delta >= LOC_TIMER_MAX_TICKS )
+   {
+      timer->expires = loc_timer_wheel_now + LOC_TIMER_MAX_TICKS - 1;
+      delta = LOC_TIMER_MAX_TICKS - 1;
+   }
+
+   if( delta < LOC_TIMER_L0_SIZE )
+   {
+      slot = &loc_timer_wheel0[timer->expires & (LOC_TIMER_L0_SIZE - 1)];
+   }
+   else if( delta < (1ULL << LOC_TIMER_L2_SHIFT) )
+   {
+      slot = &loc_timer_wheel1[(timer->expires >> LOC_TIMER_L1_SHIFT) & (LOC_TIMER_L1_SIZE - 1)];
+   }
+   else
+   {
+      slot = &loc_timer_wheel2[(timer->expires >> LOC_TIMER_L2_SHIFT) & (LOC_TIMER_L2_SIZE - 1)];
+   }
+   linked_list_intr_add(slot, &timer->node);
+}
+
+/* Moves the timers of a slot down the wheel. Called with loc_timer_mutex held. */
+static void loc_timer_cascade(linked_list_node* slot)
+{
+   linked_list_node moving;
+   linked_list_node* node;
+
+   /* take them all off first, a timer may go back into the same level */
+   linked_list_intr_init(&moving);
+   while( linked_list_intr_remove(slot, &node) == eLINKED_LIST_SUCCESS )
+   {
+      linked_list_intr_add(&moving, node);
+   }
+   while( linked_list_intr_remove(&moving, &node) == eLINKED_LIST_SUCCESS )
+   {
+      loc_timer_insert(LINKED_LIST_ENTRY(node, loc_timer, node));
+   }
+}
+
+/* Turns the wheel by one tick. Called with loc_timer_mutex held. */
+static void loc_timer_turn(void)
+{
+   unsigned int idx0, idx1;
+   linked_list_node* node;
+
+   loc_timer_wheel_now++;
+   idx0 = loc_timer_wheel_now & (LOC_TIMER_L0_SIZE - 1);
+   if( idx0 == 0 )
+   {
+      idx1 = (loc_timer_wheel_now >> LOC_TIMER_L1_SHIFT) & (LOC_TIMER_L1_SIZE - 1);
+      loc_timer_cascade(&loc_timer_wheel1[idx1]);
+      if( idx1 == 0 )
+      {
+         loc_timer_cascade(&loc_timer_wheel2[(loc_timer_wheel_now >> LOC_TIMER_L2_SHIFT) &
+                                             (LOC_TIMER_L2_SIZE - 1)]);
+      }
+   }
+
+   while( linked_list_intr_remove(&loc_timer_wheel0[idx0], &node) == eLINKED_LIST_SUCCESS )
+   {
+      linked_list_intr_add(&loc_timer_expired, node);
+   }
+}
+
+/* Arms timerfd for the next level 0 slot holding timers, or the next
+   cascade if that comes first. Called with loc_timer_mutex held. */
+static void loc_timer_arm(void)
+{
+   struct itimerspec its;
+   uint64_t tick = 0;
+
+   memset(&its, 0, sizeof(its));
+   if( loc_timer_num_pending > 0 )
+   {
+      uint64_t ms;
+      tick = loc_timer_wheel_now + 1;
+      while( (tick & (LOC_TIMER_L0_SIZE - 1)) != 0 &&
+             linked_list_intr_empty(&loc_timer_wheel0[tick & (LOC_TIMER_L0_SIZE - 1)]) )
+      {
+         tick++;
+      }
+      ms = tick * LOC_TIMER_TICK_MS;
+      its.it_value.tv_sec = ms / 1000;
+      its.it_value.tv_nsec = (ms % 1000) * 1000000;
+   }
+
+   if( timerfd_settime(loc_timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0 )
+   {
+      LOC_LOGE("%s: timerfd_settime failed: %s\n", __FUNCTION__, strerror(errno));
+   }
+   loc_timer_armed_tick = tick;
+}
+
+/* Turns the wheel up to the clock. Called with loc_timer_mutex held. */
+static void loc_timer_catch_up(void)
+{
+   uint64_t now = loc_timer_now();
+
+   while( loc_timer_wheel_now < now )
+   {
+      if( loc_timer_num_pending == 0 )
+      {
+         /* nothing to move, skip the idle ticks */
+         loc_timer_wheel_now = now;
+         break;
+      }
+      loc_timer_turn();
+   }
+}
+
+/* Catches the wheel up with the clock and runs the expired callbacks */
+static void loc_timer_run(void)
+{
+   linked_list_node* node;
+
+   pthread_mutex_lock(&loc_timer_mutex);
+   loc_timer_catch_up();
+
+   while( linked_list_intr_remove(&loc_timer_expired, &node) == eLINKED_LIST_SUCCESS )
+   {
+      loc_timer* timer = LINKED_LIST_ENTRY(node, loc_timer, node);
+      loc_timer_cb cb = timer->cb;
+      void* user_data = timer->user_data;
+
+      timer->pending = 0;
+      loc_timer_num_pending--;
+
+      /* the callback may start or stop timers */
+      pthread_mutex_unlock(&loc_timer_mutex);
+      cb(user_data);
+      pthread_mutex_lock(&loc_timer_mutex);
+   }
+
+   loc_timer_arm();
+   pthread_mutex_unlock(&loc_timer_mutex);
+}
+
+static void* loc_timer_thread(void* arg)
+{
+   uint64_t expirations;
+   (void)arg;
+
+   while( 1 )
+   {
+      if( read(loc_timer_fd, &expirations, sizeof(expirations)) < 0 &&
+          errno != EINTR && errno != EAGAIN )
+      {
+         LOC_LOGE("%s: read failed: %s\n", __FUNCTION__, strerror(errno));
+      }
+      loc_timer_run();
+   }
+   return NULL;
+}
+
+static void loc_timer_init(void)
+{
+   pthread_t thread;
+   int i;
+
+   for( i = 0; i < LOC_TIMER_L0_SIZE; i++ )
+   {
+      linked_list_intr_init(&loc_timer_wheel0[i]);
+   }
+   for( i = 0; i < LOC_TIMER_L1_SIZE; i++ )
+   {
+      linked_list_intr_init(&loc_timer_wheel1[i]);
+   }
+   for( i = 0; i < LOC_TIMER_L2_SIZE; i++ )
+   {
+      linked_list_intr_init(&loc_timer_wheel2[i]);
+   }
+   linked_list_intr_init(&loc_timer_expired);
+   loc_timer_wheel_now = loc_timer_now();
+
+   loc_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+   if( loc_timer_fd < 0 )
+   {
+      LOC_LOGE("%s: timerfd_create failed: %s\n", __FUNCTION__, strerror(errno));
+      return;
+   }
+
+   if( pthread_create(&thread, NULL, loc_timer_thread, NULL) != 0 )
+   {
+      LOC_LOGE("%s: timer thread not created\n", __FUNCTION__);
+      close(loc_timer_fd);
+      loc_timer_fd = -1;
+      return;
+   }
+   pthread_detach(thread);
+}
+
+/*===========================================================================
+
+  FUNCTION:   loc_timer_start
+
+  ===========================================================================*/
+int loc_timer_start(loc_timer* timer, unsigned int msec,
+                    loc_timer_cb cb, void* user_data)
+{
+   if( timer == NULL || cb == NULL )
+   {
+      LOC_LOGE("%s: Invalid parameter!\n", __FUNCTION__);
+      return -1;
+   }
+
+   pthread_once(&loc_timer_once, loc_timer_init);
+   if( loc_timer_fd < 0 )
+   {
+      return -1;
+   }
+
+   pthread_mutex_lock(&loc_timer_mutex);
+   if( timer->pending )
+   {
+      pthread_mutex_unlock(&loc_timer_mutex);
+      LOC_LOGE("%s: timer %p already pending\n", __FUNCTION__, timer);
+      return -1;
+   }
+
+   /* The wheel only turns when a slot holding timers is due, and the
+      reach of the wheel counts from its last turn. Timers this moves to
+      expired were due by the tick timerfd is armed for, the timer
+      thread is already woken for them. */
+   loc_timer_catch_up();
+
+   timer->cb = cb;
+   timer->user_data = user_data;
+   /* the first tick at or after the deadline */
+   timer->expires = (loc_timer_now_ms() + msec + LOC_TIMER_TICK_MS - 1) / LOC_TIMER_TICK_MS;
+   timer->pending = 1;
+   loc_timer_num_pending++;
+   loc_timer_insert(timer);
+
+   if( loc_timer_armed_tick == 0 || timer->expires < loc_timer_armed_tick )
+   {
+      loc_timer_arm();
+   }
+   pthread_mutex_unlock(&loc_timer_mutex);
+
+   return 0;
+}
+
+/*===========================================================================
+
+  FUNCTION:   loc_timer_stop
+
+  ===========================================================================*/
+int loc_timer_stop(loc_timer* timer)
+{
+   int result = -1;
+
+   if( timer == NULL )
+   {
+      LOC_LOGE("%s: Invalid parameter!\n", __FUNCTION__);
+      return -1;
+   }
+
+   pthread_mutex_lock(&loc_timer_mutex);
+   if( timer->pending )
+   {
+      /* on the wheel, or expired with its callback still to come */
+      linked_list_intr_unlink(&timer->node);
+      timer->pending = 0;
+      loc_timer_num_pending--;
+      result = 0;
+   }
+   pthread_mutex_unlock(&loc_timer_mutex);
+
+   return result;
+}
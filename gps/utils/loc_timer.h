@@ -0,0 +1,108 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __LOC_TIMER_H__
+#define __LOC_TIMER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+#include "linked_list.h"
+
+/** Resolution of loc_timer, in msec */
+#define LOC_TIMER_TICK_MS 10
+
+/** Called on the timer service thread when a timer expires */
+typedef void (*loc_timer_cb)(void* user_data);
+
+/** A one shot timer. The caller owns the storage, zeroes it before first
+    use, and keeps it valid while the timer is pending or its callback
+    runs. Treat as opaque. */
+typedef struct loc_timer {
+   linked_list_node node;       /* Wheel slot the timer waits in */
+   uint64_t expires;            /* Tick it expires at */
+   loc_timer_cb cb;
+   void* user_data;
+   int pending;
+} loc_timer;
+
+/*===========================================================================
+FUNCTION    loc_timer_start
+
+DESCRIPTION
+   Starts a one shot timer. All timers are kept on one hierarchical timer
+   wheel, served by a single thread blocking on a timerfd that is only
+   armed for the next slot holding timers. Delays beyond the reach of the
+   wheel, about 2.9 hours, are cut to that.
+
+   timer:     Timer to start, must not be pending.
+   msec:      Delay, rounded up to LOC_TIMER_TICK_MS.
+   cb:        Function to call when the timer expires.
+   user_data: Passed to cb.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 on failure
+
+SIDE EFFECTS
+   Starts the timer service thread on first use.
+
+===========================================================================*/
+int loc_timer_start(loc_timer* timer, unsigned int msec,
+                    loc_timer_cb cb, void* user_data);
+
+/*===========================================================================
+FUNCTION    loc_timer_stop
+
+DESCRIPTION
+   Stops a timer before it expires. Does not wait for a callback that is
+   already running.
+
+   timer: Timer to stop.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 if the timer was pending and its callback will not be called,
+   -1 if it was not pending, i.e. never started, stopped or expired.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_timer_stop(loc_timer* timer);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __LOC_TIMER_H__ */
@@ -44,6 +44,7 @@ typedef struct loc_logger_s
 {
   unsigned long  DEBUG_LEVEL;
   unsigned long  TIMESTAMP;
+  unsigned long  ASYNC;
 } loc_logger_s_type;
 
 /*=============================================================================
@@ -71,45 +72,155 @@ extern const char ENTRY_TAG[];
  *============================================================================*/
 extern void loc_logger_init(unsigned long debug, unsigned long timestamp);
 extern char* get_timestamp(char* str, unsigned long buf_size);
+extern void loc_logger_async_init(unsigned long async);
+extern void loc_log_async(int prio, const char* tag, const char* fmt, ...)
+   __attribute__((format(printf, 3, 4)));
+extern void loc_log_async_flush(void);
 
 
 #include <utils/Log.h>
 
+/* Build time log level. Uses the same numbering as DEBUG_LEVEL in gps.conf:
+   1 - error, 2 - warning, 3 - info, 4 - debug, 5 - verbose. Call sites of
+   levels above LOC_LOG_MIN_LEVEL compile to nothing regardless of the
+   runtime DEBUG_LEVEL. A module overrides it with -DLOC_LOG_MIN_LEVEL=<n>
+   in its LOCAL_CFLAGS. */
+#ifndef LOC_LOG_MIN_LEVEL
+#define LOC_LOG_MIN_LEVEL 5
+#endif
+
+/* Keeps the arguments type checked without generating any code */
+#define LOC_LOG_DISABLED(...) \
+if (0) { ALOGE(__VA_ARGS__); }
+
 #ifndef DEBUG_DMN_LOC_API
 
+/* With ASYNC_LOGGING enabled the message is only recorded on the calling
+   thread, the loc_log flusher thread formats and writes it later */
+#define LOC_ALOG(PRIO, ALOG, ...) \
+if (loc_logger.ASYNC) { loc_log_async(PRIO, LOG_TAG, __VA_ARGS__); } \
+else { ALOG(__VA_ARGS__); }
+
+/* Whether a runtime DEBUG_LEVEL lets messages of LEVEL through */
+#define LOC_LOG_ENABLED(LEVEL) \
+    (loc_logger.DEBUG_LEVEL >= (LEVEL) || loc_logger.DEBUG_LEVEL <= 0)
+
 /* LOGGING MACROS */
-#define LOC_LOGE(...) ALOGE("E/" __VA_ARGS__)
+#define LOC_LOGE(...) \
+LOC_ALOG(ANDROID_LOG_ERROR, ALOGE, "E/" __VA_ARGS__)
 
+#if LOC_LOG_MIN_LEVEL >= 2
 #define LOC_LOGW(...) \
-if (loc_logger.DEBUG_LEVEL >= 2) { ALOGE("W/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGW("W/" __VA_ARGS__); }
+if (loc_logger.DEBUG_LEVEL >= 2) { LOC_ALOG(ANDROID_LOG_ERROR, ALOGE, "W/" __VA_ARGS__); } \
+else if (loc_logger.DEBUG_LEVEL <= 0) { LOC_ALOG(ANDROID_LOG_WARN, ALOGW, "W/" __VA_ARGS__); }
+#else
+#define LOC_LOGW(...) LOC_LOG_DISABLED("W/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_MIN_LEVEL >= 3
 #define LOC_LOGI(...) \
-if (loc_logger.DEBUG_LEVEL >= 3) { ALOGE("I/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGI("W/" __VA_ARGS__); }
+if (loc_logger.DEBUG_LEVEL >= 3) { LOC_ALOG(ANDROID_LOG_ERROR, ALOGE, "I/" __VA_ARGS__); } \
+else if (loc_logger.DEBUG_LEVEL <= 0) { LOC_ALOG(ANDROID_LOG_INFO, ALOGI, "W/" __VA_ARGS__); }
+#else
+#define LOC_LOGI(...) LOC_LOG_DISABLED("I/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_MIN_LEVEL >= 4
 #define LOC_LOGD(...) \
-if (loc_logger.DEBUG_LEVEL >= 4) { ALOGE("D/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGD("W/" __VA_ARGS__); }
+if (loc_logger.DEBUG_LEVEL >= 4) { LOC_ALOG(ANDROID_LOG_ERROR, ALOGE, "D/" __VA_ARGS__); } \
+else if (loc_logger.DEBUG_LEVEL <= 0) { LOC_ALOG(ANDROID_LOG_DEBUG, ALOGD, "W/" __VA_ARGS__); }
+#else
+#define LOC_LOGD(...) LOC_LOG_DISABLED("D/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_MIN_LEVEL >= 5
 #define LOC_LOGV(...) \
-if (loc_logger.DEBUG_LEVEL >= 5) { ALOGE("V/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGV("W/" __VA_ARGS__); }
+if (loc_logger.DEBUG_LEVEL >= 5) { LOC_ALOG(ANDROID_LOG_ERROR, ALOGE, "V/" __VA_ARGS__); } \
+else if (loc_logger.DEBUG_LEVEL <= 0) { if (!LOG_NDEBUG) { LOC_ALOG(ANDROID_LOG_VERBOSE, ALOGV, "W/" __VA_ARGS__); } }
+#else
+#define LOC_LOGV(...) LOC_LOG_DISABLED("V/" __VA_ARGS__)
+#endif
 
 #else /* DEBUG_DMN_LOC_API */
 
+#define LOC_LOG_ENABLED(LEVEL) 1
+
 #define LOC_LOGE(...) ALOGE("E/" __VA_ARGS__)
 
+#if LOC_LOG_MIN_LEVEL >= 2
 #define LOC_LOGW(...) ALOGW("W/" __VA_ARGS__)
+#else
+#define LOC_LOGW(...) LOC_LOG_DISABLED("W/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_MIN_LEVEL >= 3
 #define LOC_LOGI(...) ALOGI("I/" __VA_ARGS__)
+#else
+#define LOC_LOGI(...) LOC_LOG_DISABLED("I/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_MIN_LEVEL >= 4
 #define LOC_LOGD(...) ALOGD("D/" __VA_ARGS__)
+#else
+#define LOC_LOGD(...) LOC_LOG_DISABLED("D/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_MIN_LEVEL >= 5
 #define LOC_LOGV(...) ALOGV("V/" __VA_ARGS__)
+#else
+#define LOC_LOGV(...) LOC_LOG_DISABLED("V/" __VA_ARGS__)
+#endif
 
 #endif /* DEBUG_DMN_LOC_API */
 
+/*=============================================================================
+ *
+ *                          RATE LIMITED LOGGING MACROS
+ *
+ *============================================================================*/
+/* Per call site state of a rate limited log */
+typedef struct loc_log_ratelimit_s
+{
+  long long      next_ms;
+  unsigned long  suppressed;
+} loc_log_ratelimit_s_type;
+
+extern int loc_log_ratelimit(loc_log_ratelimit_s_type* rl, unsigned long interval_ms,
+                             unsigned long* suppressed);
+
+/* Logs at most once every INTERVAL_MS from the call site, for sites that
+   would otherwise log once per message. The first message after a quiet
+   period is preceded by the number of messages dropped before it. LEVEL
+   is checked first so a disabled site does not even read the clock. */
+#define LOC_LOG_RATELIMITED(LOC_LOG, LEVEL, INTERVAL_MS, ...)                 \
+    do {                                                                      \
+        static loc_log_ratelimit_s_type loc_log_rl = { 0, 0 };                \
+        unsigned long loc_log_suppressed;                                     \
+        if (LOC_LOG_ENABLED(LEVEL) &&                                         \
+            loc_log_ratelimit(&loc_log_rl, (INTERVAL_MS),                     \
+                              &loc_log_suppressed)) {                         \
+            if (loc_log_suppressed) {                                         \
+                LOC_LOG("%s:%d] %lu messages suppressed",                     \
+                        __func__, __LINE__, loc_log_suppressed);              \
+            }                                                                 \
+            LOC_LOG(__VA_ARGS__);                                             \
+        }                                                                     \
+    } while(0)
+
+#if LOC_LOG_MIN_LEVEL >= 4
+#define LOC_LOGD_RL(INTERVAL_MS, ...) \
+    LOC_LOG_RATELIMITED(LOC_LOGD, 4, INTERVAL_MS, __VA_ARGS__)
+#else
+#define LOC_LOGD_RL(INTERVAL_MS, ...) LOC_LOG_DISABLED("D/" __VA_ARGS__)
+#endif
+
+#if LOC_LOG_MIN_LEVEL >= 5
+#define LOC_LOGV_RL(INTERVAL_MS, ...) \
+    LOC_LOG_RATELIMITED(LOC_LOGV, 5, INTERVAL_MS, __VA_ARGS__)
+#else
+#define LOC_LOGV_RL(INTERVAL_MS, ...) LOC_LOG_DISABLED("V/" __VA_ARGS__)
+#endif
+
 /*=============================================================================
  *
  *                          LOGGING IMPROVEMENT MACROS
@@ -117,7 +228,7 @@ else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGV("W/" __VA_ARGS__); }
  *============================================================================*/
 #define LOG_(LOC_LOG, ID, WHAT, SPEC, VAL)                                    \
     do {                                                                      \
-        if (loc_logger.TIMESTAMP) {                                           \
+        if (loc_logger.TIMESTAMP && !loc_logger.ASYNC) {                      \
             char ts[32];                                                      \
             LOC_LOG("[%s] %s %s line %d " #SPEC,                              \
                      get_timestamp(ts, sizeof(ts)), ID, WHAT, __LINE__, VAL); \
@@ -27,6 +27,7 @@
  */
 
 #include "msg_q.h"
+#include "msg_q_ring.h"
 
 #define LOG_TAG "LocSvc_utils_q"
 #include "log_util.h"
@@ -36,7 +37,11 @@
 #include <stdlib.h>
 #include <pthread.h>
 
+/* Per message logs are rate limited to one per interval */
+#define MSG_Q_LOG_INTERVAL_MS 1000
+
 typedef struct msg_q {
+   msg_q_type type;                 /* Must stay first, see MSG_Q_IS_RING */
    void* msg_list;                  /* Linked list to store information */
    pthread_cond_t  list_cond;       /* Condition variable for waiting on msg queue */
    pthread_mutex_t list_mutex;      /* Mutex for exclusive access to message queue */
@@ -129,6 +134,7 @@ msq_q_err_type msg_q_init(void** msg_q_data)
       return eMSG_Q_FAILURE_GENERAL;
    }
 
+   tmp_msg_q->type = eMSG_Q_TYPE_LIST;
    tmp_msg_q->unblocked = 0;
 
    *msg_q_data = tmp_msg_q;
@@ -136,6 +142,26 @@ msq_q_err_type msg_q_init(void** msg_q_data)
    return eMSG_Q_SUCCESS;
 }
 
+/*===========================================================================
+
+  FUNCTION:   msg_q_init_type
+
+  ===========================================================================*/
+msq_q_err_type msg_q_init_type(void** msg_q_data, msg_q_type type,
+                               unsigned int capacity)
+{
+   switch( type )
+   {
+   case eMSG_Q_TYPE_LIST:
+      return msg_q_init(msg_q_data);
+   case eMSG_Q_TYPE_RING:
+      return msg_q_ring_init(msg_q_data, capacity);
+   default:
+      LOC_LOGE("%s: Invalid msg_q type %d!\n", __FUNCTION__, type);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+}
+
 /*===========================================================================
 
   FUNCTION:   msg_q_destroy
@@ -149,6 +175,11 @@ msq_q_err_type msg_q_destroy(void** msg_q_data)
       return eMSG_Q_INVALID_HANDLE;
    }
 
+   if( *msg_q_data != NULL && MSG_Q_IS_RING(*msg_q_data) )
+   {
+      return msg_q_ring_destroy(msg_q_data);
+   }
+
    msg_q* p_msg_q = (msg_q*)*msg_q_data;
 
    linked_list_destroy(&p_msg_q->msg_list);
@@ -182,10 +213,15 @@ msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*)
       return eMSG_Q_INVALID_PARAMETER;
    }
 
+   if( MSG_Q_IS_RING(msg_q_data) )
+   {
+      return msg_q_ring_snd(msg_q_data, msg_obj, dealloc);
+   }
+
    msg_q* p_msg_q = (msg_q*)msg_q_data;
 
    pthread_mutex_lock(&p_msg_q->list_mutex);
-   LOC_LOGD("%s: Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
+   LOC_LOGD_RL(MSG_Q_LOG_INTERVAL_MS, "%s: Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
 
    if( p_msg_q->unblocked )
    {
@@ -201,7 +237,7 @@ msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*)
 
    pthread_mutex_unlock(&p_msg_q->list_mutex);
 
-   LOC_LOGD("%s: Finished Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
+   LOC_LOGD_RL(MSG_Q_LOG_INTERVAL_MS, "%s: Finished Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
 
    return rv;
 }
@@ -226,9 +262,14 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
       return eMSG_Q_INVALID_PARAMETER;
    }
 
+   if( MSG_Q_IS_RING(msg_q_data) )
+   {
+      return msg_q_ring_rcv(msg_q_data, msg_obj);
+   }
+
    msg_q* p_msg_q = (msg_q*)msg_q_data;
 
-   LOC_LOGD("%s: Waiting on message\n", __FUNCTION__);
+   LOC_LOGD_RL(MSG_Q_LOG_INTERVAL_MS, "%s: Waiting on message\n", __FUNCTION__);
 
    pthread_mutex_lock(&p_msg_q->list_mutex);
 
@@ -249,7 +290,128 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
 
    pthread_mutex_unlock(&p_msg_q->list_mutex);
 
-   LOC_LOGD("%s: Received message 0x%08X rv = %d\n", __FUNCTION__, *msg_obj, rv);
+   LOC_LOGD_RL(MSG_Q_LOG_INTERVAL_MS, "%s: Received message 0x%08X rv = %d\n", __FUNCTION__, *msg_obj, rv);
+
+   return rv;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_rcv_batch
+
+  ===========================================================================*/
+msq_q_err_type msg_q_rcv_batch(void* msg_q_data, void** msg_objs,
+                               unsigned int max_num, unsigned int* num)
+{
+   msq_q_err_type rv;
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   if( msg_objs == NULL || num == NULL || max_num == 0 )
+   {
+      LOC_LOGE("%s: Invalid msg_objs parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   if( MSG_Q_IS_RING(msg_q_data) )
+   {
+      return msg_q_ring_rcv_batch(msg_q_data, msg_objs, max_num, num);
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   *num = 0;
+
+   LOC_LOGD_RL(MSG_Q_LOG_INTERVAL_MS, "%s: Waiting on messages\n", __FUNCTION__);
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+
+   if( p_msg_q->unblocked )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      pthread_mutex_unlock(&p_msg_q->list_mutex);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   /* Wait for data in the message queue */
+   while( linked_list_empty(p_msg_q->msg_list) && !p_msg_q->unblocked )
+   {
+      pthread_cond_wait(&p_msg_q->list_cond, &p_msg_q->list_mutex);
+   }
+
+   /* Take everything that is there under the one lock */
+   do
+   {
+      rv = convert_linked_list_err_type(linked_list_remove(p_msg_q->msg_list,
+                                                           &msg_objs[*num]));
+      if( rv != eMSG_Q_SUCCESS )
+      {
+         break;
+      }
+      (*num)++;
+   } while( *num < max_num && !linked_list_empty(p_msg_q->msg_list) );
+
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   LOC_LOGD_RL(MSG_Q_LOG_INTERVAL_MS, "%s: Received %u messages rv = %d\n", __FUNCTION__, *num, rv);
+
+   return rv;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_try_rcv_batch
+
+  ===========================================================================*/
+msq_q_err_type msg_q_try_rcv_batch(void* msg_q_data, void** msg_objs,
+                                   unsigned int max_num, unsigned int* num)
+{
+   msq_q_err_type rv = eMSG_Q_SUCCESS;
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   if( msg_objs == NULL || num == NULL || max_num == 0 )
+   {
+      LOC_LOGE("%s: Invalid msg_objs parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   if( MSG_Q_IS_RING(msg_q_data) )
+   {
+      return msg_q_ring_try_rcv_batch(msg_q_data, msg_objs, max_num, num);
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   *num = 0;
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+
+   if( p_msg_q->unblocked )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      pthread_mutex_unlock(&p_msg_q->list_mutex);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   while( *num < max_num && !linked_list_empty(p_msg_q->msg_list) )
+   {
+      rv = convert_linked_list_err_type(linked_list_remove(p_msg_q->msg_list,
+                                                           &msg_objs[*num]));
+      if( rv != eMSG_Q_SUCCESS )
+      {
+         break;
+      }
+      (*num)++;
+   }
+
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
 
    return rv;
 }
@@ -268,6 +430,11 @@ msq_q_err_type msg_q_flush(void* msg_q_data)
       return eMSG_Q_INVALID_HANDLE;
    }
 
+   if( MSG_Q_IS_RING(msg_q_data) )
+   {
+      return msg_q_ring_flush(msg_q_data);
+   }
+
    msg_q* p_msg_q = (msg_q*)msg_q_data;
 
    LOC_LOGD("%s: Flushing Message Queue\n", __FUNCTION__);
@@ -297,6 +464,11 @@ msq_q_err_type msg_q_unblock(void* msg_q_data)
       return eMSG_Q_INVALID_HANDLE;
    }
 
+   if( MSG_Q_IS_RING(msg_q_data) )
+   {
+      return msg_q_ring_unblock(msg_q_data);
+   }
+
    msg_q* p_msg_q = (msg_q*)msg_q_data;
    pthread_mutex_lock(&p_msg_q->list_mutex);
 
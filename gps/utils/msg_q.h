@@ -52,6 +52,18 @@ typedef enum
      /**< Failed because an the supplied buffer was too small. */
 }msq_q_err_type;
 
+/** Message Queue Storage Types */
+typedef enum
+{
+  eMSG_Q_TYPE_LIST                           = 0,
+     /**< Unbounded queue backed by a mutex protected linked list. */
+  eMSG_Q_TYPE_RING                           = 1,
+     /**< Bounded lock free ring, waiters are woken through a futex. */
+}msg_q_type;
+
+/** Default number of slots of a eMSG_Q_TYPE_RING queue */
+#define MSG_Q_RING_DEFAULT_CAPACITY 256
+
 /*===========================================================================
 FUNCTION    msg_q_init
 
@@ -72,6 +84,36 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_init(void** msg_q_data);
 
+/*===========================================================================
+FUNCTION    msg_q_init_type
+
+DESCRIPTION
+   Initializes internal structures for a message queue using the given
+   storage type. All other msg_q functions work the same on either type.
+
+   A eMSG_Q_TYPE_RING queue holds at most capacity messages (rounded up to
+   a power of 2, 0 selects MSG_Q_RING_DEFAULT_CAPACITY). Senders never take
+   a lock and never wait; a send to a full ring is counted and refused with
+   eMSG_Q_UNAVAILABLE_RESOURCE. As with any failed msg_q_snd, the message
+   then still belongs to the caller, who must free it.
+
+   msg_q_data: State of message queue to be initialized.
+   type:       Storage type of the message queue.
+   capacity:   Number of slots, only used for eMSG_Q_TYPE_RING.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_init_type(void** msg_q_data, msg_q_type type,
+                               unsigned int capacity);
+
 /*===========================================================================
 FUNCTION    msg_q_destroy
 
@@ -139,6 +181,57 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj);
 
+/*===========================================================================
+FUNCTION    msg_q_rcv_batch
+
+DESCRIPTION
+   Retrieves up to max_num messages from the message queue in one go, oldest
+   first. Waits like msg_q_rcv until at least one message is available, then
+   takes whatever else is already queued without waiting any further.
+
+   msg_q_data: Message Queue to copy data from into msg_objs.
+   msg_objs:   Array of at least max_num pointers to copy msg_q contents to.
+   max_num:    Maximum number of messages to retrieve.
+   num:        Set to the number of messages retrieved.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_rcv_batch(void* msg_q_data, void** msg_objs,
+                               unsigned int max_num, unsigned int* num);
+
+/*===========================================================================
+FUNCTION    msg_q_try_rcv_batch
+
+DESCRIPTION
+   Like msg_q_rcv_batch, but never waits: takes up to max_num messages
+   that are already queued, possibly none.
+
+   msg_q_data: Message Queue to copy data from into msg_objs.
+   msg_objs:   Array of at least max_num pointers to copy msg_q contents to.
+   max_num:    Maximum number of messages to retrieve.
+   num:        Set to the number of messages retrieved, 0 if it was empty.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above. An empty queue is eMSG_Q_SUCCESS.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_try_rcv_batch(void* msg_q_data, void** msg_objs,
+                                   unsigned int max_num, unsigned int* num);
+
 /*===========================================================================
 FUNCTION    msg_q_flush
 
@@ -0,0 +1,496 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "msg_q_ring.h"
+
+#define LOG_TAG "LocSvc_utils_q"
+#include "log_util.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define MSG_Q_RING_CACHE_LINE 64
+
+/* A full ring stays full for many sends, log its drops once per interval */
+#define MSG_Q_RING_LOG_INTERVAL_MS 1000
+
+/* Each slot carries a sequence number telling whether it is free for the
+   sender at position seq, or holds the message for the receiver at
+   position seq - 1. */
+typedef struct msg_q_ring_slot {
+   volatile uint32_t seq;
+   void* msg_obj;
+   void (*dealloc)(void*);
+} msg_q_ring_slot;
+
+typedef struct msg_q_ring {
+   msg_q_type type;                  /* Must stay first, see MSG_Q_IS_RING */
+   uint32_t mask;                    /* Number of slots - 1 */
+   msg_q_ring_slot* slots;           /* Ring storage */
+   volatile int unblocked;           /* Has this message queue been unblocked? */
+   volatile int32_t data_futex;      /* Bumped each time a message is added */
+   volatile int32_t data_waiters;    /* Number of receivers waiting on data_futex */
+   volatile uint32_t dropped;        /* Number of sends refused on a full ring */
+   char pad0[MSG_Q_RING_CACHE_LINE];
+   volatile uint32_t tail;           /* Next position to send to */
+   char pad1[MSG_Q_RING_CACHE_LINE];
+   volatile uint32_t head;           /* Next position to receive from */
+   char pad2[MSG_Q_RING_CACHE_LINE];
+} msg_q_ring;
+
+/*===========================================================================
+FUNCTION    msg_q_ring_futex
+
+DESCRIPTION
+   Thin wrapper of the futex system call for the process private
+   FUTEX_WAIT and FUTEX_WAKE operations.
+
+   addr: futex word
+   op:   FUTEX_WAIT_PRIVATE or FUTEX_WAKE_PRIVATE
+   val:  expected value for a wait, number of waiters to wake for a wake
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Return value of the futex system call
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_ring_futex(volatile int32_t* addr, int op, int32_t val)
+{
+   return syscall(__NR_futex, addr, op, val, NULL, NULL, 0);
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_wake
+
+DESCRIPTION
+   Bumps a futex word and wakes its waiters, if there are any. The system
+   call is skipped entirely while nobody is waiting.
+
+   futex:   futex word to bump
+   waiters: number of threads waiting on futex
+   count:   number of waiters to wake
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_ring_wake(volatile int32_t* futex, volatile int32_t* waiters, int count)
+{
+   __atomic_add_fetch(futex, 1, __ATOMIC_SEQ_CST);
+   if( __atomic_load_n(waiters, __ATOMIC_SEQ_CST) > 0 )
+   {
+      msg_q_ring_futex(futex, FUTEX_WAKE_PRIVATE, count);
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_push
+
+DESCRIPTION
+   Claims the next free slot and stores a message into it without blocking.
+
+   p_ring:  ring to add the message to
+   msg_obj: message
+   dealloc: deallocation function of the message
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if the message is added; 0 if the ring is full
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_ring_push(msg_q_ring* p_ring, void* msg_obj, void (*dealloc)(void*))
+{
+   msg_q_ring_slot* slot;
+   uint32_t pos = __atomic_load_n(&p_ring->tail, __ATOMIC_RELAXED);
+
+   for( ;; )
+   {
+      slot = &p_ring->slots[pos & p_ring->mask];
+      int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+      if( diff == 0 )
+      {
+         if( __atomic_compare_exchange_n(&p_ring->tail, &pos, pos + 1, 1,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+         {
+            break;
+         }
+      }
+      else if( diff < 0 )
+      {
+         return 0;
+      }
+      else
+      {
+         pos = __atomic_load_n(&p_ring->tail, __ATOMIC_RELAXED);
+      }
+   }
+
+   slot->msg_obj = msg_obj;
+   slot->dealloc = dealloc;
+   __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+   return 1;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_pop
+
+DESCRIPTION
+   Takes the oldest message out of the ring without blocking.
+
+   p_ring:  ring to take the message from
+   msg_obj: set to the message
+   dealloc: set to the deallocation function of the message, may be NULL
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if a message is taken; 0 if the ring is empty
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_ring_pop(msg_q_ring* p_ring, void** msg_obj, void (**dealloc)(void*))
+{
+   msg_q_ring_slot* slot;
+   uint32_t pos = __atomic_load_n(&p_ring->head, __ATOMIC_RELAXED);
+
+   for( ;; )
+   {
+      slot = &p_ring->slots[pos & p_ring->mask];
+      int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+
+      if( diff == 0 )
+      {
+         if( __atomic_compare_exchange_n(&p_ring->head, &pos, pos + 1, 1,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+         {
+            break;
+         }
+      }
+      else if( diff < 0 )
+      {
+         return 0;
+      }
+      else
+      {
+         pos = __atomic_load_n(&p_ring->head, __ATOMIC_RELAXED);
+      }
+   }
+
+   *msg_obj = slot->msg_obj;
+   if( dealloc != NULL )
+   {
+      *dealloc = slot->dealloc;
+   }
+   __atomic_store_n(&slot->seq, pos + p_ring->mask + 1, __ATOMIC_RELEASE);
+
+   return 1;
+}
+
+/* ----------------------- END INTERNAL FUNCTIONS ---------------------------------------- */
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_init
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_init(void** msg_q_data, unsigned int capacity)
+{
+   uint32_t size = 1;
+   uint32_t i;
+
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   if( capacity == 0 )
+   {
+      capacity = MSG_Q_RING_DEFAULT_CAPACITY;
+   }
+   if( capacity > 0x40000000 )
+   {
+      LOC_LOGE("%s: Invalid capacity %u!\n", __FUNCTION__, capacity);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+   while( size < capacity )
+   {
+      size <<= 1;
+   }
+
+   msg_q_ring* tmp_ring = (msg_q_ring*)calloc(1, sizeof(msg_q_ring));
+   if( tmp_ring == NULL )
+   {
+      LOC_LOGE("%s: Unable to allocate space for message queue!\n", __FUNCTION__);
+      return eMSG_Q_FAILURE_GENERAL;
+   }
+
+   tmp_ring->slots = (msg_q_ring_slot*)calloc(size, sizeof(msg_q_ring_slot));
+   if( tmp_ring->slots == NULL )
+   {
+      LOC_LOGE("%s: Unable to allocate %u ring slots!\n", __FUNCTION__, size);
+      free(tmp_ring);
+      return eMSG_Q_FAILURE_GENERAL;
+   }
+
+   for( i = 0; i < size; i++ )
+   {
+      tmp_ring->slots[i].seq = i;
+   }
+
+   tmp_ring->type = eMSG_Q_TYPE_RING;
+   tmp_ring->mask = size - 1;
+   tmp_ring->unblocked = 0;
+
+   *msg_q_data = tmp_ring;
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_destroy
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_destroy(void** msg_q_data)
+{
+   if( msg_q_data == NULL || *msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   msg_q_ring* p_ring = (msg_q_ring*)*msg_q_data;
+
+   msg_q_ring_flush(p_ring);
+
+   free(p_ring->slots);
+   free(p_ring);
+   *msg_q_data = NULL;
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_snd
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*))
+{
+   msg_q_ring* p_ring = (msg_q_ring*)msg_q_data;
+
+   if( p_ring->unblocked )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   if( !msg_q_ring_push(p_ring, msg_obj, dealloc) )
+   {
+      /* Never wait for a slot, the sender may be the very thread the
+         receiver is waiting on. The message stays with the caller. */
+      uint32_t dropped = __atomic_add_fetch(&p_ring->dropped, 1, __ATOMIC_RELAXED);
+      LOC_LOG_RATELIMITED(LOC_LOGE, 1, MSG_Q_RING_LOG_INTERVAL_MS,
+                          "%s: Message queue is full, refused %p, %u so far\n",
+                          __FUNCTION__, msg_obj, dropped);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   /* Show data is in the message queue. */
+   msg_q_ring_wake(&p_ring->data_futex, &p_ring->data_waiters, 1);
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_rcv
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_rcv(void* msg_q_data, void** msg_obj)
+{
+   msg_q_ring* p_ring = (msg_q_ring*)msg_q_data;
+
+   while( !p_ring->unblocked )
+   {
+      if( msg_q_ring_pop(p_ring, msg_obj, NULL) )
+      {
+         return eMSG_Q_SUCCESS;
+      }
+
+      /* Wait for data in the message queue. The waiter count is raised
+         before sampling the futex word, so a message added after the pop
+         above either changes the word or wakes us up. */
+      __atomic_add_fetch(&p_ring->data_waiters, 1, __ATOMIC_SEQ_CST);
+      int32_t key = __atomic_load_n(&p_ring->data_futex, __ATOMIC_SEQ_CST);
+      if( msg_q_ring_pop(p_ring, msg_obj, NULL) )
+      {
+         __atomic_sub_fetch(&p_ring->data_waiters, 1, __ATOMIC_SEQ_CST);
+         return eMSG_Q_SUCCESS;
+      }
+      if( !p_ring->unblocked )
+      {
+         msg_q_ring_futex(&p_ring->data_futex, FUTEX_WAIT_PRIVATE, key);
+      }
+      __atomic_sub_fetch(&p_ring->data_waiters, 1, __ATOMIC_SEQ_CST);
+   }
+
+   LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+   return eMSG_Q_UNAVAILABLE_RESOURCE;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_rcv_batch
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_rcv_batch(void* msg_q_data, void** msg_objs,
+                                    unsigned int max_num, unsigned int* num)
+{
+   msg_q_ring* p_ring = (msg_q_ring*)msg_q_data;
+   unsigned int i;
+
+   *num = 0;
+
+   msq_q_err_type rv = msg_q_ring_rcv(p_ring, &msg_objs[0]);
+   if( rv != eMSG_Q_SUCCESS )
+   {
+      return rv;
+   }
+
+   for( i = 1; i < max_num && msg_q_ring_pop(p_ring, &msg_objs[i], NULL); i++ )
+      ;
+
+   *num = i;
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_try_rcv_batch
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_try_rcv_batch(void* msg_q_data, void** msg_objs,
+                                        unsigned int max_num, unsigned int* num)
+{
+   msg_q_ring* p_ring = (msg_q_ring*)msg_q_data;
+   unsigned int i;
+
+   *num = 0;
+
+   if( p_ring->unblocked )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   for( i = 0; i < max_num && msg_q_ring_pop(p_ring, &msg_objs[i], NULL); i++ )
+      ;
+
+   *num = i;
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_flush
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_flush(void* msg_q_data)
+{
+   msg_q_ring* p_ring = (msg_q_ring*)msg_q_data;
+   void* msg_obj;
+   void (*dealloc)(void*);
+
+   LOC_LOGD("%s: Flushing Message Queue\n", __FUNCTION__);
+
+   /* Remove all elements from the ring */
+   while( msg_q_ring_pop(p_ring, &msg_obj, &dealloc) )
+   {
+      if( dealloc != NULL )
+      {
+         dealloc(msg_obj);
+      }
+   }
+
+   LOC_LOGD("%s: Message Queue flushed\n", __FUNCTION__);
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_unblock
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_unblock(void* msg_q_data)
+{
+   msg_q_ring* p_ring = (msg_q_ring*)msg_q_data;
+
+   if( __atomic_exchange_n(&p_ring->unblocked, 1, __ATOMIC_SEQ_CST) )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   LOC_LOGD("%s: Unblocking Message Queue\n", __FUNCTION__);
+
+   /* Allow all the waiters to wake up */
+   msg_q_ring_wake(&p_ring->data_futex, &p_ring->data_waiters, INT_MAX);
+
+   LOC_LOGD("%s: Message Queue unblocked\n", __FUNCTION__);
+
+   return eMSG_Q_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __MSG_Q_RING_H__
+#define __MSG_Q_RING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "msg_q.h"
+
+/* Every msg_q handle starts with its msg_q_type, so msg_q.c can tell the
+   storage types apart from the opaque handle alone. */
+#define MSG_Q_IS_RING(msg_q_data) \
+   (*(const msg_q_type*)(msg_q_data) == eMSG_Q_TYPE_RING)
+
+msq_q_err_type msg_q_ring_init(void** msg_q_data, unsigned int capacity);
+msq_q_err_type msg_q_ring_destroy(void** msg_q_data);
+msq_q_err_type msg_q_ring_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*));
+msq_q_err_type msg_q_ring_rcv(void* msg_q_data, void** msg_obj);
+msq_q_err_type msg_q_ring_rcv_batch(void* msg_q_data, void** msg_objs,
+                                    unsigned int max_num, unsigned int* num);
+msq_q_err_type msg_q_ring_try_rcv_batch(void* msg_q_data, void** msg_objs,
+                                        unsigned int max_num, unsigned int* num);
+msq_q_err_type msg_q_ring_flush(void* msg_q_data);
+msq_q_err_type msg_q_ring_unblock(void* msg_q_data);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __MSG_Q_RING_H__ */
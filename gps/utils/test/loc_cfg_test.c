@@ -0,0 +1,224 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Cases for the gps.conf reader in loc_cfg.cpp: lines longer than the
+   old 80 byte line buffer, a last line without a newline (also ending
+   exactly on a page boundary), an empty file, a repeated parameter, and
+   type, range and length errors, which must be reported and leave the
+   default in place. Prints every failed check, exits 1 if there was any.
+   The files are written to $TMPDIR, or /data/local/tmp. */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_cfg_test"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "log_util.h"
+#include "loc_cfg.h"
+
+#define CHECK(cond) test_check((cond), #cond, __LINE__)
+
+static int failures = 0;
+static int checks = 0;
+static char conf_file[256];
+
+static struct
+{
+   int number;
+   double fraction;
+   char string[LOC_MAX_PARAM_STRING + 1];
+   uint8_t number_set;
+   uint8_t fraction_set;
+   uint8_t string_set;
+} conf;
+
+static loc_param_s_type conf_table[] =
+{
+   {"NUMBER",   &conf.number,   &conf.number_set,   'n'},
+   {"FRACTION", &conf.fraction, &conf.fraction_set, 'f'},
+   {"STRING",   &conf.string,   &conf.string_set,   's'},
+};
+
+static const loc_param_range_s_type conf_ranges[] =
+{
+   {0, 100},
+   {-1.5, 1.5},
+   LOC_PARAM_NO_RANGE,
+};
+
+#define CONF_TABLE_LENGTH (sizeof(conf_table) / sizeof(conf_table[0]))
+
+static void test_check(int ok, const char* what, int line)
+{
+   checks++;
+   if( !ok )
+   {
+      failures++;
+      printf("line %d: %s failed\n", line, what);
+   }
+}
+
+static void test_write(const char* contents, size_t size)
+{
+   FILE* file = fopen(conf_file, "w");
+   if( NULL == file || fwrite(contents, 1, size, file) != size || fclose(file) != 0 )
+   {
+      perror(conf_file);
+      exit(2);
+   }
+}
+
+/* Resets the table to its defaults and reads contents through it */
+static uint32_t test_read(const char* contents, loc_param_err_s_type* errors, uint32_t max_errors)
+{
+   conf.number = 42;
+   conf.fraction = 0.25;
+   strlcpy(conf.string, "default", sizeof(conf.string));
+   conf.number_set = conf.fraction_set = conf.string_set = 0;
+
+   test_write(contents, strlen(contents));
+   /* a rewrite within the same second may keep the size and mtime */
+   loc_read_conf_invalidate();
+   return loc_read_conf_checked(conf_file, conf_table, conf_ranges, CONF_TABLE_LENGTH,
+                                errors, max_errors);
+}
+
+static void test_long_lines(void)
+{
+   char contents[1024];
+   char value[LOC_MAX_PARAM_STRING + 1];
+
+   /* 80 characters of value behind a padded name, well over 80 per line */
+   memset(value, 'u', LOC_MAX_PARAM_STRING);
+   value[LOC_MAX_PARAM_STRING] = '\0';
+   snprintf(contents, sizeof(contents),
+            "# a comment that is longer than the line buffer of the old reader used to be\n"
+            "STRING                                        =   %s   \n"
+            "NUMBER = 7\n", value);
+   CHECK(test_read(contents, NULL, 0) == 0);
+   CHECK(strcmp(conf.string, value) == 0);
+   CHECK(conf.string_set == 1);
+   CHECK(conf.number == 7);
+}
+
+static void test_no_trailing_newline(void)
+{
+   char contents[4096 + 1];
+   size_t pad;
+
+   CHECK(test_read("STRING = first\nNUMBER = 9", NULL, 0) == 0);
+   CHECK(conf.number == 9);
+   CHECK(strcmp(conf.string, "first") == 0);
+
+   /* the last line ends on the page boundary of the mapping */
+   pad = sizeof(contents) - 1 - strlen("\nNUMBER = 99");
+   memset(contents, '#', pad);
+   strlcpy(contents + pad, "\nNUMBER = 99", sizeof(contents) - pad);
+   CHECK(test_read(contents, NULL, 0) == 0);
+   CHECK(conf.number == 99);
+}
+
+static void test_empty_file(void)
+{
+   CHECK(test_read("", NULL, 0) == 0);
+   CHECK(conf.number == 42 && conf.number_set == 0);
+   CHECK(conf.fraction == 0.25 && conf.fraction_set == 0);
+   CHECK(strcmp(conf.string, "default") == 0 && conf.string_set == 0);
+
+   unlink(conf_file);
+   loc_read_conf_invalidate();
+   CHECK(loc_read_conf_checked(conf_file, conf_table, conf_ranges, CONF_TABLE_LENGTH,
+                               NULL, 0) == 0);
+   CHECK(conf.number == 42 && conf.number_set == 0);
+}
+
+static void test_duplicate_key(void)
+{
+   CHECK(test_read("NUMBER = 1\nSTRING = one\nNUMBER = 2\nSTRING = NULL\nNUMBER=3\n", NULL, 0) == 0);
+   CHECK(conf.number == 3);
+   CHECK(conf.string[0] == '\0' && conf.string_set == 1);
+}
+
+static void test_errors(void)
+{
+   loc_param_err_s_type errors[4];
+   char contents[1024];
+   char value[LOC_MAX_PARAM_STRING + 2];
+
+   CHECK(test_read("NUMBER = 12abc\n\nFRACTION = 0.5x\n", errors, 4) == 2);
+   CHECK(strcmp(errors[0].param_name, "NUMBER") == 0);
+   CHECK(strcmp(errors[0].param_value, "12abc") == 0);
+   CHECK(errors[0].line == 1 && errors[0].error == LOC_PARAM_ERR_TYPE);
+   CHECK(strcmp(errors[1].param_name, "FRACTION") == 0);
+   CHECK(errors[1].line == 3 && errors[1].error == LOC_PARAM_ERR_TYPE);
+   CHECK(conf.number == 42 && conf.number_set == 0);
+   CHECK(conf.fraction == 0.25 && conf.fraction_set == 0);
+
+   CHECK(test_read("NUMBER = 101\nFRACTION = -2\n", errors, 4) == 2);
+   CHECK(errors[0].error == LOC_PARAM_ERR_RANGE && errors[1].error == LOC_PARAM_ERR_RANGE);
+   CHECK(conf.number == 42 && conf.number_set == 0);
+   CHECK(conf.fraction == 0.25 && conf.fraction_set == 0);
+
+   /* the limits themselves are in range, hex is a number */
+   CHECK(test_read("NUMBER = 0x64\nFRACTION = -1.5\n", errors, 4) == 0);
+   CHECK(conf.number == 100 && conf.fraction == -1.5);
+
+   memset(value, 'v', LOC_MAX_PARAM_STRING + 1);
+   value[LOC_MAX_PARAM_STRING + 1] = '\0';
+   snprintf(contents, sizeof(contents), "STRING = %s\nNUMBER = 5\n", value);
+   CHECK(test_read(contents, errors, 4) == 1);
+   CHECK(errors[0].line == 1 && errors[0].error == LOC_PARAM_ERR_LENGTH);
+   CHECK(strcmp(conf.string, "default") == 0 && conf.string_set == 0);
+   CHECK(conf.number == 5);
+
+   /* more errors than room for them are still counted */
+   CHECK(test_read("NUMBER = x\nFRACTION = y\nSTRING = NULL\n", errors, 1) == 2);
+   CHECK(errors[0].error == LOC_PARAM_ERR_TYPE);
+   CHECK(conf.string[0] == '\0');
+}
+
+int main(void)
+{
+   const char* dir = getenv("TMPDIR");
+
+   snprintf(conf_file, sizeof(conf_file), "%s/loc_cfg_test.%d.conf",
+            dir ? dir : "/data/local/tmp", (int)getpid());
+
+   test_long_lines();
+   test_no_trailing_newline();
+   test_empty_file();
+   test_duplicate_key();
+   test_errors();
+
+   unlink(conf_file);
+   printf("%d checks, %d failures\n", checks, failures);
+   return failures ? 1 : 0;
+}
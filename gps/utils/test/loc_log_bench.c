@@ -0,0 +1,121 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Cost of the LOC_LOG call sites on a loop shaped like the deferred
+   action thread: a burst of messages is sent to a ring msg_q, then taken
+   off in batches and logged per message. Prints ns per message for
+   runtime DEBUG_LEVEL 0, 3 and 4. Built twice by Android.mk, with every
+   level compiled in (loc_log_bench) and with LOC_LOG_MIN_LEVEL=3
+   (loc_log_bench_min3); msg_q is compiled in so it gets the same level.
+   Usage: loc_log_bench [messages] */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_log_bench"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "log_util.h"
+#include "msg_q.h"
+
+#define BENCH_DEFAULT_MESSAGES 100000
+#define BENCH_BURST            32
+
+static long long bench_now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bench_free(void* msg)
+{
+   (void)msg;
+}
+
+static double bench_run(void* q, int messages, unsigned long debugLevel)
+{
+   static int payload[BENCH_BURST];
+   void* msgs[BENCH_BURST];
+   unsigned int num_msgs;
+   int i, sent = 0;
+
+   loc_logger.DEBUG_LEVEL = debugLevel;
+   long long start = bench_now_ns();
+   while( sent < messages )
+   {
+      for( i = 0; i < BENCH_BURST; i++ )
+      {
+         msg_q_snd(q, &payload[i], bench_free);
+      }
+      sent += BENCH_BURST;
+
+      LOC_LOGD_RL(1000, "%s:%d] %d listening ...\n", __func__, __LINE__, sent);
+      if( eMSG_Q_SUCCESS != msg_q_rcv_batch(q, msgs, BENCH_BURST, &num_msgs) )
+      {
+         fprintf(stderr, "msg_q_rcv_batch failed\n");
+         exit(1);
+      }
+      for( i = 0; i < (int)num_msgs; i++ )
+      {
+         LOC_LOGD("%s:%d] received msg %p\n", __func__, __LINE__, msgs[i]);
+         LOC_LOGV("%s:%d] handled msg %p\n", __func__, __LINE__, msgs[i]);
+      }
+   }
+   return (double)(bench_now_ns() - start) / sent;
+}
+
+int main(int argc, char* argv[])
+{
+   static const unsigned long levels[] = { 0, 3, 4 };
+   int messages = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_MESSAGES;
+   void* q = NULL;
+   unsigned int i;
+
+   if( messages <= 0 )
+   {
+      fprintf(stderr, "usage: %s [messages]\n", argv[0]);
+      return 1;
+   }
+   if( eMSG_Q_SUCCESS != msg_q_init_type(&q, eMSG_Q_TYPE_RING, BENCH_BURST) )
+   {
+      fprintf(stderr, "msg_q_init_type failed\n");
+      return 1;
+   }
+
+   printf("LOC_LOG_MIN_LEVEL=%d\n", LOC_LOG_MIN_LEVEL);
+   for( i = 0; i < sizeof(levels) / sizeof(levels[0]); i++ )
+   {
+      printf("DEBUG_LEVEL=%lu: %.0f ns per message\n",
+             levels[i], bench_run(q, messages, levels[i]));
+   }
+
+   msg_q_destroy(&q);
+   return 0;
+}
@@ -0,0 +1,298 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Cases for loc_timer.c: timers expiring on both sides of the level
+   boundaries of the wheel and of the ticks at which it cascades, delays
+   cut to the reach of the wheel, a timer stopped after it expired but
+   before its callback ran, and timers started again from their own
+   callback. Every callback must come no earlier than its delay and at
+   most TEST_LATE_MS after it. Android.mk builds loc_timer.c into the
+   test with a small wheel, so that every level is reached within
+   seconds. Prints every failed check, exits 1 if there was any. */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_timer_test"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "log_util.h"
+#include "loc_timer.h"
+
+#if !defined(LOC_TIMER_L0_BITS) || !defined(LOC_TIMER_L1_BITS) || !defined(LOC_TIMER_L2_BITS)
+#error the test needs the wheel size loc_timer.c is built with
+#endif
+
+#define TEST_L0_TICKS  (1ULL << LOC_TIMER_L0_BITS)
+#define TEST_L1_TICKS  (1ULL << (LOC_TIMER_L0_BITS + LOC_TIMER_L1_BITS))
+#define TEST_MAX_TICKS (1ULL << (LOC_TIMER_L0_BITS + LOC_TIMER_L1_BITS + LOC_TIMER_L2_BITS))
+#define TEST_LATE_MS   (2 * LOC_TIMER_TICK_MS + 40)
+#define TEST_MAX_TIMERS 16
+#define TEST_REARMS     8
+
+#define CHECK(cond) test_check((cond), #cond, __LINE__)
+
+typedef struct test_timer {
+   loc_timer timer;
+   uint64_t earliest_ms;   /* may not fire before */
+   uint64_t latest_ms;     /* should have fired by */
+   uint64_t fired_ms;
+   int fired;
+   int rearms;             /* times left to start again from the callback */
+   int stop_result;        /* of stopping the peer from the callback */
+   struct test_timer* peer;
+} test_timer;
+
+static int failures = 0;
+static int checks = 0;
+static pthread_mutex_t test_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int test_fired;
+
+static void test_check(int ok, const char* what, int line)
+{
+   pthread_mutex_lock(&test_mutex);
+   checks++;
+   if( !ok )
+   {
+      failures++;
+      printf("line %d: %s failed\n", line, what);
+   }
+   pthread_mutex_unlock(&test_mutex);
+}
+
+static uint64_t test_now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Waits until the callbacks ran num times in all, or msec went by */
+static int test_wait_fired(int num, unsigned int msec)
+{
+   uint64_t until = test_now_ms() + msec;
+   int fired;
+
+   do
+   {
+      usleep(5000);
+      pthread_mutex_lock(&test_mutex);
+      fired = test_fired;
+      pthread_mutex_unlock(&test_mutex);
+   } while( fired < num && test_now_ms() < until );
+   return fired;
+}
+
+static void test_fire(test_timer* t)
+{
+   t->fired_ms = test_now_ms();
+   t->fired++;
+   CHECK(t->fired_ms >= t->earliest_ms);
+   CHECK(t->fired_ms <= t->latest_ms);
+   if( t->fired_ms < t->earliest_ms || t->fired_ms > t->latest_ms )
+   {
+      printf("  fired %lld ms after the earliest, %lld ms after the latest time\n",
+             (long long)(t->fired_ms - t->earliest_ms),
+             (long long)(t->fired_ms - t->latest_ms));
+   }
+}
+
+static void test_cb(void* user_data)
+{
+   test_timer* t = (test_timer*)user_data;
+
+   test_fire(t);
+   pthread_mutex_lock(&test_mutex);
+   test_fired++;
+   pthread_mutex_unlock(&test_mutex);
+}
+
+/* Starts t so that it expires on the tick after now_ms + msec */
+static void test_start(test_timer* t, uint64_t msec, loc_timer_cb cb)
+{
+   t->earliest_ms = test_now_ms() + msec;
+   t->latest_ms = t->earliest_ms + TEST_LATE_MS;
+   CHECK(loc_timer_start(&t->timer, msec, cb, t) == 0);
+}
+
+/* Starts t so that it expires on the given tick */
+static void test_start_at(test_timer* t, uint64_t tick)
+{
+   /* the deadline falls within the tick even if the start runs 9 ms later */
+   uint64_t msec = tick * LOC_TIMER_TICK_MS - (LOC_TIMER_TICK_MS - 1) - test_now_ms();
+   test_start(t, msec, test_cb);
+}
+
+static uint64_t test_round_up(uint64_t tick, uint64_t ticks)
+{
+   return (tick + ticks - 1) / ticks * ticks;
+}
+
+static void test_boundaries(void)
+{
+   static const uint64_t deltas[] = {
+      1, TEST_L0_TICKS - 1, TEST_L0_TICKS, TEST_L0_TICKS + 1,
+      TEST_L1_TICKS - 1, TEST_L1_TICKS, TEST_L1_TICKS + 1,
+      /* the longest delay in reach wherever the clock is within its tick */
+      TEST_MAX_TICKS - 2
+   };
+   test_timer timers[TEST_MAX_TIMERS];
+   uint64_t now, cascade0, cascade1;
+   unsigned int i, n = 0;
+
+   memset(timers, 0, sizeof(timers));
+   test_fired = 0;
+   now = test_now_ms() / LOC_TIMER_TICK_MS;
+
+   /* delays just below, on and above the reach of each level */
+   for( i = 0; i < sizeof(deltas) / sizeof(deltas[0]); i++ )
+   {
+      test_start(&timers[n++], deltas[i] * LOC_TIMER_TICK_MS, test_cb);
+   }
+
+   /* ticks around the first level 1 and level 2 cascades a timer waits for */
+   cascade0 = test_round_up(now + TEST_L0_TICKS + 2, TEST_L0_TICKS);
+   cascade1 = test_round_up(now + TEST_L1_TICKS + 2, TEST_L1_TICKS);
+   for( i = 0; i < 3; i++ )
+   {
+      test_start_at(&timers[n++], cascade0 - 1 + i);
+      test_start_at(&timers[n++], cascade1 - 1 + i);
+   }
+
+   /* cut to the reach of the wheel, from the start of the current tick */
+   test_start(&timers[n], (TEST_MAX_TICKS + 10) * LOC_TIMER_TICK_MS, test_cb);
+   timers[n].earliest_ms -= 12 * LOC_TIMER_TICK_MS;
+   timers[n].latest_ms -= 10 * LOC_TIMER_TICK_MS;
+   n++;
+
+   CHECK(test_wait_fired(n, TEST_MAX_TICKS * LOC_TIMER_TICK_MS + 1000) == (int)n);
+   for( i = 0; i < n; i++ )
+   {
+      CHECK(timers[i].fired == 1);
+      CHECK(loc_timer_stop(&timers[i].timer) == -1);
+   }
+}
+
+static void test_sleep_cb(void* user_data)
+{
+   (void)user_data;
+   /* the timers of the next ticks expire meanwhile, and wait together */
+   usleep(100000);
+   pthread_mutex_lock(&test_mutex);
+   test_fired++;
+   pthread_mutex_unlock(&test_mutex);
+}
+
+static void test_stop_peer_cb(void* user_data)
+{
+   test_timer* t = (test_timer*)user_data;
+
+   test_fire(t);
+   t->stop_result = loc_timer_stop(&t->peer->timer);
+   pthread_mutex_lock(&test_mutex);
+   test_fired++;
+   pthread_mutex_unlock(&test_mutex);
+}
+
+static void test_stop(void)
+{
+   test_timer sleeper, a, b, c;
+
+   memset(&sleeper, 0, sizeof(sleeper));
+   memset(&a, 0, sizeof(a));
+   memset(&b, 0, sizeof(b));
+   memset(&c, 0, sizeof(c));
+   test_fired = 0;
+
+   /* before it expires */
+   test_start(&c, 50, test_cb);
+   CHECK(loc_timer_stop(&c.timer) == 0);
+   CHECK(loc_timer_stop(&c.timer) == -1);
+
+   /* after it expired, from the callback of a timer expiring with it */
+   CHECK(loc_timer_start(&sleeper.timer, 0, test_sleep_cb, &sleeper) == 0);
+   a.peer = &b;
+   b.peer = &a;
+   a.stop_result = b.stop_result = 1;
+   test_start(&a, 20, test_stop_peer_cb);
+   test_start(&b, 40, test_stop_peer_cb);
+   a.latest_ms = b.latest_ms = a.earliest_ms + 100 + TEST_LATE_MS;
+
+   CHECK(test_wait_fired(2, 1000) == 2);
+   CHECK(test_wait_fired(3, 200) == 2);
+   CHECK(a.fired + b.fired == 1);
+   CHECK((a.fired ? a.stop_result : b.stop_result) == 0);
+   CHECK(loc_timer_stop(&a.timer) == -1);
+   CHECK(loc_timer_stop(&b.timer) == -1);
+   CHECK(c.fired == 0);
+}
+
+static void test_rearm_cb(void* user_data)
+{
+   test_timer* t = (test_timer*)user_data;
+
+   test_fire(t);
+   if( t->rearms-- > 0 )
+   {
+      /* alternately on level 0 and level 1 */
+      test_start(t, (t->rearms % 2) ? 0 : TEST_L0_TICKS * LOC_TIMER_TICK_MS, test_rearm_cb);
+      return;
+   }
+   pthread_mutex_lock(&test_mutex);
+   test_fired++;
+   pthread_mutex_unlock(&test_mutex);
+}
+
+static void test_rearm(void)
+{
+   test_timer timers[2];
+
+   memset(timers, 0, sizeof(timers));
+   test_fired = 0;
+   timers[0].rearms = timers[1].rearms = TEST_REARMS;
+   test_start(&timers[0], 0, test_rearm_cb);
+   test_start(&timers[1], TEST_L0_TICKS * LOC_TIMER_TICK_MS, test_rearm_cb);
+
+   CHECK(test_wait_fired(2, (TEST_REARMS + 1) * TEST_L0_TICKS * LOC_TIMER_TICK_MS + 1000) == 2);
+   CHECK(timers[0].fired == TEST_REARMS + 1);
+   CHECK(timers[1].fired == TEST_REARMS + 1);
+}
+
+int main(void)
+{
+   test_boundaries();
+   test_stop();
+   test_rearm();
+
+   printf("%d checks, %d failures\n", checks, failures);
+   return failures ? 1 : 0;
+}
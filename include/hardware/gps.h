@@ -278,6 +278,11 @@ typedef uint16_t AGpsRefLocationType;
  */
 #define ULP_RAW_CMD_INTERFACE      "ulp-raw-cmd"
 
+/**
+ * Name for the fix batching interface.
+ */
+#define GPS_BATCHING_INTERFACE     "gps-batching"
+
 /* The following typedef together with its constants below are deprecated, and
  * will be removed in the next release. */
 typedef uint16_t GpsClockFlags;
@@ -1015,6 +1020,45 @@ typedef struct {
 
 } InjectRawCmdInterface;
 
+/**
+ * Callback telling the client that batched fixes are waiting to be read,
+ * either because the flush period is up or because the batch is full.
+ * Can only be called from a thread created by create_thread_cb.
+ */
+typedef void (* gps_batch_ready_callback)(size_t num_fixes);
+
+/** Callback structure for the fix batching interface. */
+typedef struct {
+    /** set to sizeof(GpsBatchingCallbacks) */
+    size_t          size;
+    gps_batch_ready_callback batch_ready_cb;
+} GpsBatchingCallbacks;
+
+/**
+ * Extended interface for collecting fixes in the HAL and handing them
+ * over in bulk. While batching, fixes of the session started through
+ * GpsInterface go into the batch instead of to location_cb.
+ */
+typedef struct {
+    /** set to sizeof(GpsBatchingInterface) */
+    size_t          size;
+    /** Registers the callbacks, returns 0 on success */
+    int   (*init)(GpsBatchingCallbacks* callbacks);
+    /**
+     * Starts batching. batch_ready_cb is called every flush_period_ms
+     * while there are fixes, or only when the batch fills up if 0.
+     * Once full, the oldest fixes are overwritten.
+     */
+    int   (*start)(uint32_t flush_period_ms);
+    /** Stops batching, fixes already batched can still be read */
+    int   (*stop)(void);
+    /**
+     * Moves up to max_fixes of the oldest batched fixes into fixes,
+     * returns the number moved.
+     */
+    size_t (*read_batch)(GpsLocation* fixes, size_t max_fixes);
+} GpsBatchingInterface;
+
 /** ULP Network Interface */
 /** Request for network position status   */
 #define ULP_NETWORK_POS_STATUS_REQUEST                      (0x01)